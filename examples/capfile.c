@@ -0,0 +1,353 @@
+#include "private.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "libmy/my_alloc.h"
+
+#include "capfile.h"
+
+#define PCAP_MAGIC			0xa1b2c3d4
+#define PCAP_MAGIC_NSEC			0xa1b23c4d
+#define PCAP_LEN_FILE_HEADER		24
+#define PCAP_LEN_RECORD_HEADER		16
+
+#define PCAPNG_BT_SHB			0x0a0d0d0a
+#define PCAPNG_BT_IDB			0x00000001
+#define PCAPNG_BT_SPB			0x00000003
+#define PCAPNG_BT_EPB			0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC		0x1a2b3c4d
+#define PCAPNG_OPT_ENDOFOPT		0
+#define PCAPNG_OPT_IF_TSRESOL		9
+#define PCAPNG_DEFAULT_TSRESOL		6
+
+struct capfile_if {
+	uint16_t		linktype;
+	uint32_t		snaplen;
+	uint8_t			tsresol;
+};
+
+struct capfile {
+	int			fd;
+	const uint8_t		*map;
+	size_t			len;
+	size_t			off;
+	bool			swapped;
+	bool			pcapng;
+
+	/* pcap */
+	bool			nsec;
+	uint16_t		linktype;
+	uint32_t		snaplen;
+
+	/* pcapng: interfaces of the current section */
+	struct capfile_if	*ifs;
+	size_t			n_ifs;
+
+	const char		*error;
+};
+
+static inline uint32_t
+get32(const struct capfile *cf, const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return (cf->swapped ? __builtin_bswap32(v) : v);
+}
+
+static inline uint16_t
+get16(const struct capfile *cf, const uint8_t *p)
+{
+	uint16_t v;
+	memcpy(&v, p, sizeof(v));
+	return (cf->swapped ? __builtin_bswap16(v) : v);
+}
+
+static void
+ts_to_timespec(uint64_t ts, uint8_t tsresol, struct timespec *out)
+{
+	uint64_t units = 1;
+
+	if (tsresol & 0x80) {
+		unsigned n = tsresol & 0x7f;
+		units = 1ULL << (n > 63 ? 63 : n);
+	} else {
+		for (unsigned i = 0; i < tsresol && i < 19; i++)
+			units *= 10;
+	}
+	out->tv_sec = ts / units;
+	out->tv_nsec = (long) ((double) (ts % units) * 1E9 / (double) units);
+}
+
+static bool
+pcap_next(struct capfile *cf, struct capfile_rec *rec)
+{
+	const uint8_t *p;
+	uint32_t ts_sec, ts_frac;
+
+	if (cf->off == cf->len)
+		return (false);
+	if (cf->len - cf->off < PCAP_LEN_RECORD_HEADER) {
+		cf->error = "truncated record header";
+		return (false);
+	}
+
+	p = cf->map + cf->off;
+	ts_sec = get32(cf, p);
+	ts_frac = get32(cf, p + 4);
+	rec->caplen = get32(cf, p + 8);
+	rec->len = get32(cf, p + 12);
+	p += PCAP_LEN_RECORD_HEADER;
+
+	if (rec->caplen > cf->len - cf->off - PCAP_LEN_RECORD_HEADER) {
+		cf->error = "truncated record";
+		return (false);
+	}
+
+	rec->ts.tv_sec = ts_sec;
+	rec->ts.tv_nsec = cf->nsec ? ts_frac : ts_frac * 1000;
+	rec->linktype = cf->linktype;
+	rec->snaplen = cf->snaplen;
+	rec->data = p;
+
+	cf->off += PCAP_LEN_RECORD_HEADER + rec->caplen;
+	return (true);
+}
+
+static bool
+pcapng_shb(struct capfile *cf, const uint8_t *p, size_t avail)
+{
+	uint32_t bom;
+
+	if (avail < 28) {
+		cf->error = "truncated section header block";
+		return (false);
+	}
+	memcpy(&bom, p + 8, sizeof(bom));
+	if (bom == PCAPNG_BYTE_ORDER_MAGIC) {
+		cf->swapped = false;
+	} else if (bom == __builtin_bswap32(PCAPNG_BYTE_ORDER_MAGIC)) {
+		cf->swapped = true;
+	} else {
+		cf->error = "bad byte-order magic";
+		return (false);
+	}
+
+	/* interface ids are scoped to a section */
+	cf->n_ifs = 0;
+	return (true);
+}
+
+static void
+pcapng_idb(struct capfile *cf, const uint8_t *p, uint32_t blen)
+{
+	struct capfile_if *ifp;
+	const uint8_t *opt, *end;
+
+	cf->ifs = my_realloc(cf->ifs, (cf->n_ifs + 1) * sizeof(*cf->ifs));
+	ifp = &cf->ifs[cf->n_ifs++];
+	ifp->linktype = get16(cf, p + 8);
+	ifp->snaplen = get32(cf, p + 12);
+	ifp->tsresol = PCAPNG_DEFAULT_TSRESOL;
+
+	opt = p + 16;
+	end = p + blen - 4;
+	while (end - opt >= 4) {
+		uint16_t code = get16(cf, opt);
+		uint16_t olen = get16(cf, opt + 2);
+
+		if (code == PCAPNG_OPT_ENDOFOPT || olen > end - opt - 4)
+			break;
+		if (code == PCAPNG_OPT_IF_TSRESOL && olen >= 1)
+			ifp->tsresol = opt[4];
+		opt += 4 + ((olen + 3) & ~3);
+	}
+}
+
+static bool
+pcapng_next(struct capfile *cf, struct capfile_rec *rec)
+{
+	for (;;) {
+		const uint8_t *p = cf->map + cf->off;
+		size_t avail = cf->len - cf->off;
+		uint32_t btype, blen;
+
+		if (avail == 0)
+			return (false);
+		if (avail < 12) {
+			cf->error = "truncated block header";
+			return (false);
+		}
+
+		memcpy(&btype, p, sizeof(btype));
+		if (btype == PCAPNG_BT_SHB) {
+			if (!pcapng_shb(cf, p, avail))
+				return (false);
+		} else {
+			btype = get32(cf, p);
+		}
+
+		blen = get32(cf, p + 4);
+		if (blen < 12 || (blen & 3) != 0 || blen > avail) {
+			cf->error = "bad block length";
+			return (false);
+		}
+		cf->off += blen;
+
+		switch (btype) {
+		case PCAPNG_BT_IDB:
+			if (blen < 20) {
+				cf->error = "truncated interface description block";
+				return (false);
+			}
+			pcapng_idb(cf, p, blen);
+			break;
+
+		case PCAPNG_BT_EPB: {
+			uint32_t if_id;
+			uint64_t ts;
+
+			if (blen < 32) {
+				cf->error = "truncated enhanced packet block";
+				return (false);
+			}
+			if_id = get32(cf, p + 8);
+			if (if_id >= cf->n_ifs) {
+				cf->error = "packet for unknown interface";
+				return (false);
+			}
+			ts = ((uint64_t) get32(cf, p + 12) << 32) | get32(cf, p + 16);
+			rec->caplen = get32(cf, p + 20);
+			rec->len = get32(cf, p + 24);
+			if (rec->caplen > blen - 32) {
+				cf->error = "truncated enhanced packet block";
+				return (false);
+			}
+			ts_to_timespec(ts, cf->ifs[if_id].tsresol, &rec->ts);
+			rec->linktype = cf->ifs[if_id].linktype;
+			rec->snaplen = cf->ifs[if_id].snaplen;
+			rec->data = p + 28;
+			return (true);
+		}
+
+		case PCAPNG_BT_SPB: {
+			uint32_t caplen;
+
+			if (blen < 16 || cf->n_ifs == 0) {
+				cf->error = "bad simple packet block";
+				return (false);
+			}
+			rec->len = get32(cf, p + 8);
+			caplen = rec->len;
+			if (cf->ifs[0].snaplen != 0 && caplen > cf->ifs[0].snaplen)
+				caplen = cf->ifs[0].snaplen;
+			if (caplen > blen - 16)
+				caplen = blen - 16;
+			rec->caplen = caplen;
+			rec->ts.tv_sec = 0;
+			rec->ts.tv_nsec = 0;
+			rec->linktype = cf->ifs[0].linktype;
+			rec->snaplen = cf->ifs[0].snaplen;
+			rec->data = p + 12;
+			return (true);
+		}
+
+		default:
+			/* section headers and blocks we don't use */
+			break;
+		}
+	}
+}
+
+struct capfile *
+capfile_open(const char *fname, char *errbuf, size_t len_errbuf)
+{
+	struct capfile *cf;
+	struct stat st;
+	uint32_t magic;
+	void *map;
+	int fd;
+
+	fd = open(fname, O_RDONLY);
+	if (fd == -1) {
+		if (errbuf)
+			snprintf(errbuf, len_errbuf, "%s: %s", fname, strerror(errno));
+		return (NULL);
+	}
+	if (fstat(fd, &st) != 0 || st.st_size < PCAP_LEN_FILE_HEADER) {
+		if (errbuf)
+			snprintf(errbuf, len_errbuf, "%s: not a capture file", fname);
+		close(fd);
+		return (NULL);
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		if (errbuf)
+			snprintf(errbuf, len_errbuf, "%s: mmap: %s", fname, strerror(errno));
+		close(fd);
+		return (NULL);
+	}
+#ifdef MADV_SEQUENTIAL
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+#endif
+
+	cf = my_calloc(1, sizeof(*cf));
+	cf->fd = fd;
+	cf->map = map;
+	cf->len = st.st_size;
+
+	memcpy(&magic, cf->map, sizeof(magic));
+	if (magic == PCAPNG_BT_SHB) {
+		cf->pcapng = true;
+	} else {
+		if (magic == __builtin_bswap32(PCAP_MAGIC) ||
+		    magic == __builtin_bswap32(PCAP_MAGIC_NSEC))
+		{
+			cf->swapped = true;
+			magic = __builtin_bswap32(magic);
+		}
+		if (magic != PCAP_MAGIC && magic != PCAP_MAGIC_NSEC) {
+			if (errbuf)
+				snprintf(errbuf, len_errbuf, "%s: not a capture file", fname);
+			capfile_close(&cf);
+			return (NULL);
+		}
+		cf->nsec = (magic == PCAP_MAGIC_NSEC);
+		cf->snaplen = get32(cf, cf->map + 16);
+		cf->linktype = get32(cf, cf->map + 20) & 0xffff;
+		cf->off = PCAP_LEN_FILE_HEADER;
+	}
+
+	return (cf);
+}
+
+bool
+capfile_next(struct capfile *cf, struct capfile_rec *rec)
+{
+	if (cf->error != NULL)
+		return (false);
+	if (cf->pcapng)
+		return (pcapng_next(cf, rec));
+	return (pcap_next(cf, rec));
+}
+
+const char *
+capfile_error(struct capfile *cf)
+{
+	return (cf->error);
+}
+
+void
+capfile_close(struct capfile **cf)
+{
+	if (*cf != NULL) {
+		munmap((void *) (*cf)->map, (*cf)->len);
+		close((*cf)->fd);
+		my_free((*cf)->ifs);
+		my_free(*cf);
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef CAPFILE_H
+#define CAPFILE_H
+
+/*
+ * Native reader for pcap and pcapng capture files.
+ *
+ * The file is mmap()ed and records are returned as pointers into the mapping,
+ * so packet data is never copied. Record pointers remain valid until
+ * capfile_close().
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define CAPFILE_LINKTYPE_NULL		0
+#define CAPFILE_LINKTYPE_ETHERNET	1
+#define CAPFILE_LINKTYPE_RAW		101
+#define CAPFILE_LINKTYPE_LINUX_SLL	113
+#define CAPFILE_LINKTYPE_IPV4		228
+#define CAPFILE_LINKTYPE_IPV6		229
+#define CAPFILE_LINKTYPE_LINUX_SLL2	276
+
+struct capfile;
+
+struct capfile_rec {
+	struct timespec		ts;
+	uint32_t		caplen;
+	uint32_t		len;
+	uint32_t		snaplen;
+	uint16_t		linktype;
+	const uint8_t		*data;
+};
+
+/**
+ * Open and map a pcap or pcapng file.
+ *
+ * \return NULL on failure, with a message in errbuf (if non-NULL).
+ */
+struct capfile *
+capfile_open(const char *fname, char *errbuf, size_t len_errbuf);
+
+/**
+ * Return the next packet record.
+ *
+ * \return true if a record was returned, false at end of file or if the
+ *	file is truncated or malformed (see capfile_error()).
+ */
+bool
+capfile_next(struct capfile *, struct capfile_rec *);
+
+/**
+ * Describe why capfile_next() stopped early, or NULL at a clean end of file.
+ */
+const char *
+capfile_error(struct capfile *);
+
+void
+capfile_close(struct capfile **);
+
+#endif /* CAPFILE_H */
@@ -0,0 +1,273 @@
+#include "private.h"
+
+#include "libmy/list.h"
+#include "libmy/lookup3.h"
+#include "libmy/my_alloc.h"
+
+#include "ipreasm.h"
+
+#define MAX_DATAGRAM_LEN	65535
+#define UNIT			8
+#define N_UNITS			((MAX_DATAGRAM_LEN + UNIT - 1) / UNIT)
+#define MIN_ALLOC		2048
+
+struct key {
+	uint8_t			src[16];
+	uint8_t			dst[16];
+	uint32_t		id;
+	uint8_t			ipv;
+	uint8_t			proto;
+	uint8_t			pad[2];
+};
+
+struct dgram {
+	struct key		key;
+	uint32_t		hash;
+	uint64_t		first_ns;
+	struct dgram		*chain;
+	ISC_LINK(struct dgram)	link;
+
+	uint8_t			*data;
+	size_t			size;
+	size_t			total_len;
+	size_t			n_units;
+	uint8_t			proto;
+	uint8_t			map[(N_UNITS + 7) / 8];
+};
+
+struct ipreasm {
+	struct dgram		*dgrams;
+	struct dgram		**buckets;
+	uint32_t		mask;
+	uint32_t		seed;
+	ISC_LIST(struct dgram)	age;
+	ISC_LIST(struct dgram)	free;
+
+	size_t			bytes;
+	size_t			max_bytes;
+	uint64_t		timeout_ns;
+
+	/* buffer of the last completed datagram */
+	uint8_t			*done;
+
+	struct ipreasm_stats	stats;
+};
+
+struct ipreasm *
+ipreasm_init(unsigned max_datagrams, size_t max_bytes, unsigned timeout_ms)
+{
+	struct ipreasm *r;
+	uint32_t n_buckets = 1;
+
+	if (max_datagrams == 0)
+		return (NULL);
+
+	while (n_buckets < 2 * max_datagrams)
+		n_buckets *= 2;
+
+	r = my_calloc(1, sizeof(*r));
+	r->dgrams = my_calloc(max_datagrams, sizeof(struct dgram));
+	r->buckets = my_calloc(n_buckets, sizeof(struct dgram *));
+	r->mask = n_buckets - 1;
+	r->seed = (uint32_t) time(NULL);
+	r->max_bytes = max_bytes;
+	r->timeout_ns = timeout_ms * 1000000ULL;
+
+	ISC_LIST_INIT(r->age);
+	ISC_LIST_INIT(r->free);
+	for (unsigned i = 0; i < max_datagrams; i++)
+		ISC_LIST_APPEND(r->free, &r->dgrams[i], link);
+
+	return (r);
+}
+
+static void
+dgram_release(struct ipreasm *r, struct dgram *g)
+{
+	struct dgram **pp;
+
+	for (pp = &r->buckets[g->hash & r->mask]; *pp != g; pp = &(*pp)->chain)
+		;
+	*pp = g->chain;
+
+	ISC_LIST_UNLINK(r->age, g, link);
+	ISC_LIST_APPEND(r->free, g, link);
+
+	r->bytes -= g->size;
+	my_free(g->data);
+	g->size = 0;
+}
+
+void
+ipreasm_destroy(struct ipreasm **r)
+{
+	if (*r != NULL) {
+		struct dgram *g;
+
+		while ((g = ISC_LIST_HEAD((*r)->age)) != NULL)
+			dgram_release(*r, g);
+		my_free((*r)->done);
+		my_free((*r)->buckets);
+		my_free((*r)->dgrams);
+		my_free(*r);
+	}
+}
+
+static void
+expire(struct ipreasm *r, uint64_t now)
+{
+	struct dgram *g;
+
+	while ((g = ISC_LIST_HEAD(r->age)) != NULL && g->first_ns + r->timeout_ns < now) {
+		dgram_release(r, g);
+		r->stats.n_timeout++;
+	}
+}
+
+static struct dgram *
+dgram_get(struct ipreasm *r, const struct key *k, uint64_t now)
+{
+	struct dgram *g;
+	uint32_t hash;
+
+	hash = my_hashlittle(k, sizeof(*k), r->seed);
+	for (g = r->buckets[hash & r->mask]; g != NULL; g = g->chain) {
+		if (g->hash == hash && memcmp(&g->key, k, sizeof(*k)) == 0)
+			return (g);
+	}
+
+	g = ISC_LIST_HEAD(r->free);
+	if (g == NULL) {
+		dgram_release(r, ISC_LIST_HEAD(r->age));
+		r->stats.n_evicted++;
+		g = ISC_LIST_HEAD(r->free);
+	}
+	ISC_LIST_UNLINK(r->free, g, link);
+	ISC_LIST_APPEND(r->age, g, link);
+
+	g->key = *k;
+	g->hash = hash;
+	g->chain = r->buckets[hash & r->mask];
+	r->buckets[hash & r->mask] = g;
+	g->first_ns = now;
+	g->total_len = 0;
+	g->n_units = 0;
+	g->proto = 0;
+	memset(g->map, 0, sizeof(g->map));
+
+	return (g);
+}
+
+static bool
+dgram_reserve(struct ipreasm *r, struct dgram *g, size_t len)
+{
+	size_t size;
+
+	if (len <= g->size)
+		return (true);
+
+	size = g->size ? g->size : MIN_ALLOC;
+	while (size < len)
+		size *= 2;
+	if (size > MAX_DATAGRAM_LEN)
+		size = MAX_DATAGRAM_LEN;
+
+	/* make room by discarding the oldest datagrams other than this one */
+	while (r->bytes + size - g->size > r->max_bytes) {
+		struct dgram *old = ISC_LIST_HEAD(r->age);
+		if (old == g)
+			return (false);
+		dgram_release(r, old);
+		r->stats.n_evicted++;
+	}
+
+	g->data = my_realloc(g->data, size);
+	r->bytes += size - g->size;
+	g->size = size;
+	return (true);
+}
+
+bool
+ipreasm_add(struct ipreasm *r, struct pktdecode *d, const struct timespec *ts)
+{
+	struct dgram *g;
+	struct key k;
+	uint64_t now;
+	size_t end;
+
+	my_free(r->done);
+
+	now = ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+	expire(r, now);
+
+	end = d->frag_offset + d->l4_len;
+	if (end > MAX_DATAGRAM_LEN || (d->frag_more && (d->l4_len % UNIT) != 0)) {
+		r->stats.n_invalid++;
+		return (false);
+	}
+
+	memset(&k, 0, sizeof(k));
+	k.ipv = d->ipv;
+	k.id = d->frag_id;
+	if (d->ipv == 4) {
+		memcpy(k.src, d->src, 4);
+		memcpy(k.dst, d->dst, 4);
+		k.proto = d->proto;
+	} else {
+		memcpy(k.src, d->src, 16);
+		memcpy(k.dst, d->dst, 16);
+	}
+
+	g = dgram_get(r, &k, now);
+
+	if (!d->frag_more) {
+		if ((g->total_len != 0 && g->total_len != end) ||
+		    (end + UNIT - 1) / UNIT < g->n_units)
+		{
+			dgram_release(r, g);
+			r->stats.n_invalid++;
+			return (false);
+		}
+		g->total_len = end;
+	} else if (g->total_len != 0 && end > g->total_len) {
+		dgram_release(r, g);
+		r->stats.n_invalid++;
+		return (false);
+	}
+	if (d->frag_offset == 0)
+		g->proto = d->proto;
+
+	if (!dgram_reserve(r, g, end)) {
+		dgram_release(r, g);
+		r->stats.n_evicted++;
+		return (false);
+	}
+	memcpy(g->data + d->frag_offset, d->l4, d->l4_len);
+
+	for (size_t u = d->frag_offset / UNIT; u < (end + UNIT - 1) / UNIT; u++) {
+		if ((g->map[u / 8] & (1 << (u % 8))) == 0) {
+			g->map[u / 8] |= 1 << (u % 8);
+			g->n_units++;
+		}
+	}
+
+	if (g->total_len == 0 || g->n_units != (g->total_len + UNIT - 1) / UNIT)
+		return (false);
+
+	/* complete; hand the buffer to the caller until the next call */
+	d->proto = g->proto;
+	d->l4 = r->done = g->data;
+	d->l4_len = g->total_len;
+	r->bytes -= g->size;
+	g->data = NULL;
+	g->size = 0;
+	dgram_release(r, g);
+	r->stats.n_complete++;
+	return (true);
+}
+
+void
+ipreasm_get_stats(struct ipreasm *r, struct ipreasm_stats *stats)
+{
+	*stats = r->stats;
+}
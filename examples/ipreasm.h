@@ -0,0 +1,57 @@
+#ifndef IPREASM_H
+#define IPREASM_H
+
+/*
+ * IPv4 and IPv6 fragment reassembly.
+ *
+ * Datagrams under reassembly are indexed by a hash of (version, source,
+ * destination, identification, and for IPv4, protocol). Both the number of
+ * datagrams and the total number of buffered octets are bounded; when either
+ * limit is reached the oldest datagram is discarded, so a fragment flood can
+ * only displace other incomplete datagrams. Datagrams that are not completed
+ * within the timeout (measured in capture time) are discarded as well.
+ *
+ * Not thread safe; fragments must be added in capture order.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "pktdecode.h"
+
+struct ipreasm;
+
+struct ipreasm_stats {
+	uint64_t		n_complete;
+	uint64_t		n_timeout;
+	uint64_t		n_evicted;
+	uint64_t		n_invalid;
+};
+
+struct ipreasm *
+ipreasm_init(unsigned max_datagrams, size_t max_bytes, unsigned timeout_ms);
+
+void
+ipreasm_destroy(struct ipreasm **);
+
+/**
+ * Add a fragment.
+ *
+ * \param[in,out] d a struct pktdecode for which pktdecode_frame() or
+ *	pktdecode_ip() returned pktdecode_res_fragment
+ * \param[in] ts capture time of the fragment
+ *
+ * \return true if the fragment completed a datagram. d->proto, d->l4 and
+ *	d->l4_len then describe the reassembled upper layer data, which remains
+ *	valid until the next call to ipreasm_add() or ipreasm_destroy(), and
+ *	may be passed to pktdecode_transport().
+ */
+bool
+ipreasm_add(struct ipreasm *, struct pktdecode *d, const struct timespec *ts);
+
+void
+ipreasm_get_stats(struct ipreasm *, struct ipreasm_stats *);
+
+#endif /* IPREASM_H */
@@ -0,0 +1,297 @@
+#include "private.h"
+
+#include "capfile.h"
+#include "pktdecode.h"
+
+#define ETHERTYPE_IP		0x0800
+#define ETHERTYPE_IPV6		0x86dd
+#define ETHERTYPE_VLAN		0x8100
+#define ETHERTYPE_QINQ		0x88a8
+#define ETHERTYPE_QINQ_OLD	0x9100
+
+#define IPPROTO_HOPOPTS_	0
+#define IPPROTO_ROUTING_	43
+#define IPPROTO_FRAGMENT_	44
+#define IPPROTO_AH_		51
+#define IPPROTO_DSTOPTS_	60
+
+#define MAX_VLAN_TAGS		4
+#define MAX_IPV6_EXT_HEADERS	16
+
+static inline uint16_t
+get16(const uint8_t *p)
+{
+	uint16_t v;
+	memcpy(&v, p, sizeof(v));
+	return (ntohs(v));
+}
+
+static inline uint32_t
+get32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return (ntohl(v));
+}
+
+static pktdecode_res
+decode_ethertype(uint16_t etype, const uint8_t *p, size_t len, struct pktdecode *d)
+{
+	for (unsigned i = 0; i < MAX_VLAN_TAGS; i++) {
+		if (etype != ETHERTYPE_VLAN &&
+		    etype != ETHERTYPE_QINQ &&
+		    etype != ETHERTYPE_QINQ_OLD)
+		{
+			break;
+		}
+		if (len < 4)
+			return (pktdecode_res_short);
+		etype = get16(p + 2);
+		p += 4;
+		len -= 4;
+	}
+
+	if (etype != ETHERTYPE_IP && etype != ETHERTYPE_IPV6)
+		return (pktdecode_res_not_ip);
+	return (pktdecode_ip(p, len, d));
+}
+
+pktdecode_res
+pktdecode_frame(uint16_t linktype, const uint8_t *p, size_t len, struct pktdecode *d)
+{
+	switch (linktype) {
+	case CAPFILE_LINKTYPE_ETHERNET:
+		if (len < 14)
+			return (pktdecode_res_short);
+		return (decode_ethertype(get16(p + 12), p + 14, len - 14, d));
+
+	case CAPFILE_LINKTYPE_LINUX_SLL:
+		if (len < 16)
+			return (pktdecode_res_short);
+		return (decode_ethertype(get16(p + 14), p + 16, len - 16, d));
+
+	case CAPFILE_LINKTYPE_LINUX_SLL2:
+		if (len < 20)
+			return (pktdecode_res_short);
+		return (decode_ethertype(get16(p), p + 20, len - 20, d));
+
+	case CAPFILE_LINKTYPE_NULL:
+		/* 4 octet address family in the capturing host's byte order */
+		if (len < 4)
+			return (pktdecode_res_short);
+		return (pktdecode_ip(p + 4, len - 4, d));
+
+	case CAPFILE_LINKTYPE_RAW:
+	case CAPFILE_LINKTYPE_IPV4:
+	case CAPFILE_LINKTYPE_IPV6:
+		return (pktdecode_ip(p, len, d));
+
+	default:
+		return (pktdecode_res_linktype);
+	}
+}
+
+static pktdecode_res
+decode_ipv4(const uint8_t *p, size_t len, struct pktdecode *d)
+{
+	size_t ihl, tot_len;
+	uint16_t frag;
+
+	if (len < 20)
+		return (pktdecode_res_short);
+	ihl = (p[0] & 0x0f) * 4U;
+	tot_len = get16(p + 2);
+	if (ihl < 20 || tot_len < ihl)
+		return (pktdecode_res_not_ip);
+	if (len < ihl)
+		return (pktdecode_res_short);
+
+	/* ignore link layer padding */
+	if (tot_len < len)
+		len = tot_len;
+
+	d->ipv = 4;
+	d->ip = p;
+	d->ip_len = len;
+	d->src = p + 12;
+	d->dst = p + 16;
+	d->proto = p[9];
+	d->l4 = p + ihl;
+	d->l4_len = len - ihl;
+
+	frag = get16(p + 6);
+	if ((frag & 0x3fff) != 0) {
+		d->frag_id = get16(p + 4);
+		d->frag_offset = (frag & 0x1fff) * 8U;
+		d->frag_more = (frag & 0x2000) != 0;
+		return (pktdecode_res_fragment);
+	}
+	return (pktdecode_res_success);
+}
+
+static pktdecode_res
+decode_ipv6(const uint8_t *p, size_t len, struct pktdecode *d)
+{
+	const uint8_t *ext;
+	size_t ext_len, hlen;
+	uint8_t next;
+	bool fragment = false;
+
+	if (len < 40)
+		return (pktdecode_res_short);
+
+	/* ignore link layer padding; jumbograms are not handled */
+	if (40U + get16(p + 4) < len)
+		len = 40U + get16(p + 4);
+
+	d->ipv = 6;
+	d->ip = p;
+	d->ip_len = len;
+	d->src = p + 8;
+	d->dst = p + 24;
+
+	next = p[6];
+	ext = p + 40;
+	ext_len = len - 40;
+	for (unsigned i = 0; i < MAX_IPV6_EXT_HEADERS; i++) {
+		switch (next) {
+		case IPPROTO_HOPOPTS_:
+		case IPPROTO_ROUTING_:
+		case IPPROTO_DSTOPTS_:
+			if (ext_len < 2)
+				return (pktdecode_res_short);
+			hlen = (ext[1] + 1U) * 8U;
+			break;
+		case IPPROTO_AH_:
+			if (ext_len < 2)
+				return (pktdecode_res_short);
+			hlen = (ext[1] + 2U) * 4U;
+			break;
+		case IPPROTO_FRAGMENT_:
+			if (ext_len < 8)
+				return (pktdecode_res_short);
+			hlen = 8;
+			d->frag_offset = get16(ext + 2) & 0xfff8;
+			d->frag_more = (ext[3] & 0x01) != 0;
+			d->frag_id = get32(ext + 4);
+			/* an atomic fragment is a complete datagram */
+			if (d->frag_offset != 0 || d->frag_more)
+				fragment = true;
+			break;
+		default:
+			goto done;
+		}
+		if (ext_len < hlen)
+			return (pktdecode_res_short);
+		next = ext[0];
+		ext += hlen;
+		ext_len -= hlen;
+		if (fragment)
+			break;
+	}
+	if (!fragment)
+		return (pktdecode_res_proto);
+done:
+	d->proto = next;
+	d->l4 = ext;
+	d->l4_len = ext_len;
+	return (fragment ? pktdecode_res_fragment : pktdecode_res_success);
+}
+
+pktdecode_res
+pktdecode_ip(const uint8_t *p, size_t len, struct pktdecode *d)
+{
+	pktdecode_res res;
+
+	if (len < 1)
+		return (pktdecode_res_short);
+	switch (p[0] >> 4) {
+	case 4:
+		res = decode_ipv4(p, len, d);
+		break;
+	case 6:
+		res = decode_ipv6(p, len, d);
+		break;
+	default:
+		return (pktdecode_res_not_ip);
+	}
+	if (res != pktdecode_res_success)
+		return (res);
+	return (pktdecode_transport(d));
+}
+
+static pktdecode_res
+decode_udp(struct pktdecode *d)
+{
+	size_t ulen;
+
+	if (d->l4_len < 8)
+		return (pktdecode_res_short);
+
+	d->sport = get16(d->l4);
+	d->dport = get16(d->l4 + 2);
+	d->payload = d->l4 + 8;
+	d->payload_len = d->l4_len - 8;
+
+	ulen = get16(d->l4 + 4);
+	if (ulen >= 8 && ulen - 8 < d->payload_len)
+		d->payload_len = ulen - 8;
+
+	return (pktdecode_res_success);
+}
+
+static pktdecode_res
+decode_tcp(struct pktdecode *d)
+{
+	size_t doff;
+
+	if (d->l4_len < 20)
+		return (pktdecode_res_short);
+	doff = (d->l4[12] >> 4) * 4U;
+	if (doff < 20)
+		return (pktdecode_res_proto);
+	if (d->l4_len < doff)
+		return (pktdecode_res_short);
+
+	d->sport = get16(d->l4);
+	d->dport = get16(d->l4 + 2);
+	d->tcp_seq = get32(d->l4 + 4);
+	d->tcp_flags = d->l4[13];
+	d->payload = d->l4 + doff;
+	d->payload_len = d->l4_len - doff;
+
+	return (pktdecode_res_success);
+}
+
+pktdecode_res
+pktdecode_transport(struct pktdecode *d)
+{
+	switch (d->proto) {
+	case PKTDECODE_PROTO_UDP:
+		return (decode_udp(d));
+	case PKTDECODE_PROTO_TCP:
+		return (decode_tcp(d));
+	default:
+		return (pktdecode_res_proto);
+	}
+}
+
+const char *
+pktdecode_res_to_str(pktdecode_res res)
+{
+	switch (res) {
+	case pktdecode_res_success:
+		return ("success");
+	case pktdecode_res_short:
+		return ("truncated");
+	case pktdecode_res_linktype:
+		return ("unsupported link type");
+	case pktdecode_res_not_ip:
+		return ("not IP");
+	case pktdecode_res_fragment:
+		return ("IP fragment");
+	case pktdecode_res_proto:
+		return ("not UDP or TCP");
+	}
+	return (NULL);
+}
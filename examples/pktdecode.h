@@ -0,0 +1,83 @@
+#ifndef PKTDECODE_H
+#define PKTDECODE_H
+
+/*
+ * Decode captured frames down to the UDP or TCP payload.
+ *
+ * All pointers set in struct pktdecode point into the caller's buffer; nothing
+ * is copied.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+	pktdecode_res_success,
+	pktdecode_res_short,
+	pktdecode_res_linktype,
+	pktdecode_res_not_ip,
+	pktdecode_res_fragment,
+	pktdecode_res_proto,
+} pktdecode_res;
+
+struct pktdecode {
+	/* network layer: 4 or 6 */
+	unsigned		ipv;
+	const uint8_t		*ip;
+	size_t			ip_len;
+	const uint8_t		*src;
+	const uint8_t		*dst;
+
+	/* upper layer protocol and data following the IP headers */
+	uint8_t			proto;
+	const uint8_t		*l4;
+	size_t			l4_len;
+
+	/* set when pktdecode_res_fragment is returned */
+	uint32_t		frag_id;
+	uint32_t		frag_offset;
+	bool			frag_more;
+
+	/* set when pktdecode_res_success is returned */
+	uint16_t		sport;
+	uint16_t		dport;
+	const uint8_t		*payload;
+	size_t			payload_len;
+
+	/* TCP only */
+	uint32_t		tcp_seq;
+	uint8_t			tcp_flags;
+};
+
+#define PKTDECODE_PROTO_TCP	6
+#define PKTDECODE_PROTO_UDP	17
+
+#define PKTDECODE_TCP_FIN	0x01
+#define PKTDECODE_TCP_SYN	0x02
+#define PKTDECODE_TCP_RST	0x04
+
+/**
+ * Decode a link layer frame.
+ *
+ * \param[in] linktype one of the CAPFILE_LINKTYPE_* values
+ */
+pktdecode_res
+pktdecode_frame(uint16_t linktype, const uint8_t *p, size_t len, struct pktdecode *);
+
+/**
+ * Decode an IPv4 or IPv6 datagram, and the UDP or TCP header it carries.
+ */
+pktdecode_res
+pktdecode_ip(const uint8_t *p, size_t len, struct pktdecode *);
+
+/**
+ * Decode the UDP or TCP header at d->l4, according to d->proto.
+ */
+pktdecode_res
+pktdecode_transport(struct pktdecode *d);
+
+const char *
+pktdecode_res_to_str(pktdecode_res);
+
+#endif /* PKTDECODE_H */
@@ -0,0 +1,405 @@
+#include "private.h"
+
+#include "libmy/list.h"
+#include "libmy/lookup3.h"
+#include "libmy/my_alloc.h"
+
+#include "tcpreasm.h"
+
+#define MAX_FLOW_OOO_BYTES	(256 * 1024)
+
+struct key {
+	uint8_t			src[16];
+	uint8_t			dst[16];
+	uint16_t		sport;
+	uint16_t		dport;
+	uint8_t			ipv;
+	uint8_t			pad[3];
+};
+
+struct seg {
+	struct seg		*next;
+	uint32_t		seq;
+	uint32_t		len;
+	uint8_t			data[];
+};
+
+struct flow {
+	struct key		key;
+	uint32_t		hash;
+	uint64_t		last_ns;
+	struct flow		*chain;
+	ISC_LINK(struct flow)	link;
+
+	uint32_t		next_seq;
+	bool			abandoned;
+
+	/* a message that spans segments, including its length prefix */
+	uint8_t			*buf;
+	size_t			len;
+	size_t			size;
+
+	/* out of order segments, sorted by sequence number */
+	struct seg		*ooo;
+	size_t			ooo_bytes;
+};
+
+struct tcpreasm {
+	struct flow		*flows;
+	struct flow		**buckets;
+	uint32_t		mask;
+	uint32_t		seed;
+	ISC_LIST(struct flow)	lru;
+	ISC_LIST(struct flow)	free;
+
+	size_t			bytes;
+	size_t			max_bytes;
+	uint64_t		timeout_ns;
+
+	tcpreasm_cb		cb;
+	void			*user;
+
+	struct tcpreasm_stats	stats;
+};
+
+static inline bool
+seq_lt(uint32_t a, uint32_t b)
+{
+	return ((int32_t) (a - b) < 0);
+}
+
+struct tcpreasm *
+tcpreasm_init(unsigned max_flows, size_t max_bytes, unsigned timeout_ms,
+	      tcpreasm_cb cb, void *user)
+{
+	struct tcpreasm *r;
+	uint32_t n_buckets = 1;
+
+	if (max_flows == 0)
+		return (NULL);
+
+	while (n_buckets < 2 * max_flows)
+		n_buckets *= 2;
+
+	r = my_calloc(1, sizeof(*r));
+	r->flows = my_calloc(max_flows, sizeof(struct flow));
+	r->buckets = my_calloc(n_buckets, sizeof(struct flow *));
+	r->mask = n_buckets - 1;
+	r->seed = (uint32_t) time(NULL);
+	r->max_bytes = max_bytes;
+	r->timeout_ns = timeout_ms * 1000000ULL;
+	r->cb = cb;
+	r->user = user;
+
+	ISC_LIST_INIT(r->lru);
+	ISC_LIST_INIT(r->free);
+	for (unsigned i = 0; i < max_flows; i++)
+		ISC_LIST_APPEND(r->free, &r->flows[i], link);
+
+	return (r);
+}
+
+static void
+flow_clear(struct tcpreasm *r, struct flow *f)
+{
+	struct seg *s;
+
+	while ((s = f->ooo) != NULL) {
+		f->ooo = s->next;
+		free(s);
+	}
+	r->bytes -= f->size + f->ooo_bytes;
+	f->ooo_bytes = 0;
+	my_free(f->buf);
+	f->len = 0;
+	f->size = 0;
+}
+
+static void
+flow_release(struct tcpreasm *r, struct flow *f)
+{
+	struct flow **pp;
+
+	for (pp = &r->buckets[f->hash & r->mask]; *pp != f; pp = &(*pp)->chain)
+		;
+	*pp = f->chain;
+
+	ISC_LIST_UNLINK(r->lru, f, link);
+	ISC_LIST_APPEND(r->free, f, link);
+	flow_clear(r, f);
+}
+
+static void
+flow_abandon(struct tcpreasm *r, struct flow *f)
+{
+	flow_clear(r, f);
+	f->abandoned = true;
+	r->stats.n_abandoned++;
+}
+
+void
+tcpreasm_destroy(struct tcpreasm **r)
+{
+	if (*r != NULL) {
+		struct flow *f;
+
+		while ((f = ISC_LIST_HEAD((*r)->lru)) != NULL)
+			flow_release(*r, f);
+		my_free((*r)->buckets);
+		my_free((*r)->flows);
+		my_free(*r);
+	}
+}
+
+static void
+expire(struct tcpreasm *r, uint64_t now)
+{
+	struct flow *f;
+
+	while ((f = ISC_LIST_HEAD(r->lru)) != NULL && f->last_ns + r->timeout_ns < now) {
+		flow_release(r, f);
+		r->stats.n_timeout++;
+	}
+}
+
+/* evict the least recently active flows other than 'f' to fit 'len' more octets */
+static bool
+make_room(struct tcpreasm *r, struct flow *f, size_t len)
+{
+	while (r->bytes + len > r->max_bytes) {
+		struct flow *old = ISC_LIST_HEAD(r->lru);
+		if (old == f)
+			return (false);
+		flow_release(r, old);
+		r->stats.n_evicted++;
+	}
+	return (true);
+}
+
+static struct flow *
+flow_get(struct tcpreasm *r, const struct key *k, uint64_t now, bool *is_new)
+{
+	struct flow *f;
+	uint32_t hash;
+
+	hash = my_hashlittle(k, sizeof(*k), r->seed);
+	for (f = r->buckets[hash & r->mask]; f != NULL; f = f->chain) {
+		if (f->hash == hash && memcmp(&f->key, k, sizeof(*k)) == 0) {
+			ISC_LIST_UNLINK(r->lru, f, link);
+			ISC_LIST_APPEND(r->lru, f, link);
+			f->last_ns = now;
+			*is_new = false;
+			return (f);
+		}
+	}
+
+	f = ISC_LIST_HEAD(r->free);
+	if (f == NULL) {
+		flow_release(r, ISC_LIST_HEAD(r->lru));
+		r->stats.n_evicted++;
+		f = ISC_LIST_HEAD(r->free);
+	}
+	ISC_LIST_UNLINK(r->free, f, link);
+	ISC_LIST_APPEND(r->lru, f, link);
+
+	f->key = *k;
+	f->hash = hash;
+	f->chain = r->buckets[hash & r->mask];
+	r->buckets[hash & r->mask] = f;
+	f->last_ns = now;
+	f->abandoned = false;
+	*is_new = true;
+
+	return (f);
+}
+
+static bool
+buf_append(struct tcpreasm *r, struct flow *f, const uint8_t *p, size_t len, size_t want)
+{
+	if (f->len + len > f->size) {
+		size_t size = want > f->len + len ? want : f->len + len;
+
+		if (!make_room(r, f, size - f->size))
+			return (false);
+		f->buf = my_realloc(f->buf, size);
+		r->bytes += size - f->size;
+		f->size = size;
+	}
+	memcpy(f->buf + f->len, p, len);
+	f->len += len;
+	return (true);
+}
+
+static void
+deliver(struct tcpreasm *r, const uint8_t *msg, size_t len)
+{
+	if (len > 0) {
+		r->stats.n_messages++;
+		r->cb(msg, len, r->user);
+	}
+}
+
+/* split in-order stream data into messages */
+static void
+stream(struct tcpreasm *r, struct flow *f, const uint8_t *p, size_t len)
+{
+	size_t mlen, n;
+
+	if (f->len > 0) {
+		/* complete the pending message first */
+		if (f->len < 2) {
+			n = 2 - f->len < len ? 2 - f->len : len;
+			if (!buf_append(r, f, p, n, 2)) {
+				flow_abandon(r, f);
+				return;
+			}
+			p += n;
+			len -= n;
+			if (f->len < 2)
+				return;
+		}
+		mlen = (f->buf[0] << 8) | f->buf[1];
+		n = 2 + mlen - f->len < len ? 2 + mlen - f->len : len;
+		if (!buf_append(r, f, p, n, 2 + mlen)) {
+			flow_abandon(r, f);
+			return;
+		}
+		p += n;
+		len -= n;
+		if (f->len < 2 + mlen)
+			return;
+		deliver(r, f->buf + 2, mlen);
+		f->len = 0;
+	}
+
+	/* whole messages are passed on without copying */
+	while (len >= 2) {
+		mlen = (p[0] << 8) | p[1];
+		if (len < 2 + mlen)
+			break;
+		deliver(r, p + 2, mlen);
+		p += 2 + mlen;
+		len -= 2 + mlen;
+	}
+
+	if (len > 0) {
+		mlen = len >= 2 ? (size_t) ((p[0] << 8) | p[1]) : 0;
+		if (!buf_append(r, f, p, len, 2 + mlen))
+			flow_abandon(r, f);
+	}
+}
+
+static void
+ooo_insert(struct tcpreasm *r, struct flow *f, uint32_t seq, const uint8_t *p, size_t len)
+{
+	struct seg *s, **pp;
+
+	if (f->ooo_bytes + len > MAX_FLOW_OOO_BYTES || !make_room(r, f, len)) {
+		flow_abandon(r, f);
+		return;
+	}
+
+	s = my_malloc(sizeof(*s) + len);
+	s->seq = seq;
+	s->len = len;
+	memcpy(s->data, p, len);
+
+	for (pp = &f->ooo; *pp != NULL && !seq_lt(seq, (*pp)->seq); pp = &(*pp)->next)
+		;
+	s->next = *pp;
+	*pp = s;
+
+	f->ooo_bytes += len;
+	r->bytes += len;
+}
+
+static void
+segment(struct tcpreasm *r, struct flow *f, uint32_t seq, const uint8_t *p, size_t len)
+{
+	struct seg *s;
+	uint32_t skip;
+
+	if (len == 0)
+		return;
+
+	if (seq_lt(f->next_seq, seq)) {
+		ooo_insert(r, f, seq, p, len);
+		return;
+	}
+
+	/* drop data already seen */
+	skip = f->next_seq - seq;
+	if (skip >= len)
+		return;
+	p += skip;
+	len -= skip;
+
+	f->next_seq += len;
+	stream(r, f, p, len);
+
+	/* the gap before the held segments may now be filled */
+	while (!f->abandoned && (s = f->ooo) != NULL && !seq_lt(f->next_seq, s->seq)) {
+		f->ooo = s->next;
+		f->ooo_bytes -= s->len;
+		r->bytes -= s->len;
+
+		skip = f->next_seq - s->seq;
+		if (skip < s->len) {
+			f->next_seq += s->len - skip;
+			stream(r, f, s->data + skip, s->len - skip);
+		}
+		free(s);
+	}
+}
+
+void
+tcpreasm_add(struct tcpreasm *r, const struct pktdecode *d, const struct timespec *ts)
+{
+	struct flow *f;
+	struct key k;
+	uint64_t now;
+	uint32_t seq;
+	bool is_new;
+
+	now = ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+	expire(r, now);
+
+	memset(&k, 0, sizeof(k));
+	k.ipv = d->ipv;
+	k.sport = d->sport;
+	k.dport = d->dport;
+	memcpy(k.src, d->src, d->ipv == 4 ? 4 : 16);
+	memcpy(k.dst, d->dst, d->ipv == 4 ? 4 : 16);
+
+	f = flow_get(r, &k, now, &is_new);
+
+	/* the SYN occupies one sequence number */
+	seq = d->tcp_seq;
+	if ((d->tcp_flags & PKTDECODE_TCP_SYN) != 0) {
+		seq += 1;
+		if (!is_new) {
+			flow_clear(r, f);
+			f->abandoned = false;
+		}
+		f->next_seq = seq;
+	} else if (is_new) {
+		/* joined mid-stream; assume the segment starts a message */
+		f->next_seq = seq;
+	}
+
+	if (!f->abandoned)
+		segment(r, f, seq, d->payload, d->payload_len);
+
+	/* keep a FIN'd flow while a retransmission could still fill a gap */
+	if ((d->tcp_flags & PKTDECODE_TCP_RST) != 0 ||
+	    ((d->tcp_flags & PKTDECODE_TCP_FIN) != 0 && f->ooo == NULL))
+	{
+		flow_release(r, f);
+	}
+}
+
+void
+tcpreasm_get_stats(struct tcpreasm *r, struct tcpreasm_stats *stats)
+{
+	*stats = r->stats;
+}
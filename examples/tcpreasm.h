@@ -0,0 +1,66 @@
+#ifndef TCPREASM_H
+#define TCPREASM_H
+
+/*
+ * TCP stream reassembly and DNS message framing (RFC 1035 section 4.2.2).
+ *
+ * Each direction of a connection is a separate flow. Segments may arrive in
+ * any order; out of order segments are held until the gap before them is
+ * filled. The in-order byte stream is split into two octet length prefixed
+ * messages, which are passed to a callback. Whole messages are handed over
+ * straight from the segment data; only a message that spans segments is
+ * copied.
+ *
+ * The flow table is bounded in both the number of flows and the total number
+ * of buffered octets. When either limit is reached the least recently active
+ * flow is evicted. Flows idle for longer than the timeout (measured in capture
+ * time) are evicted as well, and a flow is released when a RST, or a FIN
+ * with no gap outstanding, is seen. A flow whose gap is never filled is
+ * abandoned once it has buffered too much out of order data, since framing
+ * cannot be recovered after a loss.
+ *
+ * Not thread safe; segments must be added in capture order.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "pktdecode.h"
+
+struct tcpreasm;
+
+struct tcpreasm_stats {
+	uint64_t		n_messages;
+	uint64_t		n_timeout;
+	uint64_t		n_evicted;
+	uint64_t		n_abandoned;
+};
+
+typedef void (*tcpreasm_cb)(const uint8_t *msg, size_t len, void *user);
+
+struct tcpreasm *
+tcpreasm_init(unsigned max_flows, size_t max_bytes, unsigned timeout_ms,
+	      tcpreasm_cb cb, void *user);
+
+void
+tcpreasm_destroy(struct tcpreasm **);
+
+/**
+ * Add a segment.
+ *
+ * \param[in] d a struct pktdecode for which pktdecode_transport() succeeded
+ *	with d->proto == PKTDECODE_PROTO_TCP
+ * \param[in] ts capture time of the segment
+ *
+ * The callback is invoked once for each message completed by the segment,
+ * before tcpreasm_add() returns.
+ */
+void
+tcpreasm_add(struct tcpreasm *, const struct pktdecode *d, const struct timespec *ts);
+
+void
+tcpreasm_get_stats(struct tcpreasm *, struct tcpreasm_stats *);
+
+#endif /* TCPREASM_H */
@@ -1,150 +1,620 @@
 /* wdns-dump-pcap: read a pcap file, and optionally dump broken DNS messages */
 
-/* XXX -- assumes all packets are DNS, use a bpf if not */
-/* XXX -- doesn't handle fragments */
-/* XXX -- only handles ethernet/ipv4 messages */
+/* XXX -- assumes all UDP packets are DNS, use a bpf if not */
+
+/*
+ * Packets are processed by a pipeline of threads:
+ *
+ *	reader --> N parse/format workers --> writer
+ *
+ * The reader (the main thread) walks the mmap()ed capture file with capfile
+ * and collects record pointers into batches, handing batch number 'seq' to
+ * worker 'seq % N'. Packet data is never copied. Each worker decodes, parses
+ * and formats its batches and passes them on to the writer, which collects
+ * them in sequence number order from the same round robin, so output stays in
+ * capture order. Finished batches are handed back to the reader for reuse.
+ * Every hand-off is between exactly one producer and one consumer, so each
+ * uses its own single-producer / single-consumer my_queue.
+ *
+ * IP fragments and TCP segments are skipped by the workers and reassembled by
+ * the writer, which sees every packet in capture order. A reassembled message
+ * is parsed and printed by the writer at the position of the packet that
+ * completed it.
+ */
 
 #include "private.h"
 
-#include <pcap.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBPCAP
+# include <pcap.h>
+#endif
 #include <wdns.h>
 
+#include "libmy/my_queue.h"
+#include "libmy/my_time.h"
+#include "libmy/ubuf.h"
+
+#include "capfile.h"
+#include "ipreasm.h"
+#include "pktdecode.h"
+#include "tcpreasm.h"
+
+#define DEFAULT_THREADS		1
+#define DEFAULT_BATCH_SIZE	256
+#define MAX_THREADS		64
+#define DEFAULT_SNAPLEN		262144
+
+#define REASM_MAX_DATAGRAMS	4096
+#define REASM_MAX_BYTES		(64 * 1024 * 1024)
+#define REASM_TIMEOUT_MS	30000
+#define TCP_MAX_FLOWS		16384
+#define TCP_MAX_BYTES		(256 * 1024 * 1024)
+#define TCP_TIMEOUT_MS		120000
+
+struct packet {
+	struct capfile_rec	rec;
+	uint64_t		count;
+	size_t			out_end;
+	bool			dump;
+	bool			defer;
+};
+
+struct batch {
+	uint64_t		seq;
+	size_t			n_pkts;
+	struct packet		*pkts;
+	ubuf			*out;
+};
+
+struct worker {
+	pthread_t		thr;
+	struct my_queue		*in;
+	struct my_queue		*out;
+};
+
+struct dumper {
+	FILE			*fp;
+	uint16_t		linktype;
+};
+
 static uint64_t count;
 static uint64_t count_dump;
+static uint64_t count_dump_skipped;
+static uint64_t count_reassembled_broken;
 
-#define eth_type_ip	0x0800
-#define eth_type_ipv6	0x86dd
+static unsigned n_threads = DEFAULT_THREADS;
+static unsigned batch_size = DEFAULT_BATCH_SIZE;
+static unsigned n_batches;
 
-#define advance(p, len, sz) do { (p) += (sz); (len) -= (sz); } while (0)
-#define getu16(dst, src) do { memcpy(&(dst), src, 2); dst = ntohs(dst); } while (0)
+static struct worker workers[MAX_THREADS];
+static struct my_queue *free_q;
+static struct batch *cur;
+static uint64_t next_seq;
+static struct ipreasm *reasm;
+static struct tcpreasm *tcpreasm;
 
 static void
-packet_dump(u_char *dumper,
-	    const struct pcap_pkthdr *hdr,
-	    const u_char *pkt)
+backoff(void)
 {
-	pcap_dump(dumper, hdr, pkt);
-	VERBOSE("count=%" PRIu64 " dumping broken packet\n", count);
-	count_dump += 1;
+	static const struct timespec ts = { .tv_sec = 0, .tv_nsec = 50000 };
+	my_nanosleep(&ts);
 }
 
 static void
-packet_handler(u_char *dumper,
-	       const struct pcap_pkthdr *hdr,
-	       const u_char *pkt)
-{
-	const u_char *dns_p, *p;
-	uint16_t e_type;
-	uint16_t ip_len;
-	uint32_t dns_len;
-	uint32_t len = hdr->caplen;
-	uint8_t ihl;
-	wdns_message_t m;
-	wdns_res res;
+queue_put(struct my_queue *q, struct batch *b)
+{
+	while (!my_queue_insert(q, &b, NULL))
+		backoff();
+}
 
-	p = pkt;
-	count++;
+static struct batch *
+queue_get(struct my_queue *q)
+{
+	struct batch *b;
+	while (!my_queue_remove(q, &b, NULL))
+		backoff();
+	return (b);
+}
 
-	VERBOSE("count=%" PRIu64 " parsing packet\n", count);
+#ifdef HAVE_LIBPCAP
 
-	/* ethernet */
-	if (len < 14) {
-		VERBOSE("count=%" PRIu64 " too short for ethernet\n", count);
-		return;
+/* compiled filters, one per link type seen in the input */
+struct filter {
+	uint16_t		linktype;
+	bool			ok;
+	struct bpf_program	prog;
+};
+
+static const char *bpf;
+static struct filter *filters;
+static size_t n_filters;
+
+static struct filter *
+filter_get(uint16_t linktype)
+{
+	struct filter *f;
+	pcap_t *pcap;
+
+	for (size_t i = 0; i < n_filters; i++) {
+		if (filters[i].linktype == linktype)
+			return (&filters[i]);
 	}
-	advance(p, len, 12);
-	getu16(e_type, p);
-	advance(p, len, 2);
-	if (e_type != eth_type_ip) {
-		VERBOSE("count=%" PRIu64 " not IP e_type=%#.x\n", count, e_type);
-		return;
+
+	filters = my_realloc(filters, (n_filters + 1) * sizeof(*filters));
+	f = &filters[n_filters++];
+	f->linktype = linktype;
+	f->ok = false;
+
+	pcap = pcap_open_dead(linktype, DEFAULT_SNAPLEN);
+	if (pcap == NULL)
+		return (f);
+	if (pcap_compile(pcap, &f->prog, bpf, 1, 0) != 0)
+		fprintf(stderr, "pcap_compile: linktype %u: %s\n", linktype, pcap_geterr(pcap));
+	else
+		f->ok = true;
+	pcap_close(pcap);
+	return (f);
+}
+
+static bool
+filter_match(const struct capfile_rec *rec)
+{
+	struct pcap_pkthdr hdr;
+	struct filter *f;
+
+	if (bpf == NULL)
+		return (true);
+	f = filter_get(rec->linktype);
+	if (!f->ok)
+		return (false);
+
+	hdr.ts.tv_sec = rec->ts.tv_sec;
+	hdr.ts.tv_usec = rec->ts.tv_nsec / 1000;
+	hdr.caplen = rec->caplen;
+	hdr.len = rec->len;
+	return (pcap_offline_filter(&f->prog, &hdr, rec->data) != 0);
+}
+
+static void
+filter_destroy(void)
+{
+	for (size_t i = 0; i < n_filters; i++) {
+		if (filters[i].ok)
+			pcap_freecode(&filters[i].prog);
 	}
+	my_free(filters);
+	n_filters = 0;
+}
 
-	/* skip ip */
-	ihl = *p & 0x0f;
-	if (len < ihl * 4U) {
-		VERBOSE("count=%" PRIu64" IP too short\n", count);
+#endif /* HAVE_LIBPCAP */
+
+static bool
+dump_open(struct dumper *d, const char *fname, uint16_t linktype, uint32_t snaplen)
+{
+	struct {
+		uint32_t	magic;
+		uint16_t	version_major;
+		uint16_t	version_minor;
+		int32_t		thiszone;
+		uint32_t	sigfigs;
+		uint32_t	snaplen;
+		uint32_t	linktype;
+	} hdr = {
+		.magic = 0xa1b2c3d4,
+		.version_major = 2,
+		.version_minor = 4,
+		.snaplen = snaplen ? snaplen : DEFAULT_SNAPLEN,
+		.linktype = linktype,
+	};
+
+	d->fp = fopen(fname, "w");
+	if (d->fp == NULL) {
+		perror(fname);
+		return (false);
+	}
+	d->linktype = linktype;
+	fwrite(&hdr, sizeof(hdr), 1, d->fp);
+	return (true);
+}
+
+static void
+dump_packet(struct dumper *d, const struct capfile_rec *rec)
+{
+	uint32_t hdr[4];
+
+	/* a pcap file has a single link type */
+	if (rec->linktype != d->linktype) {
+		count_dump_skipped += 1;
 		return;
 	}
-	getu16(ip_len, p + 2);
-	if (ip_len < len)
-		len = ip_len;
-	advance(p, len, ihl * 4U);
 
-	/* skip udp */
-	if (len < 8) {
-		VERBOSE("count=%" PRIu64" UDP too short\n", count);
+	hdr[0] = rec->ts.tv_sec;
+	hdr[1] = rec->ts.tv_nsec / 1000;
+	hdr[2] = rec->caplen;
+	hdr[3] = rec->len;
+	fwrite(hdr, sizeof(hdr), 1, d->fp);
+	fwrite(rec->data, rec->caplen, 1, d->fp);
+	count_dump += 1;
+}
+
+static void
+process_packet(struct batch *b, struct packet *pk)
+{
+	struct pktdecode d;
+	pktdecode_res pres;
+	wdns_message_t m;
+	wdns_res res;
+
+	VERBOSE("count=%" PRIu64 " parsing packet\n", pk->count);
+
+	pres = pktdecode_frame(pk->rec.linktype, pk->rec.data, pk->rec.caplen, &d);
+	if (pres == pktdecode_res_fragment ||
+	    (pres == pktdecode_res_success && d.proto == PKTDECODE_PROTO_TCP))
+	{
+		pk->defer = true;
+		return;
+	}
+	if (pres != pktdecode_res_success) {
+		VERBOSE("count=%" PRIu64 " %s\n", pk->count, pktdecode_res_to_str(pres));
 		return;
 	}
-	advance(p, len, 8);
 
 	/* dns header */
-	if (len < 12) {
-		VERBOSE("count=%" PRIu64" DNS header too short\n", count);
+	if (d.payload_len < 12) {
+		VERBOSE("count=%" PRIu64" DNS header too short\n", pk->count);
 		return;
 	}
 
-	dns_p = p;
-	dns_len = len;
-
-	res = wdns_parse_message(&m, dns_p, dns_len);
+	res = wdns_parse_message(&m, d.payload, d.payload_len);
 	if (res == wdns_res_success) {
-		wdns_print_message(stdout, &m);
+		char *s = wdns_message_to_str(&m);
+		if (s != NULL) {
+			ubuf_append(b->out, (uint8_t *) s, strlen(s));
+			free(s);
+		}
 		wdns_clear_message(&m);
 	} else {
 		VERBOSE("wdns_res=%u\n", res);
-		packet_dump(dumper, hdr, pkt);
+		pk->dump = true;
 	}
 
 	VERBOSE("\n");
 	return;
 }
 
+static void *
+worker_thread(void *arg)
+{
+	struct worker *w = arg;
+	struct batch *b;
+
+	for (;;) {
+		b = queue_get(w->in);
+		if (b != NULL) {
+			for (size_t i = 0; i < b->n_pkts; i++) {
+				process_packet(b, &b->pkts[i]);
+				b->pkts[i].out_end = ubuf_size(b->out);
+			}
+		}
+		queue_put(w->out, b);
+		if (b == NULL)
+			break;
+	}
+
+	return (NULL);
+}
+
+static void
+print_reassembled(const uint8_t *msg, size_t len, void *user __attribute__((unused)))
+{
+	wdns_message_t m;
+	wdns_res res;
+
+	if (len < 12)
+		return;
+
+	/* the original packets are gone, so a broken message can't be dumped */
+	res = wdns_parse_message(&m, msg, len);
+	if (res == wdns_res_success) {
+		char *s = wdns_message_to_str(&m);
+		if (s != NULL) {
+			fputs(s, stdout);
+			free(s);
+		}
+		wdns_clear_message(&m);
+	} else {
+		VERBOSE("wdns_res=%u\n", res);
+		count_reassembled_broken += 1;
+	}
+}
+
+static void
+process_deferred(struct packet *pk)
+{
+	struct pktdecode d;
+	pktdecode_res pres;
+
+	pres = pktdecode_frame(pk->rec.linktype, pk->rec.data, pk->rec.caplen, &d);
+	if (pres == pktdecode_res_fragment) {
+		if (!ipreasm_add(reasm, &d, &pk->rec.ts))
+			return;
+		VERBOSE("count=%" PRIu64 " reassembled %zd octets\n", pk->count, d.l4_len);
+		pres = pktdecode_transport(&d);
+	}
+	if (pres != pktdecode_res_success)
+		return;
+
+	if (d.proto == PKTDECODE_PROTO_TCP)
+		tcpreasm_add(tcpreasm, &d, &pk->rec.ts);
+	else
+		print_reassembled(d.payload, d.payload_len, NULL);
+}
+
+static void *
+writer_thread(void *arg)
+{
+	struct dumper *dumper = arg;
+	struct batch *b;
+
+	for (uint64_t seq = 0;; seq++) {
+		size_t out_pos = 0;
+
+		b = queue_get(workers[seq % n_threads].out);
+		if (b == NULL)
+			break;
+		assert(b->seq == seq);
+
+		for (size_t i = 0; i < b->n_pkts; i++) {
+			struct packet *pk = &b->pkts[i];
+			if (pk->defer) {
+				fwrite(ubuf_data(b->out) + out_pos, pk->out_end - out_pos, 1, stdout);
+				out_pos = pk->out_end;
+				process_deferred(pk);
+			}
+			if (pk->dump) {
+				VERBOSE("count=%" PRIu64 " dumping broken packet\n", pk->count);
+				dump_packet(dumper, &pk->rec);
+			}
+		}
+		if (ubuf_size(b->out) > out_pos)
+			fwrite(ubuf_data(b->out) + out_pos, ubuf_size(b->out) - out_pos, 1, stdout);
+
+		queue_put(free_q, b);
+	}
+
+	return (NULL);
+}
+
+static void
+batch_send(void)
+{
+	cur->seq = next_seq++;
+	queue_put(workers[cur->seq % n_threads].in, cur);
+	cur = NULL;
+}
+
+static void
+packet_handler(const struct capfile_rec *rec)
+{
+	struct packet *pk;
+
+#ifdef HAVE_LIBPCAP
+	if (!filter_match(rec))
+		return;
+#endif
+
+	count++;
+
+	if (cur == NULL) {
+		cur = queue_get(free_q);
+		cur->n_pkts = 0;
+		ubuf_clip(cur->out, 0);
+	}
+
+	pk = &cur->pkts[cur->n_pkts++];
+	pk->rec = *rec;
+	pk->count = count;
+	pk->dump = false;
+	pk->defer = false;
+
+	if (cur->n_pkts == batch_size)
+		batch_send();
+}
+
+static unsigned
+queue_size(unsigned n)
+{
+	/* a queue of size 2^k holds at most 2^k - 1 elements */
+	unsigned size = 2;
+	while (size < n + 1)
+		size *= 2;
+	return (size);
+}
+
+static bool
+pipeline_init(void)
+{
+	unsigned qsz;
+
+	n_batches = 2 * n_threads + 2;
+	qsz = queue_size(n_batches);
+
+	free_q = my_queue_init(qsz, sizeof(struct batch *));
+	if (free_q == NULL)
+		return (false);
+	for (unsigned i = 0; i < n_batches; i++) {
+		struct batch *b = my_calloc(1, sizeof(*b));
+		b->pkts = my_calloc(batch_size, sizeof(struct packet));
+		b->out = ubuf_init(batch_size * 512);
+		queue_put(free_q, b);
+	}
+
+	for (unsigned i = 0; i < n_threads; i++) {
+		workers[i].in = my_queue_init(qsz, sizeof(struct batch *));
+		workers[i].out = my_queue_init(qsz, sizeof(struct batch *));
+		if (workers[i].in == NULL || workers[i].out == NULL)
+			return (false);
+	}
+
+	return (true);
+}
+
+static void
+pipeline_destroy(void)
+{
+	struct batch *b;
+
+	while (my_queue_remove(free_q, &b, NULL)) {
+		free(b->pkts);
+		ubuf_destroy(&b->out);
+		free(b);
+	}
+	my_queue_destroy(&free_q);
+
+	for (unsigned i = 0; i < n_threads; i++) {
+		my_queue_destroy(&workers[i].in);
+		my_queue_destroy(&workers[i].out);
+	}
+}
+
+static void
+usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [-t <THREADS>] [-b <BATCHSIZE>] <INFILE> <OUTFILE> [<BPF>]\n"
+		"\n"
+		"  -t <THREADS>    number of parse/format threads (default %u, max %u)\n"
+		"  -b <BATCHSIZE>  packets handed to a thread at a time (default %u)\n"
+		"\n"
+		"INFILE may be in pcap or pcapng format. OUTFILE receives the packets\n"
+		"that failed to parse, in pcap format. A BPF filter requires libpcap.\n",
+		argv0, DEFAULT_THREADS, MAX_THREADS, DEFAULT_BATCH_SIZE);
+}
+
 int
 main(int argc, char **argv) {
-	pcap_t *pcap;
-	pcap_dumper_t *dumper = NULL;
-	char errbuf[PCAP_ERRBUF_SIZE];
-	struct bpf_program bpfp;
+	struct capfile *cf;
+	struct capfile_rec rec;
+	struct dumper dumper;
+	struct ipreasm_stats reasm_stats;
+	struct tcpreasm_stats tcp_stats;
+	char errbuf[256];
+	pthread_t writer;
+	bool have_rec;
+	int c;
+
+	while ((c = getopt(argc, argv, "t:b:")) != -1) {
+		switch (c) {
+		case 't':
+			n_threads = strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			batch_size = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+			return (EXIT_FAILURE);
+		}
+	}
 
-	if (argc != 4) {
-		fprintf(stderr, "Usage: %s <INFILE> <OUTFILE> <BPF>\n", argv[0]);
+	if (argc - optind < 2 || argc - optind > 3 ||
+	    n_threads < 1 || n_threads > MAX_THREADS || batch_size < 1)
+	{
+		usage(argv[0]);
 		return (EXIT_FAILURE);
 	}
+	argv += optind - 1;
+	argc -= optind - 1;
 
-	pcap = pcap_open_offline(argv[1], errbuf);
-	if (pcap == NULL) {
-		fprintf(stderr, "pcap_open_offline() failed: %s\n", errbuf);
+	if (argc == 4) {
+#ifdef HAVE_LIBPCAP
+		bpf = argv[3];
+#else
+		fprintf(stderr, "Error: BPF filters are not supported without libpcap\n");
 		return (EXIT_FAILURE);
+#endif
 	}
 
-	dumper = pcap_dump_open(pcap, argv[2]);
-	if (dumper == NULL) {
-		pcap_perror(pcap, "pcap_dump_open:");
+	cf = capfile_open(argv[1], errbuf, sizeof(errbuf));
+	if (cf == NULL) {
+		fprintf(stderr, "capfile_open() failed: %s\n", errbuf);
 		return (EXIT_FAILURE);
 	}
 
-	if (pcap_compile(pcap, &bpfp, argv[3], 1, 0) != 0) {
-		pcap_perror(pcap, "pcap_compile:");
-		pcap_close(pcap);
-		pcap_dump_close(dumper);
+	/* the dump file takes the link type of the first packet */
+	have_rec = capfile_next(cf, &rec);
+	if (!dump_open(&dumper, argv[2],
+		       have_rec ? rec.linktype : CAPFILE_LINKTYPE_ETHERNET,
+		       have_rec ? rec.snaplen : DEFAULT_SNAPLEN))
+	{
+		capfile_close(&cf);
 		return (EXIT_FAILURE);
-	} else {
-		if (pcap_setfilter(pcap, &bpfp) != 0) {
-			pcap_perror(pcap, "pcap_setfilter:");
-			pcap_close(pcap);
-			pcap_dump_close(dumper);
-			return (EXIT_FAILURE);
-		}
-		pcap_freecode(&bpfp);
 	}
 
-	pcap_loop(pcap, -1, packet_handler, (u_char *) dumper);
-	pcap_close(pcap);
-	pcap_dump_close(dumper);
+	reasm = ipreasm_init(REASM_MAX_DATAGRAMS, REASM_MAX_BYTES, REASM_TIMEOUT_MS);
+	tcpreasm = tcpreasm_init(TCP_MAX_FLOWS, TCP_MAX_BYTES, TCP_TIMEOUT_MS,
+				 print_reassembled, NULL);
+
+	if (!pipeline_init()) {
+		fprintf(stderr, "Error: unable to initialize queues\n");
+		return (EXIT_FAILURE);
+	}
+	for (unsigned i = 0; i < n_threads; i++)
+		pthread_create(&workers[i].thr, NULL, worker_thread, &workers[i]);
+	pthread_create(&writer, NULL, writer_thread, &dumper);
+
+	while (have_rec) {
+		packet_handler(&rec);
+		have_rec = capfile_next(cf, &rec);
+	}
+	if (capfile_error(cf) != NULL)
+		fprintf(stderr, "%s: %s\n", argv[1], capfile_error(cf));
+
+	/* flush the last partial batch, then shut down each worker in turn */
+	if (cur != NULL)
+		batch_send();
+	for (unsigned i = 0; i < n_threads; i++)
+		queue_put(workers[i].in, NULL);
+	for (unsigned i = 0; i < n_threads; i++)
+		pthread_join(workers[i].thr, NULL);
+	pthread_join(writer, NULL);
+	pipeline_destroy();
+	ipreasm_get_stats(reasm, &reasm_stats);
+	ipreasm_destroy(&reasm);
+	tcpreasm_get_stats(tcpreasm, &tcp_stats);
+	tcpreasm_destroy(&tcpreasm);
+
+#ifdef HAVE_LIBPCAP
+	filter_destroy();
+#endif
+	capfile_close(&cf);
+	fclose(dumper.fp);
 
 	fprintf(stderr, "count=%" PRIu64 "\n", count);
 	fprintf(stderr, "count_dump=%" PRIu64 "\n", count_dump);
+	if (count_dump_skipped > 0)
+		fprintf(stderr, "count_dump_skipped=%" PRIu64 "\n", count_dump_skipped);
+	if (reasm_stats.n_complete + reasm_stats.n_timeout +
+	    reasm_stats.n_evicted + reasm_stats.n_invalid > 0)
+	{
+		fprintf(stderr, "count_reassembled=%" PRIu64 "\n", reasm_stats.n_complete);
+		fprintf(stderr, "count_frag_timeout=%" PRIu64 "\n", reasm_stats.n_timeout);
+		fprintf(stderr, "count_frag_evicted=%" PRIu64 "\n", reasm_stats.n_evicted);
+		fprintf(stderr, "count_frag_invalid=%" PRIu64 "\n", reasm_stats.n_invalid);
+	}
+	if (tcp_stats.n_messages + tcp_stats.n_timeout +
+	    tcp_stats.n_evicted + tcp_stats.n_abandoned > 0)
+	{
+		fprintf(stderr, "count_tcp_messages=%" PRIu64 "\n", tcp_stats.n_messages);
+		fprintf(stderr, "count_tcp_timeout=%" PRIu64 "\n", tcp_stats.n_timeout);
+		fprintf(stderr, "count_tcp_evicted=%" PRIu64 "\n", tcp_stats.n_evicted);
+		fprintf(stderr, "count_tcp_abandoned=%" PRIu64 "\n", tcp_stats.n_abandoned);
+	}
+	if (count_reassembled_broken > 0)
+		fprintf(stderr, "count_reassembled_broken=%" PRIu64 "\n", count_reassembled_broken);
 
 	return (EXIT_SUCCESS);
 }
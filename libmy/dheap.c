@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2012 by Farsight Security, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "my_alloc.h"
+#include "dheap.h"
+
+#define ARITY		4
+#define CACHE_LINE	64
+
+/*
+ * Heap position pos is stored at entries[pos + PAD]. With 16 byte entries
+ * and a cache line aligned array, the children 4 * pos + 1 .. 4 * pos + 4 of
+ * every node then fill exactly one cache line.
+ */
+#define PAD		(ARITY - 1)
+
+#define NO_SLOT		UINT32_MAX
+
+struct dheap_entry {
+	uint64_t		key;
+	dheap_handle		handle;
+};
+
+struct dheap_slot {
+	void			*value;
+	uint32_t		pos;	/* heap position, or next free slot */
+};
+
+struct dheap {
+	struct dheap_entry	*entries;
+	size_t			n_entries;
+	size_t			alloc_entries;
+	struct dheap_slot	*slots;
+	uint32_t		n_slots;
+	uint32_t		free_slot;
+};
+
+#define E(h, pos)	((h)->entries[(pos) + PAD])
+
+struct dheap *
+dheap_init(void)
+{
+	struct dheap *h = my_calloc(1, sizeof(*h));
+	h->free_slot = NO_SLOT;
+	return (h);
+}
+
+void
+dheap_destroy(struct dheap **h)
+{
+	if (*h != NULL) {
+		free((*h)->entries);
+		free((*h)->slots);
+		free(*h);
+		*h = NULL;
+	}
+}
+
+static void
+grow(struct dheap *h)
+{
+	size_t alloc = h->alloc_entries ? 2 * h->alloc_entries : 64;
+	void *entries;
+	int rc = posix_memalign(&entries, CACHE_LINE,
+				(alloc + PAD) * sizeof(struct dheap_entry));
+	assert(rc == 0);
+	if (h->entries != NULL) {
+		memcpy((struct dheap_entry *) entries + PAD, h->entries + PAD,
+		       h->n_entries * sizeof(struct dheap_entry));
+		free(h->entries);
+	}
+	h->entries = entries;
+	h->alloc_entries = alloc;
+
+	/* every element has a slot, so the slot array never outgrows this */
+	h->slots = my_realloc(h->slots, alloc * sizeof(struct dheap_slot));
+}
+
+static inline void
+place(struct dheap *h, size_t pos, struct dheap_entry e)
+{
+	E(h, pos) = e;
+	h->slots[e.handle].pos = pos;
+}
+
+static void
+sift_up(struct dheap *h, size_t pos)
+{
+	struct dheap_entry e = E(h, pos);
+	while (pos > 0) {
+		size_t parent = (pos - 1) / ARITY;
+		if (E(h, parent).key <= e.key)
+			break;
+		place(h, pos, E(h, parent));
+		pos = parent;
+	}
+	place(h, pos, e);
+}
+
+static void
+sift_down(struct dheap *h, size_t pos)
+{
+	struct dheap_entry e = E(h, pos);
+	for (;;) {
+		size_t child = ARITY * pos + 1;
+		if (child >= h->n_entries)
+			break;
+		size_t end = child + ARITY < h->n_entries ? child + ARITY : h->n_entries;
+		size_t min = child;
+		for (size_t i = child + 1; i < end; i++) {
+			if (E(h, i).key < E(h, min).key)
+				min = i;
+		}
+		if (E(h, min).key >= e.key)
+			break;
+		place(h, pos, E(h, min));
+		pos = min;
+	}
+	place(h, pos, e);
+}
+
+/* Remove the element at pos, returning its value and freeing its handle. */
+static void *
+remove_at(struct dheap *h, size_t pos)
+{
+	dheap_handle handle = E(h, pos).handle;
+	void *value = h->slots[handle].value;
+
+	h->n_entries--;
+	if (pos != h->n_entries) {
+		uint64_t key = E(h, pos).key;
+		place(h, pos, E(h, h->n_entries));
+		if (E(h, pos).key < key)
+			sift_up(h, pos);
+		else
+			sift_down(h, pos);
+	}
+
+	h->slots[handle].value = NULL;
+	h->slots[handle].pos = h->free_slot;
+	h->free_slot = handle;
+	return (value);
+}
+
+dheap_handle
+dheap_push(struct dheap *h, uint64_t key, void *value)
+{
+	dheap_handle handle;
+
+	if (h->n_entries == h->alloc_entries)
+		grow(h);
+
+	if (h->free_slot != NO_SLOT) {
+		handle = h->free_slot;
+		h->free_slot = h->slots[handle].pos;
+	} else {
+		handle = h->n_slots++;
+	}
+	h->slots[handle].value = value;
+
+	E(h, h->n_entries).key = key;
+	E(h, h->n_entries).handle = handle;
+	h->n_entries++;
+	sift_up(h, h->n_entries - 1);
+	return (handle);
+}
+
+void *
+dheap_pop(struct dheap *h, uint64_t *key)
+{
+	if (h->n_entries == 0)
+		return (NULL);
+	if (key != NULL)
+		*key = E(h, 0).key;
+	return (remove_at(h, 0));
+}
+
+void *
+dheap_peek(struct dheap *h, uint64_t *key)
+{
+	if (h->n_entries == 0)
+		return (NULL);
+	if (key != NULL)
+		*key = E(h, 0).key;
+	return (h->slots[E(h, 0).handle].value);
+}
+
+void
+dheap_update(struct dheap *h, dheap_handle handle, uint64_t key)
+{
+	assert(handle < h->n_slots);
+	size_t pos = h->slots[handle].pos;
+	assert(pos < h->n_entries && E(h, pos).handle == handle);
+
+	uint64_t old = E(h, pos).key;
+	E(h, pos).key = key;
+	if (key < old)
+		sift_up(h, pos);
+	else if (key > old)
+		sift_down(h, pos);
+}
+
+void *
+dheap_remove(struct dheap *h, dheap_handle handle)
+{
+	assert(handle < h->n_slots);
+	size_t pos = h->slots[handle].pos;
+	assert(pos < h->n_entries && E(h, pos).handle == handle);
+	return (remove_at(h, pos));
+}
+
+uint64_t
+dheap_key(struct dheap *h, dheap_handle handle)
+{
+	assert(handle < h->n_slots);
+	return (E(h, h->slots[handle].pos).key);
+}
+
+void *
+dheap_value(struct dheap *h, dheap_handle handle)
+{
+	assert(handle < h->n_slots);
+	return (h->slots[handle].value);
+}
+
+size_t
+dheap_size(struct dheap *h)
+{
+	return (h->n_entries);
+}
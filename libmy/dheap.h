@@ -0,0 +1,33 @@
+#ifndef MY_DHEAP_H
+#define MY_DHEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 4-ary min-heap of uint64_t keys.
+ *
+ * Unlike struct heap, the keys are stored inline in the heap array and
+ * compared directly, and the four children of a node share one cache line.
+ * Each pushed element gets a stable handle that stays valid until the
+ * element is popped or removed, and can be used to change its key or remove
+ * it from the middle of the heap. Handles of popped or removed elements are
+ * reused.
+ */
+
+struct dheap;
+
+typedef uint32_t dheap_handle;
+
+struct dheap *dheap_init(void);
+void dheap_destroy(struct dheap **);
+dheap_handle dheap_push(struct dheap *, uint64_t key, void *value);
+void *dheap_pop(struct dheap *, uint64_t *key);
+void *dheap_peek(struct dheap *, uint64_t *key);
+void dheap_update(struct dheap *, dheap_handle, uint64_t key);
+void *dheap_remove(struct dheap *, dheap_handle);
+uint64_t dheap_key(struct dheap *, dheap_handle);
+void *dheap_value(struct dheap *, dheap_handle);
+size_t dheap_size(struct dheap *);
+
+#endif /* MY_DHEAP_H */
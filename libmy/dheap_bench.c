@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2012 by Farsight Security, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark of struct dheap against struct heap.
+ *
+ * Usage: dheap_bench [<elements> [<operations>]]
+ *
+ * "fill/drain" pushes the elements with random keys and pops them all.
+ * "reschedule" keeps the elements in the heap and repeatedly moves the
+ * minimum to a later key, as a timer queue does: struct heap pops and
+ * pushes it again, struct dheap updates its key in place. "random update"
+ * changes the key of a random element, which only struct dheap supports.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "my_alloc.h"
+#include "my_time.h"
+#include "dheap.h"
+#include "heap.h"
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static inline uint64_t
+rng(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return (rng_state);
+}
+
+struct item {
+	uint64_t	key;
+};
+
+static int
+item_cmp(const void *a, const void *b)
+{
+	const struct item *ia = a, *ib = b;
+	if (ia->key < ib->key)
+		return (-1);
+	return (ia->key > ib->key);
+}
+
+static struct timespec start_ts;
+
+static void
+start(void)
+{
+	my_gettime(CLOCK_MONOTONIC, &start_ts);
+}
+
+static void
+stop(const char *impl, const char *test, size_t n_ops, uint64_t check)
+{
+	struct timespec ts;
+	my_gettime(CLOCK_MONOTONIC, &ts);
+	my_timespec_sub(&start_ts, &ts);
+	printf("%-8s %-16s %12.0f ops/s  (check %016llx)\n", impl, test,
+	       n_ops / my_timespec_to_double(&ts), (unsigned long long) check);
+}
+
+static void
+bench_heap(size_t n, size_t n_ops)
+{
+	struct item *items = my_calloc(n, sizeof(*items));
+	struct heap *h = heap_init(item_cmp);
+	uint64_t check = 0;
+	struct item *it;
+
+	rng_state = 88172645463325252ULL;
+	start();
+	for (size_t i = 0; i < n; i++) {
+		items[i].key = rng();
+		heap_push(h, &items[i]);
+	}
+	while ((it = heap_pop(h)) != NULL)
+		check += it->key;
+	stop("heap", "fill/drain", 2 * n, check);
+
+	for (size_t i = 0; i < n; i++) {
+		items[i].key = rng() % n;
+		heap_push(h, &items[i]);
+	}
+	check = 0;
+	start();
+	for (size_t i = 0; i < n_ops; i++) {
+		it = heap_pop(h);
+		check += it->key;
+		it->key += 1 + rng() % n;
+		heap_push(h, it);
+	}
+	stop("heap", "reschedule", n_ops, check);
+
+	heap_destroy(&h);
+	free(items);
+}
+
+static void
+bench_dheap(size_t n, size_t n_ops)
+{
+	dheap_handle *handles = my_calloc(n, sizeof(*handles));
+	struct dheap *h = dheap_init();
+	uint64_t check = 0, key;
+	dheap_handle handle;
+
+	rng_state = 88172645463325252ULL;
+	start();
+	for (size_t i = 0; i < n; i++)
+		dheap_push(h, rng(), NULL);
+	while (dheap_size(h) > 0) {
+		dheap_pop(h, &key);
+		check += key;
+	}
+	stop("dheap", "fill/drain", 2 * n, check);
+
+	for (size_t i = 0; i < n; i++)
+		handles[i] = dheap_push(h, rng() % n, &handles[i]);
+	check = 0;
+	start();
+	for (size_t i = 0; i < n_ops; i++) {
+		dheap_handle *hp = dheap_peek(h, &key);
+		check += key;
+		dheap_update(h, *hp, key + 1 + rng() % n);
+	}
+	stop("dheap", "reschedule", n_ops, check);
+
+	check = 0;
+	start();
+	for (size_t i = 0; i < n_ops; i++) {
+		handle = handles[rng() % n];
+		check += dheap_key(h, handle);
+		dheap_update(h, handle, rng() % (2 * n));
+	}
+	stop("dheap", "random update", n_ops, check);
+
+	dheap_destroy(&h);
+	free(handles);
+}
+
+int
+main(int argc, char **argv)
+{
+	size_t n = 100000;
+	size_t n_ops = 1000000;
+
+	if (argc > 1)
+		n = strtoul(argv[1], NULL, 0);
+	if (argc > 2)
+		n_ops = strtoul(argv[2], NULL, 0);
+	if (n == 0)
+		n = 1;
+
+	bench_heap(n, n_ops);
+	bench_dheap(n, n_ops);
+
+	return (EXIT_SUCCESS);
+}
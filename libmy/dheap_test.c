@@ -0,0 +1,135 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dheap.h"
+
+/*
+ * Random pushes, pops, key updates and removals, checked against a flat
+ * array of the live elements indexed by handle.
+ */
+
+#define NUM_OPS		100000
+#define MAX_HANDLES	1024
+
+struct model {
+	bool		live;
+	uint64_t	key;
+	uintptr_t	id;
+};
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t
+rng(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return (rng_state);
+}
+
+static struct model model[MAX_HANDLES];
+static size_t n_live;
+static uintptr_t next_id = 1;
+
+static bool
+model_min(uint64_t *key)
+{
+	bool found = false;
+	for (size_t i = 0; i < MAX_HANDLES; i++) {
+		if (model[i].live && (!found || model[i].key < *key)) {
+			*key = model[i].key;
+			found = true;
+		}
+	}
+	return (found);
+}
+
+/* Pick a random live handle. */
+static dheap_handle
+model_pick(void)
+{
+	dheap_handle i = rng() % MAX_HANDLES;
+	while (!model[i].live)
+		i = (i + 1) % MAX_HANDLES;
+	return (i);
+}
+
+int
+main(void) {
+	struct dheap *h = dheap_init();
+	bool ok = true;
+
+	for (unsigned op = 0; op < NUM_OPS && ok; op++) {
+		unsigned r = rng() % 8;
+		uint64_t key, min;
+		dheap_handle i;
+		void *value;
+
+		/* keep the heap between empty and MAX_HANDLES - 1 elements */
+		if (n_live == 0 || (r < 4 && n_live < MAX_HANDLES - 1)) {
+			key = rng() % 1000;
+			i = dheap_push(h, key, (void *) next_id);
+			if (i >= MAX_HANDLES || model[i].live) {
+				ok = false;
+				break;
+			}
+			model[i].live = true;
+			model[i].key = key;
+			model[i].id = next_id++;
+			n_live++;
+		} else if (r < 6) {
+			model_min(&min);
+			value = dheap_pop(h, &key);
+			/* several elements may share the minimum key */
+			for (i = 0; i < MAX_HANDLES; i++) {
+				if (model[i].live && model[i].id == (uintptr_t) value)
+					break;
+			}
+			if (i == MAX_HANDLES || key != min || model[i].key != key) {
+				ok = false;
+				break;
+			}
+			model[i].live = false;
+			n_live--;
+		} else if (r < 7) {
+			i = model_pick();
+			key = rng() % 1000;
+			dheap_update(h, i, key);
+			model[i].key = key;
+			if (dheap_key(h, i) != key)
+				ok = false;
+		} else {
+			i = model_pick();
+			if (dheap_value(h, i) != (void *) model[i].id ||
+			    dheap_remove(h, i) != (void *) model[i].id)
+				ok = false;
+			model[i].live = false;
+			n_live--;
+		}
+
+		if (dheap_size(h) != n_live)
+			ok = false;
+		if (n_live > 0 && (!model_min(&min) ||
+				   dheap_peek(h, &key) == NULL || key != min))
+			ok = false;
+	}
+
+	/* the remaining elements come out in order */
+	uint64_t key, last = 0;
+	while (ok && dheap_pop(h, &key) != NULL) {
+		if (key < last)
+			ok = false;
+		last = key;
+		n_live--;
+	}
+	if (n_live != 0 || dheap_size(h) != 0)
+		ok = false;
+
+	dheap_destroy(&h);
+
+	fprintf(stderr, "dheap_test: %s\n", ok ? "PASS" : "FAIL");
+	return (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
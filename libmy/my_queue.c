@@ -22,6 +22,10 @@
 # define my_queue_mb_impl_type		my_queue_impl_type
 # define my_queue_mb_insert		my_queue_insert
 # define my_queue_mb_remove		my_queue_remove
+# define my_queue_mb_insert_batch	my_queue_insert_batch
+# define my_queue_mb_remove_batch	my_queue_remove_batch
+# define my_queue_mb_insert_wait	my_queue_insert_wait
+# define my_queue_mb_remove_wait	my_queue_remove_wait
 # include "my_queue_mb.c"
 #else
 # define my_queue_mutex_init		my_queue_init
@@ -29,5 +33,9 @@
 # define my_queue_mutex_impl_type	my_queue_impl_type
 # define my_queue_mutex_insert		my_queue_insert
 # define my_queue_mutex_remove		my_queue_remove
+# define my_queue_mutex_insert_batch	my_queue_insert_batch
+# define my_queue_mutex_remove_batch	my_queue_remove_batch
+# define my_queue_mutex_insert_wait	my_queue_insert_wait
+# define my_queue_mutex_remove_wait	my_queue_remove_wait
 # include "my_queue_mutex.c"
 #endif
@@ -35,6 +35,24 @@
  * coordination between producer and consumer, for instance a consumer thread
  * that sleeps when the queue is empty and is woken by the producer when it
  * adds an element to an empty queue.
+ *
+ * my_queue_insert_wait() and my_queue_remove_wait() are blocking variants
+ * that wait, up to a timeout, for space or for an element. A waiting thread
+ * spins briefly and then sleeps (on a futex, on Linux). The non-blocking
+ * operations only wake sleeping threads when they move the queue out of the
+ * empty or full state. Supporting waiters is not free: the operations that
+ * may have to wake a thread issue a full memory barrier first. The mutex
+ * queue does so only on such a transition, the memory barrier queue on
+ * inserts into an empty queue and on every remove, and the lock-free queue
+ * on every operation. A consumer waiting on the memory barrier queue wakes
+ * at least once a millisecond to recheck it.
+ *
+ * Each implementation exports its functions through a struct my_queue_ops:
+ * my_queue_mb_ops (memory barriers, single-producer / single-consumer only),
+ * my_queue_mutex_ops (pthread mutex) and my_queue_vyukov_ops (lock-free,
+ * multi-producer / multi-consumer). The latter two may be shared by any
+ * number of producer and consumer threads; for the lock-free queue the
+ * returned space and count are estimates when other threads are active.
  */
 
 struct my_queue;
@@ -87,12 +105,78 @@ my_queue_insert(struct my_queue *q, void *elem, unsigned *space);
 bool
 my_queue_remove(struct my_queue *q, void *elem, unsigned *count);
 
+/**
+ * Insert up to n elements into the queue.
+ *
+ * The elements are inserted in order and published together, with a single
+ * index update or lock acquisition, which amortizes the synchronization cost
+ * of my_queue_insert() over the batch.
+ *
+ * \param[in] q Queue object.
+ * \param[in] elems Array of n element objects.
+ * \param[in] n Number of elements to insert.
+ * \param[out] space If non-NULL, pointer to store the number of remaining
+ *	spaces in the queue.
+ * \return Number of elements inserted, which is less than n if the queue
+ *	filled up.
+ */
+unsigned
+my_queue_insert_batch(struct my_queue *q, void *elems, unsigned n, unsigned *space);
+
+/**
+ * Remove up to n elements from the queue.
+ *
+ * \param[in] q Queue object.
+ * \param[out] elems Array where up to n element objects will be copied.
+ * \param[in] n Maximum number of elements to remove.
+ * \param[out] count If non-NULL, pointer to store the count of elements
+ *	remaining in the queue.
+ * \return Number of elements removed, which is less than n if the queue
+ *	emptied.
+ */
+unsigned
+my_queue_remove_batch(struct my_queue *q, void *elems, unsigned n, unsigned *count);
+
+/**
+ * Insert an element into the queue, waiting for space if the queue is full.
+ *
+ * \param[in] q Queue object.
+ * \param[in] elem Element object.
+ * \param[in] timeout_ms Maximum time to wait in milliseconds, or a negative
+ *	value to wait indefinitely.
+ * \param[out] space If non-NULL, pointer to store the number of remaining
+ *	spaces in the queue.
+ * \return true if the element was inserted into the queue,
+ *	false if the queue stayed full until the timeout expired.
+ */
+bool
+my_queue_insert_wait(struct my_queue *q, void *elem, int timeout_ms, unsigned *space);
+
+/**
+ * Remove an element from the queue, waiting for one if the queue is empty.
+ *
+ * \param[in] q Queue object.
+ * \param[out] elem Where the element object will be copied.
+ * \param[in] timeout_ms Maximum time to wait in milliseconds, or a negative
+ *	value to wait indefinitely.
+ * \param[out] count If non-NULL, pointer to store the count of elements
+ *	remaining in the queue.
+ * \return true if an element was removed from the queue,
+ *	false if the queue stayed empty until the timeout expired.
+ */
+bool
+my_queue_remove_wait(struct my_queue *q, void *elem, int timeout_ms, unsigned *count);
+
 struct my_queue_ops {
 	struct my_queue *(*init)(unsigned, unsigned);
 	void (*destroy)(struct my_queue **);
 	const char *(*impl_type)(void);
 	bool (*insert)(struct my_queue *, void *, unsigned *);
 	bool (*remove)(struct my_queue *, void *, unsigned *);
+	unsigned (*insert_batch)(struct my_queue *, void *, unsigned, unsigned *);
+	unsigned (*remove_batch)(struct my_queue *, void *, unsigned, unsigned *);
+	bool (*insert_wait)(struct my_queue *, void *, int, unsigned *);
+	bool (*remove_wait)(struct my_queue *, void *, int, unsigned *);
 };
 
 #endif /* MY_QUEUE_H */
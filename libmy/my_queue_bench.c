@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2013, 2014 by Farsight Security, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Contention benchmark for the my_queue implementations.
+ *
+ * Usage: my_queue_bench [<items per producer> [<queue size> [<batch size>]]]
+ *
+ * For each implementation and each producer / consumer thread count it
+ * supports, the producers insert their items and the consumers remove them,
+ * both spinning when the queue is full or empty. Every item is checked to be
+ * removed exactly once, and the throughput in items per second is reported.
+ * With a batch size greater than one, items are moved with the batch
+ * operations, up to that many at a time.
+ * The memory barrier implementation only supports one producer and one
+ * consumer.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "my_alloc.h"
+#include "my_memory_barrier.h"
+#include "my_queue.h"
+#include "my_time.h"
+
+#ifdef MY_HAVE_MEMORY_BARRIERS
+extern const struct my_queue_ops my_queue_mb_ops;
+#endif
+extern const struct my_queue_ops my_queue_mutex_ops;
+#if defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+extern const struct my_queue_ops my_queue_vyukov_ops;
+#endif
+
+static const struct {
+	const struct my_queue_ops	*ops;
+	bool				mpmc;
+} impls[] = {
+#ifdef MY_HAVE_MEMORY_BARRIERS
+	{ &my_queue_mb_ops,	false },
+#endif
+	{ &my_queue_mutex_ops,	true },
+#if defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+	{ &my_queue_vyukov_ops,	true },
+#endif
+};
+
+static const unsigned n_threads[] = { 1, 2, 4, 8 };
+
+struct bench {
+	const struct my_queue_ops	*ops;
+	struct my_queue			*q;
+	uint64_t			n_items;
+	unsigned			batch;
+	uint64_t			n_total;
+	uint64_t			n_removed;
+	uint64_t			sum;
+};
+
+struct producer {
+	struct bench			*b;
+	uint64_t			first;
+	pthread_t			thr;
+};
+
+static void *
+producer_thread(void *arg)
+{
+	struct producer *p = arg;
+	struct bench *b = p->b;
+
+	if (b->batch > 1) {
+		uint64_t *items = my_calloc(b->batch, sizeof(*items));
+		uint64_t i = p->first, end = p->first + b->n_items;
+		while (i < end) {
+			unsigned n = end - i < b->batch ? end - i : b->batch;
+			for (unsigned j = 0; j < n; j++)
+				items[j] = i + j;
+			unsigned k = b->ops->insert_batch(b->q, items, n, NULL);
+			if (k == 0)
+				sched_yield();
+			i += k;
+		}
+		free(items);
+		return (NULL);
+	}
+
+	for (uint64_t i = p->first; i < p->first + b->n_items; i++) {
+		while (!b->ops->insert(b->q, &i, NULL))
+			sched_yield();
+	}
+	return (NULL);
+}
+
+static void *
+consumer_thread(void *arg)
+{
+	struct bench *b = arg;
+	uint64_t item, sum = 0;
+
+	if (b->batch > 1) {
+		uint64_t *items = my_calloc(b->batch, sizeof(*items));
+		while (__sync_fetch_and_add(&b->n_removed, 0) < b->n_total) {
+			unsigned k = b->ops->remove_batch(b->q, items, b->batch, NULL);
+			if (k == 0) {
+				sched_yield();
+				continue;
+			}
+			for (unsigned j = 0; j < k; j++)
+				sum += items[j];
+			__sync_fetch_and_add(&b->n_removed, k);
+		}
+		free(items);
+		__sync_fetch_and_add(&b->sum, sum);
+		return (NULL);
+	}
+
+	while (__sync_fetch_and_add(&b->n_removed, 0) < b->n_total) {
+		if (!b->ops->remove(b->q, &item, NULL)) {
+			sched_yield();
+			continue;
+		}
+		sum += item;
+		__sync_fetch_and_add(&b->n_removed, 1);
+	}
+	__sync_fetch_and_add(&b->sum, sum);
+	return (NULL);
+}
+
+static bool
+run(const struct my_queue_ops *ops, unsigned n_prod, unsigned n_cons,
+    uint64_t n_items, unsigned qsize, unsigned batch)
+{
+	struct bench b = {
+		.ops = ops,
+		.n_items = n_items,
+		.batch = batch,
+		.n_total = n_prod * n_items,
+	};
+	struct producer *prod = my_calloc(n_prod, sizeof(*prod));
+	pthread_t *cons = my_calloc(n_cons, sizeof(*cons));
+	struct timespec start, end;
+	double elapsed;
+	bool ok;
+
+	b.q = ops->init(qsize, sizeof(uint64_t));
+	if (b.q == NULL) {
+		fprintf(stderr, "%s: unable to create a queue of size %u\n",
+			ops->impl_type(), qsize);
+		exit(EXIT_FAILURE);
+	}
+
+	my_gettime(CLOCK_MONOTONIC, &start);
+	for (unsigned i = 0; i < n_cons; i++)
+		pthread_create(&cons[i], NULL, consumer_thread, &b);
+	for (unsigned i = 0; i < n_prod; i++) {
+		prod[i].b = &b;
+		prod[i].first = i * n_items;
+		pthread_create(&prod[i].thr, NULL, producer_thread, &prod[i]);
+	}
+	for (unsigned i = 0; i < n_prod; i++)
+		pthread_join(prod[i].thr, NULL);
+	for (unsigned i = 0; i < n_cons; i++)
+		pthread_join(cons[i], NULL);
+	my_gettime(CLOCK_MONOTONIC, &end);
+
+	my_timespec_sub(&start, &end);
+	elapsed = my_timespec_to_double(&end);
+
+	/* the items are 0 .. n_total - 1, each removed once */
+	ok = b.n_removed == b.n_total && b.sum == b.n_total * (b.n_total - 1) / 2;
+	printf("%-16s %2uP/%2uC batch %4u %12.0f items/s%s\n", ops->impl_type(),
+	       n_prod, n_cons, batch, b.n_total / elapsed,
+	       ok ? "" : "  ITEMS LOST OR DUPLICATED");
+
+	ops->destroy(&b.q);
+	free(prod);
+	free(cons);
+	return (ok);
+}
+
+int
+main(int argc, char **argv)
+{
+	uint64_t n_items = 1000000;
+	unsigned qsize = 1024;
+	unsigned batch = 1;
+	bool ok = true;
+
+	if (argc > 1)
+		n_items = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		qsize = strtoul(argv[2], NULL, 0);
+	if (argc > 3)
+		batch = strtoul(argv[3], NULL, 0);
+	if (batch == 0)
+		batch = 1;
+
+	for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+		for (size_t j = 0; j < sizeof(n_threads) / sizeof(n_threads[0]); j++) {
+			if (n_threads[j] > 1 && !impls[i].mpmc)
+				break;
+			ok &= run(impls[i].ops, n_threads[j], n_threads[j], n_items, qsize, batch);
+		}
+	}
+
+	return (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
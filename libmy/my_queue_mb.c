@@ -25,9 +25,13 @@
 #include "my_alloc.h"
 
 #include "my_queue.h"
+#include "my_queue_wait.h"
 
 #define MY_ACCESS_ONCE(x) (*(volatile typeof(x) *)&(x))
 
+/* Longest sleep of a consumer waiting for an element, see q_publish_head(). */
+#define MB_MAX_SLEEP_MS 1
+
 struct my_queue *
 my_queue_mb_init(unsigned, unsigned);
 
@@ -43,12 +47,26 @@ my_queue_mb_insert(struct my_queue *, void *, unsigned *);
 bool
 my_queue_mb_remove(struct my_queue *, void *, unsigned *);
 
+unsigned
+my_queue_mb_insert_batch(struct my_queue *, void *, unsigned, unsigned *);
+
+unsigned
+my_queue_mb_remove_batch(struct my_queue *, void *, unsigned, unsigned *);
+
+bool
+my_queue_mb_insert_wait(struct my_queue *, void *, int, unsigned *);
+
+bool
+my_queue_mb_remove_wait(struct my_queue *, void *, int, unsigned *);
+
 struct my_queue {
-	uint8_t		*data;
-	unsigned	num_elems;
-	unsigned	sizeof_elem;
-	unsigned	head;
-	unsigned	tail;
+	uint8_t			*data;
+	unsigned		num_elems;
+	unsigned		sizeof_elem;
+	unsigned		head;
+	unsigned		tail;
+	struct my_queue_waiters	not_empty;
+	struct my_queue_waiters	not_full;
 };
 
 struct my_queue *
@@ -61,6 +79,8 @@ my_queue_mb_init(unsigned num_elems, unsigned sizeof_elem)
 	q->num_elems = num_elems;
 	q->sizeof_elem = sizeof_elem;
 	q->data = my_calloc(q->num_elems, q->sizeof_elem);
+	my_queue_waiters_init(&q->not_empty, MB_MAX_SLEEP_MS);
+	my_queue_waiters_init(&q->not_full, 0);
 	return (q);
 }
 
@@ -92,6 +112,63 @@ q_count(unsigned head, unsigned tail, unsigned size)
 	return ((head - tail) & (size - 1));
 }
 
+/* Copy n elements into the ring, starting at slot idx and wrapping around. */
+static inline void
+q_copy_in(struct my_queue *q, unsigned idx, const uint8_t *src, unsigned n)
+{
+	unsigned first = q->num_elems - idx < n ? q->num_elems - idx : n;
+	memcpy(&q->data[idx * q->sizeof_elem], src, first * q->sizeof_elem);
+	memcpy(q->data, src + first * q->sizeof_elem, (n - first) * q->sizeof_elem);
+}
+
+/* Copy n elements out of the ring, starting at slot idx and wrapping around. */
+static inline void
+q_copy_out(struct my_queue *q, unsigned idx, uint8_t *dst, unsigned n)
+{
+	unsigned first = q->num_elems - idx < n ? q->num_elems - idx : n;
+	memcpy(dst, &q->data[idx * q->sizeof_elem], first * q->sizeof_elem);
+	memcpy(dst + first * q->sizeof_elem, q->data, (n - first) * q->sizeof_elem);
+}
+
+/*
+ * Store a new head index after the elements have been copied in. Only an
+ * insert that found the queue empty pays for the full barrier that orders
+ * the store before the check for sleeping consumers. An insert that saw a
+ * stale tail may miss a consumer that emptied the queue meanwhile, which is
+ * why consumers sleep for at most MB_MAX_SLEEP_MS at a time.
+ */
+static inline void
+q_publish_head(struct my_queue *q, unsigned head, bool was_empty)
+{
+	if (was_empty) {
+		__atomic_exchange_n(&q->head, head, __ATOMIC_SEQ_CST);
+		if (my_queue_waiters_present(&q->not_empty))
+			my_queue_waiters_signal(&q->not_empty);
+	} else {
+		MY_ACCESS_ONCE(q->head) = head;
+	}
+}
+
+/*
+ * Store a new tail index after the elements have been copied out. The
+ * exchange takes the place of the full barrier the consumer always needed
+ * before freeing the slots, and also orders the store before the waiter check.
+ */
+static inline void
+q_publish_tail(struct my_queue *q, unsigned tail)
+{
+	__atomic_exchange_n(&q->tail, tail, __ATOMIC_SEQ_CST);
+}
+
+/* Wake producers if removing n elements made the queue non-full. */
+static inline void
+q_signal_not_full(struct my_queue *q, unsigned tail, unsigned n)
+{
+	if (my_queue_waiters_present(&q->not_full) &&
+	    q_space(MY_ACCESS_ONCE(q->head), tail, q->num_elems) <= n)
+		my_queue_waiters_signal(&q->not_full);
+}
+
 bool
 my_queue_mb_insert(struct my_queue *q, void *item, unsigned *pspace)
 {
@@ -102,8 +179,7 @@ my_queue_mb_insert(struct my_queue *q, void *item, unsigned *pspace)
 	if (space >= 1) {
 		memcpy(&q->data[head * q->sizeof_elem], item, q->sizeof_elem);
 		smp_wmb();
-		q->head = (head + 1) & (q->num_elems - 1);
-		smp_wmb();
+		q_publish_head(q, (head + 1) & (q->num_elems - 1), head == tail);
 		res = true;
 		space--;
 	}
@@ -121,8 +197,9 @@ my_queue_mb_remove(struct my_queue *q, void *item, unsigned *pcount)
 	unsigned count = q_count(head, tail, q->num_elems);
 	if (count >= 1) {
 		memcpy(item, &q->data[tail * q->sizeof_elem], q->sizeof_elem);
-		smp_mb();
-		q->tail = (tail + 1) & (q->num_elems - 1);
+		tail = (tail + 1) & (q->num_elems - 1);
+		q_publish_tail(q, tail);
+		q_signal_not_full(q, tail, 1);
 		res = true;
 		count--;
 	}
@@ -131,6 +208,57 @@ my_queue_mb_remove(struct my_queue *q, void *item, unsigned *pcount)
 	return (res);
 }
 
+unsigned
+my_queue_mb_insert_batch(struct my_queue *q, void *items, unsigned n, unsigned *pspace)
+{
+	unsigned head = q->head;
+	unsigned tail = MY_ACCESS_ONCE(q->tail);
+	unsigned space = q_space(head, tail, q->num_elems);
+	if (n > space)
+		n = space;
+	if (n > 0) {
+		q_copy_in(q, head, items, n);
+		smp_wmb();
+		q_publish_head(q, (head + n) & (q->num_elems - 1), head == tail);
+		space -= n;
+	}
+	if (pspace != NULL)
+		*pspace = space;
+	return (n);
+}
+
+unsigned
+my_queue_mb_remove_batch(struct my_queue *q, void *items, unsigned n, unsigned *pcount)
+{
+	unsigned head = MY_ACCESS_ONCE(q->head);
+	unsigned tail = q->tail;
+	unsigned count = q_count(head, tail, q->num_elems);
+	if (n > count)
+		n = count;
+	if (n > 0) {
+		q_copy_out(q, tail, items, n);
+		tail = (tail + n) & (q->num_elems - 1);
+		q_publish_tail(q, tail);
+		q_signal_not_full(q, tail, n);
+		count -= n;
+	}
+	if (pcount != NULL)
+		*pcount = count;
+	return (n);
+}
+
+bool
+my_queue_mb_insert_wait(struct my_queue *q, void *item, int timeout_ms, unsigned *pspace)
+{
+	return (my_queue_wait(my_queue_mb_insert, q, item, pspace, &q->not_full, timeout_ms));
+}
+
+bool
+my_queue_mb_remove_wait(struct my_queue *q, void *item, int timeout_ms, unsigned *pcount)
+{
+	return (my_queue_wait(my_queue_mb_remove, q, item, pcount, &q->not_empty, timeout_ms));
+}
+
 const struct my_queue_ops my_queue_mb_ops = {
 	.init =
 		my_queue_mb_init,
@@ -142,6 +270,14 @@ const struct my_queue_ops my_queue_mb_ops = {
 		my_queue_mb_insert,
 	.remove =
 		my_queue_mb_remove,
+	.insert_batch =
+		my_queue_mb_insert_batch,
+	.remove_batch =
+		my_queue_mb_remove_batch,
+	.insert_wait =
+		my_queue_mb_insert_wait,
+	.remove_wait =
+		my_queue_mb_remove_wait,
 };
 
 #endif /* MY_HAVE_MEMORY_BARRIERS */
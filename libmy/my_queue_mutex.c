@@ -23,6 +23,7 @@
 #include "my_alloc.h"
 
 #include "my_queue.h"
+#include "my_queue_wait.h"
 
 #if defined(__GNUC__)
 # define _aligned __attribute__((aligned(64)))
@@ -31,12 +32,14 @@
 #endif
 
 struct my_queue {
-	uint8_t		*data;
-	unsigned	num_elems;
-	unsigned	sizeof_elem;
-	unsigned	head;
-	unsigned	tail;
-	pthread_mutex_t	lock _aligned;
+	uint8_t			*data;
+	unsigned		num_elems;
+	unsigned		sizeof_elem;
+	unsigned		head;
+	unsigned		tail;
+	pthread_mutex_t		lock _aligned;
+	struct my_queue_waiters	not_empty;
+	struct my_queue_waiters	not_full;
 };
 
 struct my_queue *
@@ -54,6 +57,18 @@ my_queue_mutex_insert(struct my_queue *, void *, unsigned *);
 bool
 my_queue_mutex_remove(struct my_queue *, void *, unsigned *);
 
+unsigned
+my_queue_mutex_insert_batch(struct my_queue *, void *, unsigned, unsigned *);
+
+unsigned
+my_queue_mutex_remove_batch(struct my_queue *, void *, unsigned, unsigned *);
+
+bool
+my_queue_mutex_insert_wait(struct my_queue *, void *, int, unsigned *);
+
+bool
+my_queue_mutex_remove_wait(struct my_queue *, void *, int, unsigned *);
+
 struct my_queue *
 my_queue_mutex_init(unsigned num_elems, unsigned sizeof_elem)
 {
@@ -66,6 +81,8 @@ my_queue_mutex_init(unsigned num_elems, unsigned sizeof_elem)
 	q->data = my_calloc(q->num_elems, q->sizeof_elem);
 	int rc = pthread_mutex_init(&q->lock, NULL);
 	assert(rc == 0);
+	my_queue_waiters_init(&q->not_empty, 0);
+	my_queue_waiters_init(&q->not_full, 0);
 	return (q);
 }
 
@@ -112,6 +129,35 @@ q_count(unsigned head, unsigned tail, unsigned size)
 	return ((head - tail) & (size - 1));
 }
 
+/* Copy n elements into the ring, starting at slot idx and wrapping around. */
+static inline void
+q_copy_in(struct my_queue *q, unsigned idx, const uint8_t *src, unsigned n)
+{
+	unsigned first = q->num_elems - idx < n ? q->num_elems - idx : n;
+	memcpy(&q->data[idx * q->sizeof_elem], src, first * q->sizeof_elem);
+	memcpy(q->data, src + first * q->sizeof_elem, (n - first) * q->sizeof_elem);
+}
+
+/* Copy n elements out of the ring, starting at slot idx and wrapping around. */
+static inline void
+q_copy_out(struct my_queue *q, unsigned idx, uint8_t *dst, unsigned n)
+{
+	unsigned first = q->num_elems - idx < n ? q->num_elems - idx : n;
+	memcpy(dst, &q->data[idx * q->sizeof_elem], first * q->sizeof_elem);
+	memcpy(dst + first * q->sizeof_elem, q->data, (n - first) * q->sizeof_elem);
+}
+
+/*
+ * Wake threads waiting on w. Called after dropping the lock, and only if
+ * the operation moved the queue out of the empty or full state.
+ */
+static inline void
+q_signal(struct my_queue_waiters *w)
+{
+	__sync_synchronize();
+	my_queue_waiters_signal(w);
+}
+
 bool
 my_queue_mutex_insert(struct my_queue *q, void *item, unsigned *pspace)
 {
@@ -127,6 +173,8 @@ my_queue_mutex_insert(struct my_queue *q, void *item, unsigned *pspace)
 		space--;
 	}
 	q_unlock(q);
+	if (res && head == tail)
+		q_signal(&q->not_empty);
 	if (pspace)
 		*pspace = space;
 	return (res);
@@ -147,11 +195,69 @@ my_queue_mutex_remove(struct my_queue *q, void *item, unsigned *pcount)
 		count--;
 	}
 	q_unlock(q);
+	if (res && q_space(head, tail, q->num_elems) == 0)
+		q_signal(&q->not_full);
 	if (pcount)
 		*pcount = count;
 	return (res);
 }
 
+unsigned
+my_queue_mutex_insert_batch(struct my_queue *q, void *items, unsigned n, unsigned *pspace)
+{
+	q_lock(q);
+	unsigned head = q->head;
+	unsigned tail = q->tail;
+	unsigned space = q_space(head, tail, q->num_elems);
+	if (n > space)
+		n = space;
+	if (n > 0) {
+		q_copy_in(q, head, items, n);
+		q->head = (head + n) & (q->num_elems - 1);
+		space -= n;
+	}
+	q_unlock(q);
+	if (n > 0 && head == tail)
+		q_signal(&q->not_empty);
+	if (pspace)
+		*pspace = space;
+	return (n);
+}
+
+unsigned
+my_queue_mutex_remove_batch(struct my_queue *q, void *items, unsigned n, unsigned *pcount)
+{
+	q_lock(q);
+	unsigned head = q->head;
+	unsigned tail = q->tail;
+	unsigned count = q_count(head, tail, q->num_elems);
+	if (n > count)
+		n = count;
+	if (n > 0) {
+		q_copy_out(q, tail, items, n);
+		q->tail = (tail + n) & (q->num_elems - 1);
+		count -= n;
+	}
+	q_unlock(q);
+	if (n > 0 && q_space(head, tail, q->num_elems) == 0)
+		q_signal(&q->not_full);
+	if (pcount)
+		*pcount = count;
+	return (n);
+}
+
+bool
+my_queue_mutex_insert_wait(struct my_queue *q, void *item, int timeout_ms, unsigned *pspace)
+{
+	return (my_queue_wait(my_queue_mutex_insert, q, item, pspace, &q->not_full, timeout_ms));
+}
+
+bool
+my_queue_mutex_remove_wait(struct my_queue *q, void *item, int timeout_ms, unsigned *pcount)
+{
+	return (my_queue_wait(my_queue_mutex_remove, q, item, pcount, &q->not_empty, timeout_ms));
+}
+
 const struct my_queue_ops my_queue_mutex_ops = {
 	.init =
 		my_queue_mutex_init,
@@ -163,4 +269,12 @@ const struct my_queue_ops my_queue_mutex_ops = {
 		my_queue_mutex_insert,
 	.remove =
 		my_queue_mutex_remove,
+	.insert_batch =
+		my_queue_mutex_insert_batch,
+	.remove_batch =
+		my_queue_mutex_remove_batch,
+	.insert_wait =
+		my_queue_mutex_insert_wait,
+	.remove_wait =
+		my_queue_mutex_remove_wait,
 };
@@ -0,0 +1,165 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "my_memory_barrier.h"
+#include "my_queue.h"
+
+/*
+ * Single threaded FIFO checks of the single element and batch operations,
+ * and a producer / consumer pair using the blocking operations.
+ */
+
+#ifdef MY_HAVE_MEMORY_BARRIERS
+extern const struct my_queue_ops my_queue_mb_ops;
+#endif
+extern const struct my_queue_ops my_queue_mutex_ops;
+#if defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+extern const struct my_queue_ops my_queue_vyukov_ops;
+#endif
+
+static const struct my_queue_ops *impls[] = {
+#ifdef MY_HAVE_MEMORY_BARRIERS
+	&my_queue_mb_ops,
+#endif
+	&my_queue_mutex_ops,
+#if defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+	&my_queue_vyukov_ops,
+#endif
+};
+
+#define NUM_ELEMS	8
+#define NUM_ROUNDS	1000
+
+static bool
+test_impl(const struct my_queue_ops *ops)
+{
+	struct my_queue *q;
+	uint32_t items[2 * NUM_ELEMS];
+	uint32_t next_in = 0, next_out = 0;
+	unsigned k, n, space, count;
+	bool ok = true;
+
+	q = ops->init(NUM_ELEMS, sizeof(uint32_t));
+	if (q == NULL)
+		return (false);
+
+	for (unsigned round = 0; round < NUM_ROUNDS && ok; round++) {
+		/* batches of 1 .. 2 * NUM_ELEMS exercise wraparound and partial batches */
+		n = 1 + round % (2 * NUM_ELEMS);
+		for (unsigned i = 0; i < n; i++)
+			items[i] = next_in + i;
+		k = ops->insert_batch(q, items, n, &space);
+		if (k > n || (k < n && next_in + k - next_out < NUM_ELEMS - 1))
+			ok = false;
+		next_in += k;
+
+		if (round % 3 == 0) {
+			uint32_t item = next_in;
+			if (ops->insert(q, &item, NULL))
+				next_in++;
+		}
+
+		if (round % 4 == 1) {
+			uint32_t item;
+			if (ops->remove(q, &item, NULL) && item != next_out++)
+				ok = false;
+		}
+
+		n = 1 + (round * 5) % (2 * NUM_ELEMS);
+		k = ops->remove_batch(q, items, n, &count);
+		if (k > n || (k < n && next_in != next_out + k))
+			ok = false;
+		for (unsigned i = 0; i < k; i++) {
+			if (items[i] != next_out++)
+				ok = false;
+		}
+		if (count != next_in - next_out)
+			ok = false;
+	}
+
+	while ((k = ops->remove_batch(q, items, NUM_ELEMS, NULL)) > 0) {
+		for (unsigned i = 0; i < k; i++) {
+			if (items[i] != next_out++)
+				ok = false;
+		}
+	}
+	if (next_out != next_in)
+		ok = false;
+	if (ops->remove_batch(q, items, 1, &count) != 0 || count != 0)
+		ok = false;
+
+	ops->destroy(&q);
+	return (ok);
+}
+
+#define NUM_WAIT_ITEMS	100000
+
+struct wait_test {
+	const struct my_queue_ops	*ops;
+	struct my_queue			*q;
+	bool				ok;
+};
+
+static void *
+wait_producer(void *arg)
+{
+	struct wait_test *t = arg;
+
+	for (uint32_t i = 0; i < NUM_WAIT_ITEMS; i++) {
+		if (!t->ops->insert_wait(t->q, &i, -1, NULL))
+			t->ok = false;
+	}
+	return (NULL);
+}
+
+static bool
+test_wait(const struct my_queue_ops *ops)
+{
+	struct wait_test t = { .ops = ops, .ok = true };
+	pthread_t thr;
+	uint32_t item;
+	bool ok = true;
+
+	t.q = ops->init(4, sizeof(uint32_t));
+	if (t.q == NULL)
+		return (false);
+
+	/* an empty queue times out */
+	if (ops->remove_wait(t.q, &item, 10, NULL))
+		ok = false;
+
+	pthread_create(&thr, NULL, wait_producer, &t);
+	for (uint32_t i = 0; i < NUM_WAIT_ITEMS; i++) {
+		if (!ops->remove_wait(t.q, &item, -1, NULL) || item != i)
+			ok = false;
+	}
+	pthread_join(thr, NULL);
+
+	/* a full queue times out */
+	item = 0;
+	while (ops->insert(t.q, &item, NULL));
+	if (ops->insert_wait(t.q, &item, 10, NULL))
+		ok = false;
+
+	ops->destroy(&t.q);
+	return (ok && t.ok);
+}
+
+int
+main(void) {
+	int rc = EXIT_SUCCESS;
+
+	for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+		bool ok = test_impl(impls[i]) && test_wait(impls[i]);
+		fprintf(stderr, "my_queue_test: %s: %s\n",
+			ok ? "PASS" : "FAIL",
+			impls[i]->impl_type());
+		if (!ok)
+			rc = EXIT_FAILURE;
+	}
+
+	return (rc);
+}
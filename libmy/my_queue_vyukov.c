@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2013, 2014 by Farsight Security, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Bounded multi-producer / multi-consumer queue, after Dmitry Vyukov's
+ * "bounded MPMC queue".
+ *
+ * Each slot carries a sequence number. A slot at position pos is free for the
+ * producer that claims pos when its sequence number equals pos, and holds an
+ * element for the consumer that claims pos when its sequence number equals
+ * pos + 1. Producers and consumers claim positions with a compare-and-swap on
+ * the head and tail counters respectively, then publish the slot by storing
+ * its next sequence number with release semantics. A thread never waits for
+ * another: insert fails if the queue is full and remove fails if it is empty.
+ *
+ * The batch operations claim a run of consecutive ready slots with a single
+ * compare-and-swap, then fill or drain and publish each slot in turn.
+ */
+
+#if defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+# define MY_HAVE_ATOMIC_BUILTINS 1
+#endif
+
+#ifdef MY_HAVE_ATOMIC_BUILTINS
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "my_alloc.h"
+
+#include "my_queue.h"
+#include "my_queue_wait.h"
+
+#define _aligned __attribute__((aligned(64)))
+
+struct my_queue *
+my_queue_vyukov_init(unsigned, unsigned);
+
+void
+my_queue_vyukov_destroy(struct my_queue **);
+
+const char *
+my_queue_vyukov_impl_type(void);
+
+bool
+my_queue_vyukov_insert(struct my_queue *, void *, unsigned *);
+
+bool
+my_queue_vyukov_remove(struct my_queue *, void *, unsigned *);
+
+unsigned
+my_queue_vyukov_insert_batch(struct my_queue *, void *, unsigned, unsigned *);
+
+unsigned
+my_queue_vyukov_remove_batch(struct my_queue *, void *, unsigned, unsigned *);
+
+bool
+my_queue_vyukov_insert_wait(struct my_queue *, void *, int, unsigned *);
+
+bool
+my_queue_vyukov_remove_wait(struct my_queue *, void *, int, unsigned *);
+
+struct my_queue {
+	uint8_t			*data;
+	unsigned		num_elems;
+	unsigned		sizeof_elem;
+	size_t			sizeof_slot;
+	unsigned		head _aligned;
+	unsigned		tail _aligned;
+	struct my_queue_waiters	not_empty _aligned;
+	struct my_queue_waiters	not_full;
+};
+
+/* A slot is a sequence number followed by the element. */
+#define SLOT_DATA	sizeof(unsigned)
+
+static inline unsigned *
+q_seq(struct my_queue *q, unsigned pos)
+{
+	return ((unsigned *) &q->data[(pos & (q->num_elems - 1)) * q->sizeof_slot]);
+}
+
+/*
+ * A waiter registers itself and then retries the operation, so the sequence
+ * store that publishes an element or frees a slot must be ordered before the
+ * load of the waiter count. The single element operations publish with a
+ * sequentially consistent exchange and the batch operations issue one fence
+ * after their last store; either way the waiter count is then loaded with
+ * sequential consistency. Unlike the barriers of the mutex and mb queues,
+ * this is a cost every vyukov operation bears whether or not anybody waits.
+ */
+static inline bool
+q_waiters_present(struct my_queue_waiters *w)
+{
+	return (__atomic_load_n(&w->count, __ATOMIC_SEQ_CST) != 0);
+}
+
+/* Wake consumers if publishing n elements up to head made the queue non-empty. */
+static inline void
+q_signal_not_empty(struct my_queue *q, unsigned head, unsigned n)
+{
+	if (q_waiters_present(&q->not_empty) &&
+	    (int) (head - __atomic_load_n(&q->tail, __ATOMIC_RELAXED)) <= (int) n)
+		my_queue_waiters_signal(&q->not_empty);
+}
+
+/* Wake producers if releasing n slots up to tail made the queue non-full. */
+static inline void
+q_signal_not_full(struct my_queue *q, unsigned tail, unsigned n)
+{
+	if (q_waiters_present(&q->not_full) &&
+	    (int) (q->num_elems - (__atomic_load_n(&q->head, __ATOMIC_RELAXED) - tail)) <= (int) n)
+		my_queue_waiters_signal(&q->not_full);
+}
+
+struct my_queue *
+my_queue_vyukov_init(unsigned num_elems, unsigned sizeof_elem)
+{
+	struct my_queue *q;
+	if (num_elems < 2 || ((num_elems - 1) & num_elems) != 0)
+		return (NULL);
+	q = my_calloc(1, sizeof(*q));
+	q->num_elems = num_elems;
+	q->sizeof_elem = sizeof_elem;
+	q->sizeof_slot = (SLOT_DATA + sizeof_elem + sizeof(unsigned) - 1) &
+		~(sizeof(unsigned) - 1);
+	q->data = my_calloc(q->num_elems, q->sizeof_slot);
+	for (unsigned i = 0; i < num_elems; i++)
+		*q_seq(q, i) = i;
+	my_queue_waiters_init(&q->not_empty, 0);
+	my_queue_waiters_init(&q->not_full, 0);
+	return (q);
+}
+
+void
+my_queue_vyukov_destroy(struct my_queue **q)
+{
+	if (*q) {
+		free((*q)->data);
+		free(*q);
+		*q = NULL;
+	}
+}
+
+const char *
+my_queue_vyukov_impl_type(void)
+{
+	return ("vyukov mpmc");
+}
+
+bool
+my_queue_vyukov_insert(struct my_queue *q, void *item, unsigned *pspace)
+{
+	unsigned pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	unsigned *seq;
+
+	for (;;) {
+		seq = q_seq(q, pos);
+		int dif = (int) (__atomic_load_n(seq, __ATOMIC_ACQUIRE) - pos);
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, true,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (dif < 0) {
+			/* the slot still holds the element from the last lap */
+			if (pspace != NULL)
+				*pspace = 0;
+			return (false);
+		} else {
+			pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+		}
+	}
+
+	memcpy((uint8_t *) seq + SLOT_DATA, item, q->sizeof_elem);
+	__atomic_exchange_n(seq, pos + 1, __ATOMIC_SEQ_CST);
+	q_signal_not_empty(q, pos + 1, 1);
+
+	if (pspace != NULL) {
+		int space = (int) (__atomic_load_n(&q->tail, __ATOMIC_RELAXED) +
+				   q->num_elems - (pos + 1));
+		if (space > (int) q->num_elems)
+			space = q->num_elems;
+		*pspace = space > 0 ? (unsigned) space : 0;
+	}
+	return (true);
+}
+
+bool
+my_queue_vyukov_remove(struct my_queue *q, void *item, unsigned *pcount)
+{
+	unsigned pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+	unsigned *seq;
+
+	for (;;) {
+		seq = q_seq(q, pos);
+		int dif = (int) (__atomic_load_n(seq, __ATOMIC_ACQUIRE) - (pos + 1));
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, true,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (dif < 0) {
+			/* the slot has not been filled yet */
+			if (pcount != NULL)
+				*pcount = 0;
+			return (false);
+		} else {
+			pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	memcpy(item, (uint8_t *) seq + SLOT_DATA, q->sizeof_elem);
+	__atomic_exchange_n(seq, pos + q->num_elems, __ATOMIC_SEQ_CST);
+	q_signal_not_full(q, pos + 1, 1);
+
+	if (pcount != NULL) {
+		int count = (int) (__atomic_load_n(&q->head, __ATOMIC_RELAXED) - (pos + 1));
+		*pcount = count > 0 ? (unsigned) count : 0;
+	}
+	return (true);
+}
+
+unsigned
+my_queue_vyukov_insert_batch(struct my_queue *q, void *items, unsigned n, unsigned *pspace)
+{
+	unsigned pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	unsigned k;
+
+	if (n > q->num_elems)
+		n = q->num_elems;
+
+	for (;;) {
+		/* count the free slots from pos onward */
+		int dif = 0;
+		for (k = 0; k < n; k++) {
+			dif = (int) (__atomic_load_n(q_seq(q, pos + k), __ATOMIC_ACQUIRE) - (pos + k));
+			if (dif != 0)
+				break;
+		}
+		if (k > 0) {
+			if (__atomic_compare_exchange_n(&q->head, &pos, pos + k, true,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (dif < 0 || n == 0) {
+			/* the slot still holds the element from the last lap */
+			if (pspace != NULL)
+				*pspace = 0;
+			return (0);
+		} else {
+			pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+		}
+	}
+
+	for (unsigned i = 0; i < k; i++) {
+		unsigned *seq = q_seq(q, pos + i);
+		memcpy((uint8_t *) seq + SLOT_DATA, (uint8_t *) items + i * q->sizeof_elem,
+		       q->sizeof_elem);
+		__atomic_store_n(seq, pos + i + 1, __ATOMIC_RELEASE);
+	}
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	q_signal_not_empty(q, pos + k, k);
+
+	if (pspace != NULL) {
+		int space = (int) (__atomic_load_n(&q->tail, __ATOMIC_RELAXED) +
+				   q->num_elems - (pos + k));
+		if (space > (int) q->num_elems)
+			space = q->num_elems;
+		*pspace = space > 0 ? (unsigned) space : 0;
+	}
+	return (k);
+}
+
+unsigned
+my_queue_vyukov_remove_batch(struct my_queue *q, void *items, unsigned n, unsigned *pcount)
+{
+	unsigned pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+	unsigned k;
+
+	if (n > q->num_elems)
+		n = q->num_elems;
+
+	for (;;) {
+		/* count the filled slots from pos onward */
+		int dif = 0;
+		for (k = 0; k < n; k++) {
+			dif = (int) (__atomic_load_n(q_seq(q, pos + k), __ATOMIC_ACQUIRE) - (pos + k + 1));
+			if (dif != 0)
+				break;
+		}
+		if (k > 0) {
+			if (__atomic_compare_exchange_n(&q->tail, &pos, pos + k, true,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (dif < 0 || n == 0) {
+			/* the slot has not been filled yet */
+			if (pcount != NULL)
+				*pcount = 0;
+			return (0);
+		} else {
+			pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	for (unsigned i = 0; i < k; i++) {
+		unsigned *seq = q_seq(q, pos + i);
+		memcpy((uint8_t *) items + i * q->sizeof_elem, (uint8_t *) seq + SLOT_DATA,
+		       q->sizeof_elem);
+		__atomic_store_n(seq, pos + i + q->num_elems, __ATOMIC_RELEASE);
+	}
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	q_signal_not_full(q, pos + k, k);
+
+	if (pcount != NULL) {
+		int count = (int) (__atomic_load_n(&q->head, __ATOMIC_RELAXED) - (pos + k));
+		*pcount = count > 0 ? (unsigned) count : 0;
+	}
+	return (k);
+}
+
+bool
+my_queue_vyukov_insert_wait(struct my_queue *q, void *item, int timeout_ms, unsigned *pspace)
+{
+	return (my_queue_wait(my_queue_vyukov_insert, q, item, pspace, &q->not_full, timeout_ms));
+}
+
+bool
+my_queue_vyukov_remove_wait(struct my_queue *q, void *item, int timeout_ms, unsigned *pcount)
+{
+	return (my_queue_wait(my_queue_vyukov_remove, q, item, pcount, &q->not_empty, timeout_ms));
+}
+
+const struct my_queue_ops my_queue_vyukov_ops = {
+	.init =
+		my_queue_vyukov_init,
+	.destroy =
+		my_queue_vyukov_destroy,
+	.impl_type =
+		my_queue_vyukov_impl_type,
+	.insert =
+		my_queue_vyukov_insert,
+	.remove =
+		my_queue_vyukov_remove,
+	.insert_batch =
+		my_queue_vyukov_insert_batch,
+	.remove_batch =
+		my_queue_vyukov_remove_batch,
+	.insert_wait =
+		my_queue_vyukov_insert_wait,
+	.remove_wait =
+		my_queue_vyukov_remove_wait,
+};
+
+#endif /* MY_HAVE_ATOMIC_BUILTINS */
@@ -0,0 +1,196 @@
+#ifndef MY_QUEUE_WAIT_H
+#define MY_QUEUE_WAIT_H
+
+/*
+ * Blocking support shared by the my_queue implementations.
+ *
+ * Each queue keeps one struct my_queue_waiters for threads waiting for it to
+ * become non-empty and one for threads waiting for it to become non-full.
+ * A waiter first spins on the non-blocking operation, then registers itself,
+ * retries the operation once more and sleeps until the sequence number
+ * changes. The other side calls my_queue_waiters_signal() only when its
+ * operation moved the queue out of the empty or full state. Before checking
+ * for waiters it must order its queue update before the load of the waiter
+ * count with a full memory barrier. The mutex queue knows the state under
+ * its lock and issues the barrier only on such a transition. The mb queue
+ * issues it when an insert finds the queue empty, and on every remove, whose
+ * full barrier it already had. Its producer can miss a consumer that drains
+ * the queue while an insert is in progress, so consumers of the mb queue
+ * sleep for at most a millisecond at a time and recheck the queue. The vyukov
+ * queue has no lock to reuse and no cheap way to see the transition. Each of
+ * its operations pays for a sequentially consistent exchange or fence even
+ * when nobody is waiting. Beyond the barrier, the check costs a load of the
+ * waiter count.
+ *
+ * The spin limit adapts: it grows when spinning succeeds and shrinks when
+ * the waiter had to sleep anyway. On Linux the sleep is a futex(2) wait on
+ * the sequence number; elsewhere the sequence number is polled with short
+ * sleeps.
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#ifdef __linux__
+# include <linux/futex.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+#include "my_time.h"
+
+#define MY_QUEUE_SPIN_MIN	16
+#define MY_QUEUE_SPIN_MAX	4096
+
+#define MY_QUEUE_LOAD(x)	__atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define MY_QUEUE_STORE(x, v)	__atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define my_queue_cpu_relax()	asm volatile("pause" ::: "memory")
+#elif defined(__GNUC__)
+# define my_queue_cpu_relax()	asm volatile("" ::: "memory")
+#else
+# define my_queue_cpu_relax()
+#endif
+
+struct my_queue_waiters {
+	unsigned	seq;
+	unsigned	count;
+	unsigned	spin;
+	unsigned	max_sleep_ms;	/* 0: until woken or timed out */
+};
+
+static inline void
+my_queue_waiters_init(struct my_queue_waiters *w, unsigned max_sleep_ms)
+{
+	w->seq = 0;
+	w->count = 0;
+	w->spin = MY_QUEUE_SPIN_MIN;
+	w->max_sleep_ms = max_sleep_ms;
+}
+
+static inline bool
+my_queue_waiters_present(struct my_queue_waiters *w)
+{
+	return (MY_QUEUE_LOAD(w->count) != 0);
+}
+
+/*
+ * Wake every thread sleeping on w. The caller must have issued a full memory
+ * barrier after the queue operation that made the waited-for condition true.
+ */
+static inline void
+my_queue_waiters_signal(struct my_queue_waiters *w)
+{
+	if (!my_queue_waiters_present(w))
+		return;
+	__sync_fetch_and_add(&w->seq, 1);
+#ifdef __linux__
+	syscall(SYS_futex, &w->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+/*
+ * Sleep until w->seq differs from seq, the deadline passes, or
+ * w->max_sleep_ms elapses. Returns false if the deadline has passed.
+ */
+static inline bool
+my_queue_waiters_sleep(struct my_queue_waiters *w, unsigned seq,
+		       const struct timespec *deadline)
+{
+	struct timespec rel, max = {
+		.tv_sec = w->max_sleep_ms / 1000,
+		.tv_nsec = (w->max_sleep_ms % 1000) * 1000000,
+	};
+	bool bounded = (deadline != NULL);
+
+	if (deadline != NULL) {
+		my_gettime(CLOCK_MONOTONIC, &rel);
+		if (rel.tv_sec > deadline->tv_sec ||
+		    (rel.tv_sec == deadline->tv_sec && rel.tv_nsec >= deadline->tv_nsec))
+			return (false);
+		/* rel = deadline - now */
+		struct timespec now = rel;
+		rel = *deadline;
+		my_timespec_sub(&now, &rel);
+	}
+	if (w->max_sleep_ms != 0 &&
+	    (!bounded || rel.tv_sec > max.tv_sec ||
+	     (rel.tv_sec == max.tv_sec && rel.tv_nsec > max.tv_nsec)))
+	{
+		rel = max;
+		bounded = true;
+	}
+
+#ifdef __linux__
+	syscall(SYS_futex, &w->seq, FUTEX_WAIT_PRIVATE, seq,
+		bounded ? &rel : NULL, NULL, 0);
+#else
+	struct timespec poll = { .tv_sec = 0, .tv_nsec = 100000 };
+	if (bounded && rel.tv_sec == 0 && rel.tv_nsec < poll.tv_nsec)
+		poll = rel;
+	if (MY_QUEUE_LOAD(w->seq) == seq)
+		my_nanosleep(&poll);
+#endif
+	return (true);
+}
+
+/*
+ * Retry the non-blocking operation op until it succeeds or timeout_ms
+ * milliseconds pass. A negative timeout waits forever.
+ */
+static inline bool
+my_queue_wait(bool (*op)(struct my_queue *, void *, unsigned *),
+	      struct my_queue *q, void *elem, unsigned *p,
+	      struct my_queue_waiters *w, int timeout_ms)
+{
+	struct timespec deadline;
+	unsigned spin, seq;
+	bool res;
+
+	if (op(q, elem, p))
+		return (true);
+
+	spin = MY_QUEUE_LOAD(w->spin);
+	for (unsigned i = 0; i < spin; i++) {
+		my_queue_cpu_relax();
+		if (op(q, elem, p)) {
+			if (spin < MY_QUEUE_SPIN_MAX)
+				MY_QUEUE_STORE(w->spin, spin * 2);
+			return (true);
+		}
+	}
+	if (spin > MY_QUEUE_SPIN_MIN)
+		MY_QUEUE_STORE(w->spin, spin / 2);
+
+	if (timeout_ms == 0)
+		return (false);
+	if (timeout_ms > 0) {
+		struct timespec rel = {
+			.tv_sec = timeout_ms / 1000,
+			.tv_nsec = (timeout_ms % 1000) * 1000000,
+		};
+		my_gettime(CLOCK_MONOTONIC, &deadline);
+		my_timespec_add(&rel, &deadline);
+	}
+
+	for (;;) {
+		bool timed_out = false;
+
+		__sync_fetch_and_add(&w->count, 1);
+		seq = MY_QUEUE_LOAD(w->seq);
+		res = op(q, elem, p);
+		if (!res) {
+			timed_out = !my_queue_waiters_sleep(w, seq,
+				timeout_ms > 0 ? &deadline : NULL);
+			res = op(q, elem, p);
+		}
+		__sync_fetch_and_sub(&w->count, 1);
+		if (res || timed_out)
+			return (res);
+	}
+}
+
+#endif /* MY_QUEUE_WAIT_H */
@@ -0,0 +1,425 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <wdns.h>
+
+#define NAME "test-deserialize_rrset"
+
+static const char *rdatas[] = {
+	"\x00\x0a" "\x04" "mail" "\x07" "example" "\x03" "com" "\x00",
+	"",
+	"\x00\x14" "\x05" "mail2" "\x07" "example" "\x03" "com" "\x00",
+};
+static const size_t rdlens[] = { 20, 0, 21 };
+#define N_RDATAS (sizeof(rdlens) / sizeof(rdlens[0]))
+
+static const uint8_t pkt[] = {
+	/* header: id 0x1234, qr rd ra, qd 1 an 3 ns 0 ar 1 */
+	0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01,
+
+	/* question: example.com. IN A */
+	0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+	0x00, 0x01, 0x00, 0x01,
+
+	/* answer: example.com. 300 IN A 192.0.2.1 */
+	0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c,
+	0x00, 0x04, 192, 0, 2, 1,
+
+	/* answer: example.com. 300 IN A 192.0.2.2 */
+	0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c,
+	0x00, 0x04, 192, 0, 2, 2,
+
+	/* answer: example.com. 300 IN TXT "x" */
+	0xc0, 0x0c, 0x00, 0x10, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c,
+	0x00, 0x02, 0x01, 'x',
+
+	/* additional: OPT, size 4096, DO, empty NSID option */
+	0x00, 0x00, 0x29, 0x10, 0x00, 0x00, 0x00, 0x80, 0x00,
+	0x00, 0x04, 0x00, 0x03, 0x00, 0x00,
+};
+
+static bool
+make_rrset(wdns_rrset_t *rrset)
+{
+	memset(rrset, 0, sizeof(*rrset));
+	if (wdns_str_to_name("example.com", &rrset->name) != wdns_res_success)
+		return (false);
+	rrset->rrtype = WDNS_TYPE_MX;
+	rrset->rrclass = WDNS_CLASS_IN;
+	rrset->rrttl = 86400;
+	rrset->n_rdatas = N_RDATAS;
+	rrset->rdatas = calloc(N_RDATAS, sizeof(wdns_rdata_t *));
+	for (size_t i = 0; i < N_RDATAS; i++) {
+		rrset->rdatas[i] = malloc(sizeof(wdns_rdata_t) + rdlens[i]);
+		rrset->rdatas[i]->len = rdlens[i];
+		memcpy(rrset->rdatas[i]->data, rdatas[i], rdlens[i]);
+	}
+	return (true);
+}
+
+static size_t
+compare_rrset(const wdns_rrset_t *a, const wdns_rrset_t *b, const char *what)
+{
+	if (a->name.len != b->name.len ||
+	    memcmp(a->name.data, b->name.data, a->name.len) != 0 ||
+	    a->rrtype != b->rrtype || a->rrclass != b->rrclass ||
+	    a->rrttl != b->rrttl || a->n_rdatas != b->n_rdatas)
+	{
+		fprintf(stderr, "FAIL: %s: header fields differ\n", what);
+		return (1);
+	}
+	for (size_t i = 0; i < a->n_rdatas; i++) {
+		if (a->rdatas[i]->len != b->rdatas[i]->len ||
+		    memcmp(a->rdatas[i]->data, b->rdatas[i]->data, a->rdatas[i]->len) != 0)
+		{
+			fprintf(stderr, "FAIL: %s: rdata %zd differs\n", what, i);
+			return (1);
+		}
+	}
+	return (0);
+}
+
+/* version 1, version 2, and version 2 with varint lengths */
+#define N_FORMATS 3
+
+static uint8_t *
+serialize(const wdns_rrset_t *rrset, int fmt, size_t *sz)
+{
+	uint8_t *buf;
+
+	if (fmt == 0) {
+		wdns_serialize_rrset(rrset, NULL, sz);
+		buf = malloc(*sz);
+		wdns_serialize_rrset(rrset, buf, NULL);
+	} else {
+		unsigned flags = fmt == 2 ? WDNS_SERIALIZE_V2_VARINT : 0;
+
+		wdns_serialize_rrset_v2(rrset, flags, NULL, sz);
+		buf = malloc(*sz);
+		wdns_serialize_rrset_v2(rrset, flags, buf, NULL);
+	}
+	return (buf);
+}
+
+static size_t
+test_deserialize(int fmt)
+{
+	size_t failures = 0;
+	size_t sz, memsz;
+	uint8_t *buf, *mem;
+	wdns_rrset_t rrset, out;
+	wdns_res res;
+
+	if (!make_rrset(&rrset)) {
+		fprintf(stderr, "FAIL: wdns_str_to_name\n");
+		return (1);
+	}
+	buf = serialize(&rrset, fmt, &sz);
+
+	res = wdns_deserialize_rrset(&out, buf, sz);
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_deserialize_rrset: %s\n", wdns_res_to_str(res));
+		failures++;
+	} else {
+		failures += compare_rrset(&rrset, &out, "wdns_deserialize_rrset");
+		wdns_clear_rrset(&out);
+	}
+
+	res = wdns_deserialize_rrset_flat(&out, buf, sz);
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_deserialize_rrset_flat: %s\n", wdns_res_to_str(res));
+		failures++;
+	} else {
+		failures += compare_rrset(&rrset, &out, "wdns_deserialize_rrset_flat");
+		wdns_clear_rrset_flat(&out);
+	}
+
+	/* caller supplied buffer, too small and then exactly large enough */
+	res = wdns_deserialize_rrset_buf(NULL, buf, sz, NULL, &memsz);
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_deserialize_rrset_buf size: %s\n", wdns_res_to_str(res));
+		failures++;
+	} else {
+		mem = malloc(memsz);
+		memsz -= 1;
+		res = wdns_deserialize_rrset_buf(&out, buf, sz, mem, &memsz);
+		if (res == wdns_res_success) {
+			fprintf(stderr, "FAIL: wdns_deserialize_rrset_buf short buffer accepted\n");
+			failures++;
+		}
+		memsz += 1;
+		res = wdns_deserialize_rrset_buf(&out, buf, sz, mem, &memsz);
+		if (res != wdns_res_success || (uint8_t *) out.rdatas != mem) {
+			fprintf(stderr, "FAIL: wdns_deserialize_rrset_buf: %s\n", wdns_res_to_str(res));
+			failures++;
+		} else {
+			failures += compare_rrset(&rrset, &out, "wdns_deserialize_rrset_buf");
+		}
+		free(mem);
+	}
+
+	/* every truncation must be rejected */
+	for (size_t len = 0; len < sz; len++) {
+		if (wdns_deserialize_rrset_buf(NULL, buf, len, NULL, &memsz) == wdns_res_success) {
+			fprintf(stderr, "FAIL: truncated rrset len=%zd accepted\n", len);
+			failures++;
+		}
+	}
+
+	free(buf);
+	wdns_clear_rrset(&rrset);
+	return (failures);
+}
+
+static size_t
+test_view(int fmt)
+{
+	size_t failures = 0;
+	size_t sz;
+	uint8_t *buf;
+	const uint8_t *rdata;
+	uint16_t rdlen;
+	wdns_rrset_t rrset;
+	wdns_rrset_view_t v;
+	wdns_res res;
+
+	if (!make_rrset(&rrset)) {
+		fprintf(stderr, "FAIL: wdns_str_to_name\n");
+		return (1);
+	}
+	buf = serialize(&rrset, fmt, &sz);
+
+	res = wdns_rrset_view_init(&v, buf, sz);
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_rrset_view_init: %s\n", wdns_res_to_str(res));
+		failures++;
+		goto out;
+	}
+	if (v.name_len != rrset.name.len ||
+	    memcmp(v.name, rrset.name.data, v.name_len) != 0 ||
+	    v.rrtype != rrset.rrtype || v.rrclass != rrset.rrclass ||
+	    v.rrttl != rrset.rrttl || v.n_rdatas != rrset.n_rdatas)
+	{
+		fprintf(stderr, "FAIL: view header fields differ\n");
+		failures++;
+	}
+
+	/* in order, then in reverse order */
+	for (int pass = 0; pass < 2; pass++) {
+		for (size_t j = 0; j < N_RDATAS; j++) {
+			size_t i = pass == 0 ? j : N_RDATAS - 1 - j;
+
+			res = wdns_rrset_view_rdata(&v, i, &rdata, &rdlen);
+			if (res != wdns_res_success ||
+			    rdlen != rdlens[i] || memcmp(rdata, rdatas[i], rdlen) != 0)
+			{
+				fprintf(stderr, "FAIL: view rdata %zd (pass %d)\n", i, pass);
+				failures++;
+			}
+		}
+	}
+	if (wdns_rrset_view_rdata(&v, N_RDATAS, &rdata, &rdlen) != wdns_res_out_of_bounds) {
+		fprintf(stderr, "FAIL: view rdata index out of bounds accepted\n");
+		failures++;
+	}
+
+	for (size_t len = 0; len < sz; len++) {
+		if (wdns_rrset_view_init(&v, buf, len) == wdns_res_success) {
+			fprintf(stderr, "FAIL: view of truncated rrset len=%zd accepted\n", len);
+			failures++;
+		}
+	}
+
+out:
+	free(buf);
+	wdns_clear_rrset(&rrset);
+	return (failures);
+}
+
+static size_t
+test_v2_format(void)
+{
+	size_t failures = 0;
+	size_t sz;
+	uint8_t *buf;
+	wdns_rrset_t rrset;
+	wdns_rrset_view_t v;
+
+	if (!make_rrset(&rrset)) {
+		fprintf(stderr, "FAIL: wdns_str_to_name\n");
+		return (1);
+	}
+	buf = serialize(&rrset, 1, &sz);
+
+	/* header, then fixed width fields in network byte order */
+	if (memcmp(buf, "\x00" "W" "\x02" "\x00", 4) != 0 ||
+	    buf[4] != rrset.name.len ||
+	    memcmp(buf + 5 + rrset.name.len, "\x00\x0f" "\x00\x01" "\x00\x01\x51\x80" "\x00\x03", 10) != 0)
+	{
+		fprintf(stderr, "FAIL: v2 header encoding\n");
+		failures++;
+	}
+
+	/* an unknown version or flag is rejected */
+	buf[2] = 3;
+	if (wdns_rrset_view_init(&v, buf, sz) != wdns_res_parse_error) {
+		fprintf(stderr, "FAIL: v2 unknown version accepted\n");
+		failures++;
+	}
+	buf[2] = 2;
+	buf[3] = 0x80;
+	if (wdns_rrset_view_init(&v, buf, sz) != wdns_res_parse_error) {
+		fprintf(stderr, "FAIL: v2 unknown flag accepted\n");
+		failures++;
+	}
+	buf[3] = 0;
+
+	/* an offset table that disagrees with the rdatas is rejected */
+	buf[sz - 1] ^= 1;
+	if (wdns_rrset_view_init(&v, buf, sz) != wdns_res_parse_error) {
+		fprintf(stderr, "FAIL: v2 corrupt offset table accepted\n");
+		failures++;
+	}
+
+	free(buf);
+	wdns_clear_rrset(&rrset);
+	return (failures);
+}
+
+static size_t
+test_message(void)
+{
+	static const unsigned n_rrsets[WDNS_MSG_SEC_MAX] = { 1, 2, 0, 0 };
+	size_t failures = 0;
+	size_t sz;
+	uint8_t *buf;
+	char *s0, *s1;
+	wdns_message_t m, out;
+	wdns_rrset_array_t a;
+	wdns_serialized_message_t sm;
+	wdns_rrset_view_t v;
+	wdns_res res;
+
+	res = wdns_parse_message(&m, pkt, sizeof(pkt));
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_parse_message: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+	s0 = wdns_message_to_str(&m);
+
+	wdns_serialize_message(&m, &buf, &sz);
+
+	res = wdns_serialized_message_init(&sm, buf, sz);
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_serialized_message_init: %s\n", wdns_res_to_str(res));
+		failures++;
+	} else {
+		if (sm.id != 0x1234 || sm.flags != 0x8180 || !sm.edns_present ||
+		    sm.edns_size != 4096 || sm.edns_options_len != 4)
+		{
+			fprintf(stderr, "FAIL: serialized message header fields\n");
+			failures++;
+		}
+		for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++) {
+			unsigned n = 0;
+
+			while (wdns_rrset_iter_next(&sm.sections[sec], &v))
+				n++;
+			if (n != n_rrsets[sec] || sm.sections[sec].n_rrsets != n) {
+				fprintf(stderr, "FAIL: section %u has %u rrsets\n", sec, n);
+				failures++;
+			}
+		}
+	}
+
+	res = wdns_deserialize_message(&out, buf, sz);
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_deserialize_message: %s\n", wdns_res_to_str(res));
+		failures++;
+	} else {
+		s1 = wdns_message_to_str(&out);
+		if (strcmp(s0, s1) != 0) {
+			fprintf(stderr, "FAIL: wdns_deserialize_message:\n%s\n%s\n", s0, s1);
+			failures++;
+		}
+		free(s1);
+		wdns_clear_message(&out);
+	}
+
+	for (size_t len = 0; len < sz; len++) {
+		if (wdns_serialized_message_init(&sm, buf, len) == wdns_res_success) {
+			fprintf(stderr, "FAIL: truncated message len=%zd accepted\n", len);
+			failures++;
+		}
+	}
+	free(buf);
+
+	/* a single section */
+	wdns_serialize_rrset_array(&m.sections[WDNS_MSG_SEC_ANSWER], &buf, &sz);
+	res = wdns_deserialize_rrset_array(&a, WDNS_MSG_SEC_ANSWER, buf, sz);
+	if (res != wdns_res_success || a.n_rrsets != 2 || a.n_rrs != 3) {
+		fprintf(stderr, "FAIL: wdns_deserialize_rrset_array: %s\n", wdns_res_to_str(res));
+		failures++;
+	} else {
+		for (unsigned i = 0; i < a.n_rrsets; i++)
+			failures += compare_rrset(&m.sections[WDNS_MSG_SEC_ANSWER].rrsets[i],
+						  &a.rrsets[i], "wdns_deserialize_rrset_array");
+	}
+
+	/* the RRsets are embedded in the portable version 2 format */
+	for (size_t off = 1, i = 0; i < a.n_rrsets; i++) {
+		size_t len, v2_len;
+		uint8_t *v2;
+
+		len = (size_t) buf[off] << 24 | buf[off + 1] << 16 | buf[off + 2] << 8 | buf[off + 3];
+		off += 4;
+		wdns_serialize_rrset_v2(&m.sections[WDNS_MSG_SEC_ANSWER].rrsets[i],
+					WDNS_SERIALIZE_V2_VARINT, NULL, &v2_len);
+		v2 = malloc(v2_len);
+		wdns_serialize_rrset_v2(&m.sections[WDNS_MSG_SEC_ANSWER].rrsets[i],
+					WDNS_SERIALIZE_V2_VARINT, v2, NULL);
+		if (len != v2_len || off + len > sz || memcmp(buf + off, v2, len) != 0) {
+			fprintf(stderr, "FAIL: rrset %zd of the array is not in the v2 format\n", i);
+			failures++;
+		}
+		free(v2);
+		off += len;
+	}
+	wdns_clear_rrset_array(&a);
+	free(buf);
+
+	free(s0);
+	wdns_clear_message(&m);
+	return (failures);
+}
+
+static int
+check(size_t ret, const char *s)
+{
+	if (ret == 0)
+		fprintf(stderr, NAME ": PASS: %s\n", s);
+	else
+		fprintf(stderr, NAME ": FAIL: %s (%" PRIu64 " failures)\n", s, ret);
+	return (ret);
+}
+
+int main (int argc, char **argv)
+{
+	int ret = 0;
+
+	ret |= check(test_deserialize(0), "test-deserialize_rrset");
+	ret |= check(test_view(0), "test-rrset_view");
+	ret |= check(test_deserialize(1), "test-deserialize_rrset v2");
+	ret |= check(test_view(1), "test-rrset_view v2");
+	ret |= check(test_deserialize(2), "test-deserialize_rrset v2 varint");
+	ret |= check(test_view(2), "test-rrset_view v2 varint");
+	ret |= check(test_v2_format(), "test-serialize_rrset_v2");
+	ret |= check(test_message(), "test-serialize_message");
+
+	if (ret)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <wdns.h>
+
+#define NAME "test-edns"
+
+static const uint8_t pkt[] = {
+	/* header: id 1, qr rd ra, qd 1 ar 1 */
+	0x00, 0x01, 0x81, 0x80, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+
+	/* question: example.com. IN A */
+	0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+	0x00, 0x01, 0x00, 0x01,
+
+	/* additional: OPT, size 1232, rdlen 66 */
+	0x00, 0x00, 0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x42,
+
+	/* NSID, empty */
+	0x00, 0x03, 0x00, 0x00,
+
+	/* Client Subnet: 192.0.2.0/24, scope 0 */
+	0x00, 0x08, 0x00, 0x07, 0x00, 0x01, 0x18, 0x00, 192, 0, 2,
+
+	/* Cookie: client cookie only */
+	0x00, 0x0a, 0x00, 0x08, 1, 2, 3, 4, 5, 6, 7, 8,
+
+	/* Extended DNS Error 18, "prohibited" */
+	0x00, 0x0f, 0x00, 0x0c, 0x00, 0x12,
+	'p', 'r', 'o', 'h', 'i', 'b', 'i', 't', 'e', 'd',
+
+	/* an unassigned option code */
+	0xfd, 0xe9, 0x00, 0x02, 0xab, 0xcd,
+
+	/* a second Client Subnet option, which is never returned */
+	0x00, 0x08, 0x00, 0x04, 0x00, 0x02, 0x00, 0x00,
+
+	/* Padding */
+	0x00, 0x0c, 0x00, 0x05, 0, 0, 0, 0, 0,
+};
+
+static const uint16_t codes[] = {
+	WDNS_EDNS_OPT_NSID, WDNS_EDNS_OPT_CLIENT_SUBNET, WDNS_EDNS_OPT_COOKIE,
+	WDNS_EDNS_OPT_EDE, 65001, WDNS_EDNS_OPT_CLIENT_SUBNET, WDNS_EDNS_OPT_PADDING,
+};
+
+static size_t
+check_options(const wdns_edns_t *edns)
+{
+	size_t failures = 0;
+	wdns_edns_option_t opt;
+	wdns_edns_ecs_t ecs;
+	wdns_edns_ede_t ede;
+
+	if (!wdns_edns_find_option(edns, WDNS_EDNS_OPT_NSID, &opt) || opt.len != 0) {
+		fprintf(stderr, "FAIL: NSID\n");
+		failures++;
+	}
+
+	if (!wdns_edns_find_option(edns, WDNS_EDNS_OPT_CLIENT_SUBNET, &opt) ||
+	    wdns_edns_decode_ecs(&opt, &ecs) != wdns_res_success ||
+	    ecs.family != 1 || ecs.source_prefix != 24 || ecs.scope_prefix != 0 ||
+	    memcmp(ecs.address, "\xc0\x00\x02\x00", 4) != 0)
+	{
+		fprintf(stderr, "FAIL: Client Subnet\n");
+		failures++;
+	}
+
+	if (!wdns_edns_find_option(edns, WDNS_EDNS_OPT_COOKIE, &opt) ||
+	    opt.len != 8 || opt.data[0] != 1 || opt.data[7] != 8)
+	{
+		fprintf(stderr, "FAIL: Cookie\n");
+		failures++;
+	}
+
+	if (!wdns_edns_find_option(edns, WDNS_EDNS_OPT_EDE, &opt) ||
+	    wdns_edns_decode_ede(&opt, &ede) != wdns_res_success ||
+	    ede.info_code != 18 || ede.text_len != 10 ||
+	    memcmp(ede.text, "prohibited", 10) != 0)
+	{
+		fprintf(stderr, "FAIL: Extended DNS Error\n");
+		failures++;
+	}
+
+	if (!wdns_edns_find_option(edns, WDNS_EDNS_OPT_PADDING, &opt) || opt.len != 5) {
+		fprintf(stderr, "FAIL: Padding\n");
+		failures++;
+	}
+
+	if (!wdns_edns_find_option(edns, 65001, &opt) || opt.len != 2 || opt.data[0] != 0xab) {
+		fprintf(stderr, "FAIL: unassigned option\n");
+		failures++;
+	}
+
+	if (wdns_edns_find_option(edns, WDNS_EDNS_OPT_KEEPALIVE, &opt) ||
+	    wdns_edns_find_option(edns, 65002, &opt))
+	{
+		fprintf(stderr, "FAIL: absent option found\n");
+		failures++;
+	}
+
+	return (failures);
+}
+
+static size_t
+test_options(void)
+{
+	size_t failures = 0;
+	wdns_edns_option_iter_t it;
+	wdns_edns_option_t opt;
+	wdns_message_t m, m2;
+	uint8_t *buf;
+	size_t sz, n = 0;
+	wdns_res res;
+
+	res = wdns_parse_message(&m, pkt, sizeof(pkt));
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_parse_message: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+
+	/* every option, in order */
+	wdns_edns_option_iter_init(&it, m.edns.options->data, m.edns.options->len);
+	while ((res = wdns_edns_option_iter_next(&it, &opt)) == wdns_res_success) {
+		if (n >= sizeof(codes) / sizeof(codes[0]) || opt.code != codes[n]) {
+			fprintf(stderr, "FAIL: option %zd has code %u\n", n, opt.code);
+			failures++;
+		}
+		n++;
+	}
+	if (res != wdns_res_len || n != sizeof(codes) / sizeof(codes[0])) {
+		fprintf(stderr, "FAIL: %zd options, %s\n", n, wdns_res_to_str(res));
+		failures++;
+	}
+
+	failures += check_options(&m.edns);
+
+	/* options survive serialization */
+	if (wdns_serialize_message(&m, &buf, &sz) != wdns_res_success ||
+	    wdns_deserialize_message(&m2, buf, sz) != wdns_res_success)
+	{
+		fprintf(stderr, "FAIL: serialization\n");
+		failures++;
+	} else {
+		failures += check_options(&m2.edns);
+		wdns_clear_message(&m2);
+		free(buf);
+	}
+
+	/* options set by the caller are found */
+	memset(&m2, 0, sizeof(m2));
+	m2.edns.present = true;
+	m2.edns.options = m.edns.options;
+	failures += check_options(&m2.edns);
+
+	/* replacing the options leaves nothing stale behind */
+	{
+		wdns_rdata_t *short_opts = malloc(sizeof(wdns_rdata_t) + 4);
+
+		memcpy(short_opts->data, "\x00\x0c\x00\x00", 4);
+		short_opts->len = 4;
+		m2.edns.options = short_opts;
+		if (wdns_edns_find_option(&m2.edns, WDNS_EDNS_OPT_CLIENT_SUBNET, &opt) ||
+		    !wdns_edns_find_option(&m2.edns, WDNS_EDNS_OPT_PADDING, &opt) ||
+		    opt.len != 0)
+		{
+			fprintf(stderr, "FAIL: replaced options\n");
+			failures++;
+		}
+		free(short_opts);
+	}
+
+	wdns_clear_message(&m);
+	return (failures);
+}
+
+static size_t
+test_malformed(void)
+{
+	size_t failures = 0;
+	wdns_edns_option_iter_t it;
+	wdns_edns_option_t opt;
+	wdns_edns_ecs_t ecs;
+	wdns_edns_ede_t ede;
+
+	/* a truncated option */
+	wdns_edns_option_iter_init(&it, (const uint8_t *) "\x00\x03\x00\x00\x00\x08\x00\x07\x00", 9);
+	if (wdns_edns_option_iter_next(&it, &opt) != wdns_res_success ||
+	    wdns_edns_option_iter_next(&it, &opt) != wdns_res_overflow)
+	{
+		fprintf(stderr, "FAIL: truncated option accepted\n");
+		failures++;
+	}
+
+	/* Client Subnet with an address longer than its prefix, a prefix
+	 * longer than the address family, and an unknown family */
+	opt.code = WDNS_EDNS_OPT_CLIENT_SUBNET;
+	opt.data = (const uint8_t *) "\x00\x01\x10\x00\xc0\x00\x02";
+	opt.len = 7;
+	if (wdns_edns_decode_ecs(&opt, &ecs) != wdns_res_parse_error) {
+		fprintf(stderr, "FAIL: Client Subnet address too long\n");
+		failures++;
+	}
+	opt.data = (const uint8_t *) "\x00\x01\x28\x00\xc0\x00\x02\x00\x00";
+	opt.len = 9;
+	if (wdns_edns_decode_ecs(&opt, &ecs) != wdns_res_parse_error) {
+		fprintf(stderr, "FAIL: Client Subnet prefix too long\n");
+		failures++;
+	}
+	opt.data = (const uint8_t *) "\x00\x03\x00\x00";
+	opt.len = 4;
+	if (wdns_edns_decode_ecs(&opt, &ecs) != wdns_res_parse_error) {
+		fprintf(stderr, "FAIL: Client Subnet unknown family\n");
+		failures++;
+	}
+
+	/* a short Extended DNS Error, and the wrong option */
+	opt.code = WDNS_EDNS_OPT_EDE;
+	opt.len = 1;
+	if (wdns_edns_decode_ede(&opt, &ede) != wdns_res_parse_error) {
+		fprintf(stderr, "FAIL: short Extended DNS Error\n");
+		failures++;
+	}
+	opt.code = WDNS_EDNS_OPT_PADDING;
+	opt.len = 4;
+	if (wdns_edns_decode_ede(&opt, &ede) != wdns_res_parse_error ||
+	    wdns_edns_decode_ecs(&opt, &ecs) != wdns_res_parse_error)
+	{
+		fprintf(stderr, "FAIL: wrong option decoded\n");
+		failures++;
+	}
+
+	return (failures);
+}
+
+/* The index finds the same options as wdns_edns_find_option(). */
+static size_t
+check_index(const wdns_edns_t *edns)
+{
+	size_t failures = 0;
+	wdns_edns_option_index_t idx;
+	wdns_edns_option_t opt, iopt;
+
+	wdns_edns_option_index_init(&idx, edns);
+	for (unsigned code = 0; code < 65536; code++) {
+		bool found = wdns_edns_find_option(edns, code, &opt);
+
+		if (wdns_edns_option_index_find(&idx, code, &iopt) != found ||
+		    (found && (iopt.code != opt.code || iopt.len != opt.len ||
+			       iopt.data != opt.data)))
+		{
+			fprintf(stderr, "FAIL: option index, code %u\n", code);
+			failures++;
+		}
+	}
+	return (failures);
+}
+
+static size_t
+test_option_index(void)
+{
+	size_t failures = 0;
+	wdns_rdata_t *truncated;
+	wdns_message_t m;
+	wdns_edns_t edns;
+
+	if (wdns_parse_message(&m, pkt, sizeof(pkt)) != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_parse_message\n");
+		return (1);
+	}
+	failures += check_index(&m.edns);
+
+	/* no EDNS */
+	memset(&edns, 0, sizeof(edns));
+	failures += check_index(&edns);
+
+	/* options after a truncated option are not found */
+	truncated = malloc(sizeof(wdns_rdata_t) + 9);
+	memcpy(truncated->data, "\x00\x03\x00\x00\x00\x08\x00\x07\x00", 9);
+	truncated->len = 9;
+	edns.present = true;
+	edns.options = truncated;
+	failures += check_index(&edns);
+	free(truncated);
+
+	wdns_clear_message(&m);
+	return (failures);
+}
+
+static int
+check(size_t ret, const char *s)
+{
+	if (ret == 0)
+		fprintf(stderr, NAME ": PASS: %s\n", s);
+	else
+		fprintf(stderr, NAME ": FAIL: %s (%" PRIu64 " failures)\n", s, ret);
+	return (ret);
+}
+
+int main (int argc, char **argv)
+{
+	int ret = 0;
+
+	ret |= check(test_options(), "test-edns_options");
+	ret |= check(test_malformed(), "test-edns_malformed");
+	ret |= check(test_option_index(), "test-edns_option_index");
+
+	if (ret)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
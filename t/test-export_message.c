@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <libmy/ubuf.h>
+#include <wdns.h>
+
+#define NAME "test-export_message"
+
+static const uint8_t pkt[] = {
+	/* header: id 0x1234, qr rd ra, qd 1 an 2 ns 0 ar 1 */
+	0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01,
+
+	/* question: example.com. IN A */
+	0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+	0x00, 0x01, 0x00, 0x01,
+
+	/* answer: example.com. 300 IN A 192.0.2.1 */
+	0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c,
+	0x00, 0x04, 192, 0, 2, 1,
+
+	/* answer: example.com. 300 IN A 192.0.2.2 */
+	0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c,
+	0x00, 0x04, 192, 0, 2, 2,
+
+	/* additional: OPT, size 4096, DO, empty NSID option */
+	0x00, 0x00, 0x29, 0x10, 0x00, 0x00, 0x00, 0x80, 0x00,
+	0x00, 0x04, 0x00, 0x03, 0x00, 0x00,
+};
+
+static const uint8_t owner[] = "\x07" "example" "\x03" "com";
+
+static size_t
+test_roundtrip(void)
+{
+	const uint8_t *p, *end;
+	size_t failures = 0;
+	size_t sz;
+	ubuf *u;
+	wdns_export_record_t rec;
+	wdns_export_rr_t rr;
+	wdns_message_t m;
+	wdns_res res;
+
+	res = wdns_parse_message(&m, pkt, sizeof(pkt));
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_parse_message: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+
+	/* append two copies of the record to a ubuf */
+	u = ubuf_new();
+	for (int i = 0; i < 2; i++) {
+		wdns_export_message(&m, NULL, &sz);
+		ubuf_reserve(u, ubuf_size(u) + sz);
+		wdns_export_message(&m, ubuf_ptr(u), NULL);
+		ubuf_advance(u, sz);
+	}
+	wdns_clear_message(&m);
+
+	p = ubuf_data(u);
+	end = p + ubuf_size(u);
+	for (int i = 0; i < 2; i++) {
+		unsigned n_rrs = 0;
+
+		res = wdns_export_next(&p, end, &rec);
+		if (res != wdns_res_success) {
+			fprintf(stderr, "FAIL %d: wdns_export_next: %s\n", i, wdns_res_to_str(res));
+			failures++;
+			break;
+		}
+
+		if (rec.id != 0x1234 || rec.flags != 0x8180 || rec.rcode != 0 ||
+		    !rec.edns_present || rec.edns_size != 4096 || rec.edns_flags != 0x8000 ||
+		    rec.edns_options_len != 4 ||
+		    rec.counts[0] != 1 || rec.counts[1] != 2 ||
+		    rec.counts[2] != 0 || rec.counts[3] != 0)
+		{
+			fprintf(stderr, "FAIL %d: header fields\n", i);
+			failures++;
+		}
+
+		while (wdns_export_next_rr(&rec, &rr)) {
+			if (rr.name_len != sizeof(owner) ||
+			    memcmp(rr.name, owner, sizeof(owner)) != 0 ||
+			    rr.rrtype != WDNS_TYPE_A || rr.rrclass != WDNS_CLASS_IN)
+			{
+				fprintf(stderr, "FAIL %d: rr %u owner/type/class\n", i, n_rrs);
+				failures++;
+			}
+			if (rr.sec == WDNS_MSG_SEC_ANSWER &&
+			    (rr.rrttl != 300 || rr.rdlen != 4 ||
+			     rr.rdata[3] != (n_rrs == 1 ? 1 : 2)))
+			{
+				fprintf(stderr, "FAIL %d: rr %u ttl/rdata\n", i, n_rrs);
+				failures++;
+			}
+			n_rrs++;
+		}
+		if (n_rrs != 3) {
+			fprintf(stderr, "FAIL %d: %u rrs != 3\n", i, n_rrs);
+			failures++;
+		}
+	}
+	if (p != end) {
+		fprintf(stderr, "FAIL: trailing data after records\n");
+		failures++;
+	}
+
+	/* every truncation of a record must be rejected */
+	p = ubuf_data(u);
+	res = wdns_export_next(&p, p, &rec);
+	if (res != wdns_res_len) {
+		fprintf(stderr, "FAIL: empty buffer res=%s\n", wdns_res_to_str(res));
+		failures++;
+	}
+	for (size_t len = 1; len < ubuf_size(u) / 2; len++) {
+		p = ubuf_data(u);
+		res = wdns_export_next(&p, p + len, &rec);
+		if (res == wdns_res_success) {
+			fprintf(stderr, "FAIL: truncated record len=%zd accepted\n", len);
+			failures++;
+		}
+	}
+
+	if (failures == 0)
+		fprintf(stderr, "PASS: export record roundtrip\n");
+
+	ubuf_destroy(&u);
+	return (failures);
+}
+
+static int
+check(size_t ret, const char *s)
+{
+	if (ret == 0)
+		fprintf(stderr, NAME ": PASS: %s\n", s);
+	else
+		fprintf(stderr, NAME ": FAIL: %s (%" PRIu64 " failures)\n", s, ret);
+	return (ret);
+}
+
+int main (int argc, char **argv)
+{
+	int ret = 0;
+
+	ret |= check(test_roundtrip(), "test-export_message");
+
+	if (ret)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
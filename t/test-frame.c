@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <wdns.h>
+
+#define NAME "test-frame"
+
+#define N_FRAMES 50
+
+static bool
+make_rrset(wdns_rrset_t *rrset, unsigned n)
+{
+	char name[32];
+
+	memset(rrset, 0, sizeof(*rrset));
+	snprintf(name, sizeof(name), "host%u.example.com", n);
+	if (wdns_str_to_name(name, &rrset->name) != wdns_res_success)
+		return (false);
+	rrset->rrtype = WDNS_TYPE_A;
+	rrset->rrclass = WDNS_CLASS_IN;
+	rrset->rrttl = 3600;
+	rrset->n_rdatas = 1 + n % 3;
+	rrset->rdatas = calloc(rrset->n_rdatas, sizeof(wdns_rdata_t *));
+	for (size_t i = 0; i < rrset->n_rdatas; i++) {
+		rrset->rdatas[i] = malloc(sizeof(wdns_rdata_t) + 4);
+		rrset->rdatas[i]->len = 4;
+		memcpy(rrset->rdatas[i]->data, "\xc0\x00\x02", 3);
+		rrset->rdatas[i]->data[3] = n;
+	}
+	return (true);
+}
+
+/* Frame N_FRAMES RRsets into one buffer, recording where each frame starts. */
+static uint8_t *
+make_stream(size_t *sz, size_t *offsets)
+{
+	uint8_t *buf = NULL;
+	size_t len;
+
+	*sz = 0;
+	for (unsigned n = 0; n < N_FRAMES; n++) {
+		wdns_rrset_t rrset;
+
+		if (!make_rrset(&rrset, n))
+			return (NULL);
+		wdns_frame_write_rrset(&rrset, NULL, &len);
+		buf = realloc(buf, *sz + len);
+		wdns_frame_write_rrset(&rrset, buf + *sz, NULL);
+		offsets[n] = *sz;
+		*sz += len;
+		wdns_clear_rrset(&rrset);
+	}
+	offsets[N_FRAMES] = *sz;
+	return (buf);
+}
+
+/* Read every frame, checking that each payload is the expected RRset. */
+static size_t
+read_stream(const uint8_t *buf, size_t sz, wdns_frame_reader_t *r, unsigned *seen)
+{
+	size_t failures = 0;
+	const uint8_t *payload;
+	size_t len;
+
+	wdns_frame_reader_init(r, buf, sz);
+	while (wdns_frame_reader_next(r, &payload, &len) == wdns_res_success) {
+		wdns_rrset_view_t v;
+		const uint8_t *rdata;
+		uint16_t rdlen;
+
+		/* the payload is in the byte order independent version 2 format */
+		if (len < 4 || payload[0] != 0 || payload[1] != 'W' || payload[2] != 2 ||
+		    wdns_rrset_view_init(&v, payload, len) != wdns_res_success ||
+		    wdns_rrset_view_rdata(&v, 0, &rdata, &rdlen) != wdns_res_success ||
+		    rdlen != 4 || rdata[3] >= N_FRAMES)
+		{
+			fprintf(stderr, "FAIL: bad payload in frame %" PRIu64 "\n", r->n_frames);
+			failures++;
+			continue;
+		}
+		seen[rdata[3]]++;
+	}
+	return (failures);
+}
+
+static size_t
+test_roundtrip(void)
+{
+	size_t failures = 0;
+	size_t offsets[N_FRAMES + 1];
+	unsigned seen[N_FRAMES] = { 0 };
+	wdns_frame_reader_t r;
+	uint8_t *buf;
+	size_t sz;
+
+	buf = make_stream(&sz, offsets);
+	if (buf == NULL)
+		return (1);
+
+	failures += read_stream(buf, sz, &r, seen);
+	if (r.n_frames != N_FRAMES || r.n_corrupt != 0 || r.n_skipped != 0) {
+		fprintf(stderr, "FAIL: frames=%" PRIu64 " corrupt=%" PRIu64 " skipped=%" PRIu64 "\n",
+			r.n_frames, r.n_corrupt, r.n_skipped);
+		failures++;
+	}
+	for (unsigned n = 0; n < N_FRAMES; n++) {
+		if (seen[n] != 1) {
+			fprintf(stderr, "FAIL: frame %u seen %u times\n", n, seen[n]);
+			failures++;
+		}
+	}
+
+	free(buf);
+
+	/* an arbitrary payload */
+	{
+		const uint8_t *payload;
+		size_t len;
+
+		wdns_frame_write((const uint8_t *) "payload", 7, NULL, &sz);
+		buf = malloc(sz);
+		wdns_frame_write((const uint8_t *) "payload", 7, buf, NULL);
+		wdns_frame_reader_init(&r, buf, sz);
+		if (wdns_frame_reader_next(&r, &payload, &len) != wdns_res_success ||
+		    len != 7 || memcmp(payload, "payload", 7) != 0 ||
+		    wdns_frame_reader_next(&r, &payload, &len) != wdns_res_len)
+		{
+			fprintf(stderr, "FAIL: wdns_frame_write\n");
+			failures++;
+		}
+		free(buf);
+	}
+
+	return (failures);
+}
+
+static size_t
+test_corruption(void)
+{
+	size_t failures = 0;
+	size_t offsets[N_FRAMES + 1];
+	unsigned seen[N_FRAMES] = { 0 };
+	wdns_frame_reader_t r;
+	uint8_t *buf;
+	size_t sz;
+
+	buf = make_stream(&sz, offsets);
+	if (buf == NULL)
+		return (1);
+
+	/* a flipped payload bit, a damaged length, and a torn final frame */
+	buf[offsets[3] + 20] ^= 0x10;
+	buf[offsets[10] + 4] = 0x7f;
+	sz = offsets[N_FRAMES - 1] + 9;
+
+	failures += read_stream(buf, sz, &r, seen);
+	if (r.n_frames != N_FRAMES - 3 || r.n_corrupt != 3) {
+		fprintf(stderr, "FAIL: frames=%" PRIu64 " corrupt=%" PRIu64 "\n",
+			r.n_frames, r.n_corrupt);
+		failures++;
+	}
+	if (r.n_skipped != (offsets[4] - offsets[3]) + (offsets[11] - offsets[10]) + 9) {
+		fprintf(stderr, "FAIL: skipped=%" PRIu64 "\n", r.n_skipped);
+		failures++;
+	}
+	for (unsigned n = 0; n < N_FRAMES; n++) {
+		unsigned expect = (n == 3 || n == 10 || n == N_FRAMES - 1) ? 0 : 1;
+
+		if (seen[n] != expect) {
+			fprintf(stderr, "FAIL: frame %u seen %u times\n", n, seen[n]);
+			failures++;
+		}
+	}
+
+	/* leading garbage */
+	memset(seen, 0, sizeof(seen));
+	failures += read_stream(buf + 1, offsets[3] - 1, &r, seen);
+	if (r.n_frames != 2 || r.n_corrupt != 1 || r.n_skipped != offsets[1] - 1) {
+		fprintf(stderr, "FAIL: leading garbage: frames=%" PRIu64 " corrupt=%" PRIu64 "\n",
+			r.n_frames, r.n_corrupt);
+		failures++;
+	}
+
+	free(buf);
+	return (failures);
+}
+
+/*
+ * A buffer packed with sync markers whose lengths all reach the end of the
+ * buffer must not be checksummed from every marker.
+ */
+static size_t
+test_fake_markers(void)
+{
+	size_t failures = 0;
+	size_t sz = 1 << 20;
+	wdns_frame_reader_t r;
+	const uint8_t *payload;
+	size_t len;
+	uint8_t *buf;
+
+	buf = calloc(1, sz);
+	for (size_t off = 0; off + 12 <= sz; off += 12) {
+		size_t flen = sz - off - 12;
+
+		memcpy(buf + off, "\xfdWF1", 4);
+		buf[off + 4] = flen >> 24;
+		buf[off + 5] = flen >> 16;
+		buf[off + 6] = flen >> 8;
+		buf[off + 7] = flen;
+	}
+
+	wdns_frame_reader_init(&r, buf, sz);
+	while (wdns_frame_reader_next(&r, &payload, &len) == wdns_res_success)
+		;
+	if (r.n_frames != 0 || r.n_corrupt != 1 || r.n_skipped != sz) {
+		fprintf(stderr, "FAIL: fake markers: frames=%" PRIu64 " corrupt=%" PRIu64
+			" skipped=%" PRIu64 "\n", r.n_frames, r.n_corrupt, r.n_skipped);
+		failures++;
+	}
+
+	free(buf);
+	return (failures);
+}
+
+static int
+check(size_t ret, const char *s)
+{
+	if (ret == 0)
+		fprintf(stderr, NAME ": PASS: %s\n", s);
+	else
+		fprintf(stderr, NAME ": FAIL: %s (%" PRIu64 " failures)\n", s, ret);
+	return (ret);
+}
+
+int main (int argc, char **argv)
+{
+	int ret = 0;
+
+	ret |= check(test_roundtrip(), "test-frame_roundtrip");
+	ret |= check(test_corruption(), "test-frame_corruption");
+	ret |= check(test_fake_markers(), "test-frame_fake_markers");
+
+	if (ret)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <wdns.h>
+
+#define NAME "test-name_canonical"
+
+/* In canonical order, including the example of RFC 4034 section 6.1. */
+static const char *names[] = {
+	".",
+	"a",
+	"a\\000.a",
+	"a\\000",
+	"ab",
+	"example",
+	"a.example",
+	"yljkjljk.a.example",
+	"Z.a.example",
+	"zABC.a.EXAMPLE",
+	"z.example",
+	"\\000.z.example",
+	"\\001.z.example",
+	"\\001\\000.z.example",
+	"\\001\\001.z.example",
+	"\\002.z.example",
+	"*.z.example",
+	"\\200.z.example",
+	"\\255.z.example",
+};
+
+static size_t
+test_order(void)
+{
+	size_t n = sizeof(names) / sizeof(names[0]);
+	wdns_name_t wn[sizeof(names) / sizeof(names[0])];
+	uint8_t keys[sizeof(names) / sizeof(names[0])][WDNS_MAXLEN_SORTKEY];
+	size_t key_len[sizeof(names) / sizeof(names[0])];
+	size_t failures = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		wdns_res res;
+
+		res = wdns_str_to_name_case(names[i], &wn[i]);
+		if (res != wdns_res_success) {
+			fprintf(stderr, "FAIL: wdns_str_to_name_case(%s): %s\n",
+				names[i], wdns_res_to_str(res));
+			return (1);
+		}
+		res = wdns_name_sortkey(&wn[i], keys[i], &key_len[i]);
+		if (res != wdns_res_success) {
+			fprintf(stderr, "FAIL: wdns_name_sortkey(%s): %s\n",
+				names[i], wdns_res_to_str(res));
+			return (1);
+		}
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j < n; j++) {
+			int expect = i < j ? -1 : (i > j ? 1 : 0);
+			size_t len = key_len[i] < key_len[j] ? key_len[i] : key_len[j];
+			int cmp, key_cmp;
+
+			cmp = wdns_name_cmp_canonical(&wn[i], &wn[j]);
+			cmp = cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+
+			key_cmp = memcmp(keys[i], keys[j], len);
+			if (key_cmp == 0 && key_len[i] != key_len[j])
+				key_cmp = key_len[i] < key_len[j] ? -1 : 1;
+			key_cmp = key_cmp < 0 ? -1 : (key_cmp > 0 ? 1 : 0);
+
+			if (cmp != expect) {
+				fprintf(stderr, "FAIL: wdns_name_cmp_canonical(%s, %s) = %d\n",
+					names[i], names[j], cmp);
+				failures++;
+			}
+			if (key_cmp != expect) {
+				fprintf(stderr, "FAIL: sort keys of %s and %s compare %d\n",
+					names[i], names[j], key_cmp);
+				failures++;
+			}
+		}
+	}
+
+	/* case is ignored */
+	{
+		wdns_name_t lower;
+
+		if (wdns_str_to_name("zabc.a.example", &lower) != wdns_res_success ||
+		    wdns_name_cmp_canonical(&lower, &wn[9]) != 0)
+		{
+			fprintf(stderr, "FAIL: names differing in case\n");
+			failures++;
+		}
+		free(lower.data);
+	}
+
+	for (size_t i = 0; i < n; i++)
+		free(wn[i].data);
+	return (failures);
+}
+
+static size_t
+test_malformed(void)
+{
+	size_t failures = 0;
+	uint8_t key[WDNS_MAXLEN_SORTKEY];
+	size_t sz;
+	wdns_name_t name;
+
+	/* a label running past the end of the name */
+	name.data = (uint8_t *) "\x07" "example" "\x05" "com";
+	name.len = 12;
+	if (wdns_name_sortkey(&name, key, &sz) != wdns_res_name_overflow) {
+		fprintf(stderr, "FAIL: truncated name accepted\n");
+		failures++;
+	}
+
+	/* a compression pointer */
+	name.data = (uint8_t *) "\x01" "a" "\xc0\x0c";
+	name.len = 4;
+	if (wdns_name_sortkey(&name, key, &sz) != wdns_res_invalid_length_octet) {
+		fprintf(stderr, "FAIL: compressed name accepted\n");
+		failures++;
+	}
+
+	return (failures);
+}
+
+static int
+check(size_t ret, const char *s)
+{
+	if (ret == 0)
+		fprintf(stderr, NAME ": PASS: %s\n", s);
+	else
+		fprintf(stderr, NAME ": FAIL: %s (%" PRIu64 " failures)\n", s, ret);
+	return (ret);
+}
+
+int main (int argc, char **argv)
+{
+	int ret = 0;
+
+	ret |= check(test_order(), "test-name_canonical_order");
+	ret |= check(test_malformed(), "test-name_canonical_malformed");
+
+	if (ret)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <wdns.h>
+
+#define NAME "test-normalize_message"
+
+static const uint8_t pkt[] = {
+	/* header: id 1, qr rd ra, qd 1 an 5 */
+	0x00, 0x01, 0x81, 0x80, 0x00, 0x01, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00,
+
+	/* question: Example.com. IN A */
+	0x07, 'E', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+	0x00, 0x01, 0x00, 0x01,
+
+	/* answer: b.example.com. 100 IN A 1.1.1.1 */
+	0x01, 'b', 0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+	0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x64, 0x00, 0x04,
+	1, 1, 1, 1,
+
+	/* answer: A.example.com. 100 IN A 2.2.2.2 */
+	0x01, 'A', 0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+	0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x64, 0x00, 0x04,
+	2, 2, 2, 2,
+
+	/* answer: a.example.com. 100 IN NS NS.Example.com. */
+	0x01, 'a', 0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+	0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x64, 0x00, 0x10,
+	0x02, 'N', 'S', 0x07, 'E', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+
+	/* answer: a.EXAMPLE.com. 50 IN A 1.1.1.1 */
+	0x01, 'a', 0x07, 'E', 'X', 'A', 'M', 'P', 'L', 'E', 0x03, 'c', 'o', 'm', 0x00,
+	0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x32, 0x00, 0x04,
+	1, 1, 1, 1,
+
+	/* answer: example.com. 100 IN A 3.3.3.3 */
+	0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+	0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x64, 0x00, 0x04,
+	3, 3, 3, 3,
+};
+
+/* The normalized answer section. */
+static const struct {
+	const char	*name;
+	uint16_t	rrtype;
+	uint32_t	rrttl;
+	unsigned	n_rdatas;
+	const char	*rdata[2];
+} expect[] = {
+	{ "example.com.", WDNS_TYPE_A, 100, 1, { "3.3.3.3" } },
+	{ "a.example.com.", WDNS_TYPE_A, 50, 2, { "1.1.1.1", "2.2.2.2" } },
+	{ "a.example.com.", WDNS_TYPE_NS, 100, 1, { "ns.example.com." } },
+	{ "b.example.com.", WDNS_TYPE_A, 60, 2, { "1.1.1.1", "9.9.9.9" } },
+};
+
+/* Append an RRset to a section, as a caller assembling a message might. */
+static void
+append_rrset(wdns_rrset_array_t *a, const char *name, uint32_t ttl, const uint8_t *addr)
+{
+	wdns_rrset_t *rrset;
+
+	a->rrsets = realloc(a->rrsets, (a->n_rrsets + 1) * sizeof(wdns_rrset_t));
+	rrset = &a->rrsets[a->n_rrsets++];
+	memset(rrset, 0, sizeof(*rrset));
+	if (wdns_str_to_name_case(name, &rrset->name) != wdns_res_success)
+		abort();
+	rrset->rrtype = WDNS_TYPE_A;
+	rrset->rrclass = WDNS_CLASS_IN;
+	rrset->rrttl = ttl;
+	rrset->n_rdatas = 2;
+	rrset->rdatas = calloc(2, sizeof(wdns_rdata_t *));
+	for (unsigned i = 0; i < 2; i++) {
+		rrset->rdatas[i] = malloc(sizeof(wdns_rdata_t) + 4);
+		rrset->rdatas[i]->len = 4;
+		memcpy(rrset->rdatas[i]->data, addr + 4 * i, 4);
+	}
+}
+
+static size_t
+test_normalize(void)
+{
+	size_t failures = 0;
+	wdns_rrset_array_t *a;
+	wdns_message_t m;
+	unsigned n_rrs = 0;
+	wdns_res res;
+
+	res = wdns_parse_message(&m, pkt, sizeof(pkt));
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_parse_message: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+	a = &m.sections[WDNS_MSG_SEC_ANSWER];
+	append_rrset(a, "B.Example.COM", 60, (const uint8_t *) "\x09\x09\x09\x09\x01\x01\x01\x01");
+
+	res = wdns_normalize_message(&m);
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_normalize_message: %s\n", wdns_res_to_str(res));
+		failures++;
+		goto out;
+	}
+
+	if (m.sections[WDNS_MSG_SEC_QUESTION].n_rrsets != 1 ||
+	    memcmp(m.sections[WDNS_MSG_SEC_QUESTION].rrsets[0].name.data, "\x07" "example", 8) != 0)
+	{
+		fprintf(stderr, "FAIL: question not downcased\n");
+		failures++;
+	}
+
+	if (a->n_rrsets != sizeof(expect) / sizeof(expect[0])) {
+		fprintf(stderr, "FAIL: %u RRsets\n", a->n_rrsets);
+		failures++;
+		goto out;
+	}
+	for (unsigned i = 0; i < a->n_rrsets; i++) {
+		wdns_rrset_t *rrset = &a->rrsets[i];
+		char name[WDNS_PRESLEN_NAME];
+
+		wdns_domain_to_str(rrset->name.data, rrset->name.len, name);
+		if (strcmp(name, expect[i].name) != 0 || rrset->rrtype != expect[i].rrtype ||
+		    rrset->rrttl != expect[i].rrttl || rrset->n_rdatas != expect[i].n_rdatas)
+		{
+			fprintf(stderr, "FAIL: RRset %u: %s type %u ttl %u, %u rdatas\n",
+				i, name, rrset->rrtype, rrset->rrttl, rrset->n_rdatas);
+			failures++;
+			continue;
+		}
+		for (unsigned j = 0; j < rrset->n_rdatas; j++) {
+			char *s = wdns_rdata_to_str(rrset->rdatas[j]->data, rrset->rdatas[j]->len,
+						    rrset->rrtype, rrset->rrclass);
+
+			if (strcmp(s, expect[i].rdata[j]) != 0) {
+				fprintf(stderr, "FAIL: RRset %u rdata %u: %s\n", i, j, s);
+				failures++;
+			}
+			free(s);
+		}
+		n_rrs += rrset->n_rdatas;
+	}
+
+	/* the RRs follow the RRsets */
+	if (a->n_rrs != n_rrs) {
+		fprintf(stderr, "FAIL: %u RRs, expected %u\n", a->n_rrs, n_rrs);
+		failures++;
+	} else {
+		for (unsigned i = 0, k = 0; i < a->n_rrsets; i++) {
+			for (unsigned j = 0; j < a->rrsets[i].n_rdatas; j++, k++) {
+				if (!wdns_compare_rr_rrset(&a->rrs[k], &a->rrsets[i]) ||
+				    a->rrs[k].rdata->len != a->rrsets[i].rdatas[j]->len ||
+				    memcmp(a->rrs[k].rdata->data, a->rrsets[i].rdatas[j]->data,
+					   a->rrs[k].rdata->len) != 0)
+				{
+					fprintf(stderr, "FAIL: RR %u\n", k);
+					failures++;
+				}
+			}
+		}
+	}
+
+out:
+	wdns_clear_message(&m);
+	return (failures);
+}
+
+static int
+check(size_t ret, const char *s)
+{
+	if (ret == 0)
+		fprintf(stderr, NAME ": PASS: %s\n", s);
+	else
+		fprintf(stderr, NAME ": FAIL: %s (%" PRIu64 " failures)\n", s, ret);
+	return (ret);
+}
+
+int main (int argc, char **argv)
+{
+	int ret = 0;
+
+	ret |= check(test_normalize(), "test-normalize_message");
+
+	if (ret)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <wdns.h>
+
+#define NAME "test-parse_rdata"
+
+static const uint8_t rdata[] = {
+	0x00, 0x0a, 0x04, 'm', 'a', 'i', 'l', 0x00,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10,
+};
+
+static const struct {
+	uint16_t	rrtype;
+	uint16_t	rrclass;
+	uint16_t	rdlen;
+	bool		valid;
+} tests[] = {
+	{ WDNS_TYPE_A,		WDNS_CLASS_IN,	4,	true },
+	{ WDNS_TYPE_A,		WDNS_CLASS_IN,	0,	true },
+	{ WDNS_TYPE_A,		WDNS_CLASS_IN,	3,	false },
+	{ WDNS_TYPE_A,		WDNS_CLASS_IN,	5,	false },
+	{ WDNS_TYPE_A,		WDNS_CLASS_CH,	5,	true },
+	{ WDNS_TYPE_AAAA,	WDNS_CLASS_IN,	16,	true },
+	{ WDNS_TYPE_AAAA,	WDNS_CLASS_IN,	15,	false },
+	{ WDNS_TYPE_AAAA,	WDNS_CLASS_IN,	17,	false },
+	{ WDNS_TYPE_EUI48,	WDNS_CLASS_IN,	6,	true },
+	{ WDNS_TYPE_EUI48,	WDNS_CLASS_IN,	8,	false },
+	{ WDNS_TYPE_EUI64,	WDNS_CLASS_IN,	8,	true },
+	{ WDNS_TYPE_EUI64,	WDNS_CLASS_IN,	6,	false },
+	{ WDNS_TYPE_MX,		WDNS_CLASS_IN,	8,	true },
+	{ WDNS_TYPE_MX,		WDNS_CLASS_IN,	2,	true },
+	{ WDNS_TYPE_MX,		WDNS_CLASS_IN,	4,	false },
+	{ WDNS_TYPE_MX,		WDNS_CLASS_IN,	9,	false },
+};
+
+/* Parse a response whose only RR is a root owned RR with the given rdata. */
+static wdns_res
+parse_rr(uint16_t rrtype, uint16_t rrclass, const uint8_t *rd, uint16_t rdlen, wdns_message_t *m)
+{
+	uint8_t pkt[12 + 11 + sizeof(rdata)];
+	uint8_t *p = pkt;
+
+	memcpy(p, "\x00\x01\x81\x80\x00\x00\x00\x01\x00\x00\x00\x00", 12);
+	p += 12;
+	*p++ = 0;
+	*p++ = rrtype >> 8;
+	*p++ = rrtype & 0xff;
+	*p++ = rrclass >> 8;
+	*p++ = rrclass & 0xff;
+	memcpy(p, "\x00\x00\x0e\x10", 4);
+	p += 4;
+	*p++ = rdlen >> 8;
+	*p++ = rdlen & 0xff;
+	memcpy(p, rd, rdlen);
+	p += rdlen;
+
+	return (wdns_parse_message(m, pkt, p - pkt));
+}
+
+static size_t
+test_parse(void)
+{
+	size_t failures = 0;
+
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		wdns_message_t m;
+		wdns_res res;
+
+		res = parse_rr(tests[i].rrtype, tests[i].rrclass, rdata, tests[i].rdlen, &m);
+		if (!tests[i].valid) {
+			if (res == wdns_res_success) {
+				fprintf(stderr, "FAIL: type %u rdlen %u accepted\n",
+					tests[i].rrtype, tests[i].rdlen);
+				wdns_clear_message(&m);
+				failures++;
+			}
+			continue;
+		}
+
+		if (res != wdns_res_success) {
+			fprintf(stderr, "FAIL: type %u rdlen %u: %s\n",
+				tests[i].rrtype, tests[i].rdlen, wdns_res_to_str(res));
+			failures++;
+			continue;
+		}
+		if (m.sections[WDNS_MSG_SEC_ANSWER].n_rrs != 1 ||
+		    m.sections[WDNS_MSG_SEC_ANSWER].rrs[0].rdata->len != tests[i].rdlen ||
+		    memcmp(m.sections[WDNS_MSG_SEC_ANSWER].rrs[0].rdata->data,
+			   rdata, tests[i].rdlen) != 0)
+		{
+			fprintf(stderr, "FAIL: type %u rdlen %u: rdata differs\n",
+				tests[i].rrtype, tests[i].rdlen);
+			failures++;
+		}
+		wdns_clear_message(&m);
+	}
+
+	return (failures);
+}
+
+static int
+check(size_t ret, const char *s)
+{
+	if (ret == 0)
+		fprintf(stderr, NAME ": PASS: %s\n", s);
+	else
+		fprintf(stderr, NAME ": FAIL: %s (%" PRIu64 " failures)\n", s, ret);
+	return (ret);
+}
+
+int main (int argc, char **argv)
+{
+	int ret = 0;
+
+	ret |= check(test_parse(), "test-parse_rdata");
+
+	if (ret)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
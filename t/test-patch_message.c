@@ -0,0 +1,318 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <wdns.h>
+
+#define NAME "test-patch_message"
+
+static const uint8_t pkt[] = {
+	/* header: id 0xbeef, qr aa rd ra, qd 1 an 2 ns 1 ar 3 */
+	0xbe, 0xef, 0x85, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x01, 0x00, 0x03,
+
+	/* question: example.com. IN MX */
+	0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+	0x00, 0x0f, 0x00, 0x01,
+
+	/* answer: example.com. 300 IN MX 10 mail.example.com. */
+	0xc0, 0x0c, 0x00, 0x0f, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x09,
+	0x00, 0x0a, 0x04, 'm', 'a', 'i', 'l', 0xc0, 0x0c,
+
+	/* answer: example.com. 300 IN MX 20 mx2.example.org. */
+	0xc0, 0x0c, 0x00, 0x0f, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x13,
+	0x00, 0x14, 0x03, 'm', 'x', '2',
+	0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'o', 'r', 'g', 0x00,
+
+	/* authority: example.com. 3600 IN NS ns1.example.com. */
+	0xc0, 0x0c, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x06,
+	0x03, 'n', 's', '1', 0xc0, 0x0c,
+
+	/* additional: mail.example.com. 300 IN A 192.0.2.25 */
+	0xc0, 0x2b, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x04,
+	192, 0, 2, 25,
+
+	/* additional: _sip._tcp.example.com. 300 IN SRV 0 5 5060 sip.example.com.
+	 * (SRV rdata is never compressed) */
+	0x04, '_', 's', 'i', 'p', 0x04, '_', 't', 'c', 'p', 0xc0, 0x0c,
+	0x00, 0x21, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x17,
+	0x00, 0x00, 0x00, 0x05, 0x13, 0xc4,
+	0x03, 's', 'i', 'p', 0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+
+	/* additional: OPT, size 4096, DO */
+	0x00, 0x00, 0x29, 0x10, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00,
+};
+
+#ifdef __GLIBC__
+/* Count the allocations made through the C library, libwdns's included. */
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+static size_t n_allocs;
+
+void *
+malloc(size_t size)
+{
+	n_allocs++;
+	return (__libc_malloc(size));
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+	n_allocs++;
+	return (__libc_calloc(nmemb, size));
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+	n_allocs++;
+	return (__libc_realloc(ptr, size));
+}
+#endif
+
+static size_t ttl_offsets[8];
+static size_t n_ttl_offsets;
+
+static void
+find_ttl(wdns_patch_rr_t *rr, void *user)
+{
+	const uint8_t *buf = user;
+
+	if (rr->rrtype != WDNS_TYPE_OPT)
+		ttl_offsets[n_ttl_offsets++] = rr->rdata - 6 - buf;
+}
+
+static size_t
+test_patch_ttls(void)
+{
+	size_t failures = 0;
+	uint8_t buf[sizeof(pkt)];
+	wdns_message_t m;
+	wdns_res res;
+
+	memcpy(buf, pkt, sizeof(pkt));
+	res = wdns_patch_message(buf, sizeof(buf), find_ttl, buf);
+	if (res != wdns_res_success || n_ttl_offsets != 5) {
+		fprintf(stderr, "FAIL: wdns_patch_message: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+
+	res = wdns_patch_ttls(buf, sizeof(buf), 400);
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_patch_ttls: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+
+	res = wdns_parse_message(&m, buf, sizeof(buf));
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_parse_message: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+	for (unsigned sec = WDNS_MSG_SEC_ANSWER; sec < WDNS_MSG_SEC_MAX; sec++) {
+		for (unsigned i = 0; i < m.sections[sec].n_rrs; i++) {
+			wdns_rr_t *rr = &m.sections[sec].rrs[i];
+			uint32_t expect = rr->rrtype == WDNS_TYPE_NS ? 3200 : 0;
+
+			if (rr->rrttl != expect) {
+				fprintf(stderr, "FAIL: section %u RR %u: TTL %u, expected %u\n",
+					sec, i, rr->rrttl, expect);
+				failures++;
+			}
+		}
+	}
+	if (!m.edns.present || m.edns.flags != 0x8000 || m.edns.size != 4096) {
+		fprintf(stderr, "FAIL: OPT RR modified\n");
+		failures++;
+	}
+	wdns_clear_message(&m);
+
+	/* nothing but the TTLs changed */
+	for (size_t i = 0; i < sizeof(pkt); i++) {
+		bool is_ttl = false;
+
+		for (size_t j = 0; j < n_ttl_offsets; j++) {
+			if (i >= ttl_offsets[j] && i < ttl_offsets[j] + 4)
+				is_ttl = true;
+		}
+		if (buf[i] != pkt[i] && !is_ttl) {
+			fprintf(stderr, "FAIL: octet %zd modified\n", i);
+			failures++;
+		}
+	}
+
+	return (failures);
+}
+
+static void
+map_address(wdns_patch_rr_t *rr, void *user)
+{
+	unsigned *n = user;
+
+	if (rr->rrtype == WDNS_TYPE_A && rr->rdlen == 4) {
+		rr->rdata[0] = 10;
+		*n += 1;
+	}
+}
+
+static size_t
+test_patch_message(void)
+{
+	size_t failures = 0;
+	uint8_t buf[sizeof(pkt)];
+	unsigned n = 0;
+	wdns_message_t m;
+	wdns_res res;
+
+	memcpy(buf, pkt, sizeof(pkt));
+	res = wdns_patch_message(buf, sizeof(buf), map_address, &n);
+	if (res != wdns_res_success || n != 1) {
+		fprintf(stderr, "FAIL: wdns_patch_message: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+	res = wdns_patch_header(buf, sizeof(buf), 0x1234, 0x8180);
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_patch_header: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+
+	res = wdns_parse_message(&m, buf, sizeof(buf));
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_parse_message: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+	if (m.id != 0x1234 || m.flags != 0x8180) {
+		fprintf(stderr, "FAIL: id %#x flags %#x\n", m.id, m.flags);
+		failures++;
+	}
+	if (m.sections[WDNS_MSG_SEC_ADDITIONAL].rrs[0].rrtype != WDNS_TYPE_A ||
+	    memcmp(m.sections[WDNS_MSG_SEC_ADDITIONAL].rrs[0].rdata->data, "\x0a\x00\x02\x19", 4) != 0)
+	{
+		fprintf(stderr, "FAIL: A rdata not mapped\n");
+		failures++;
+	}
+	wdns_clear_message(&m);
+
+	return (failures);
+}
+
+static void
+count_rr(wdns_patch_rr_t *rr, void *user)
+{
+	unsigned *n = user;
+
+	*n += 1;
+}
+
+/* Every truncation of the message is walked safely, and succeeds only where
+ * wdns_parse_message() does. */
+static size_t
+test_patch_truncated(void)
+{
+	size_t failures = 0;
+
+	for (size_t len = 0; len < sizeof(pkt); len++) {
+		uint8_t *buf = malloc(len + 1);
+		unsigned n = 0;
+		wdns_message_t m;
+		wdns_res res, parse_res;
+
+		memcpy(buf, pkt, len);
+		res = wdns_patch_message(buf, len, count_rr, &n);
+		parse_res = wdns_parse_message(&m, buf, len);
+		if ((res == wdns_res_success) != (parse_res == wdns_res_success)) {
+			fprintf(stderr, "FAIL: length %zd: %s, parse %s\n", len,
+				wdns_res_to_str(res), wdns_res_to_str(parse_res));
+			failures++;
+		}
+		if (parse_res == wdns_res_success)
+			wdns_clear_message(&m);
+		free(buf);
+	}
+
+	return (failures);
+}
+
+/* Damaged names and rdata are rejected wherever wdns_parse_message() rejects
+ * them, including bad compression pointers. */
+static size_t
+test_patch_corrupt(void)
+{
+	static const uint8_t bad[] = { 0x3f, 0x40, 0xc0, 0xff };
+	size_t failures = 0;
+
+	for (size_t off = WDNS_LEN_HEADER; off < sizeof(pkt); off++) {
+		for (size_t i = 0; i < sizeof(bad); i++) {
+			uint8_t buf[sizeof(pkt)];
+			unsigned n = 0;
+			wdns_message_t m;
+			wdns_res res, parse_res;
+
+			memcpy(buf, pkt, sizeof(pkt));
+			buf[off] = bad[i];
+			res = wdns_patch_message(buf, sizeof(buf), count_rr, &n);
+			parse_res = wdns_parse_message(&m, buf, sizeof(buf));
+			if ((res == wdns_res_success) != (parse_res == wdns_res_success)) {
+				fprintf(stderr, "FAIL: octet %zd = 0x%02x: %s, parse %s\n",
+					off, bad[i], wdns_res_to_str(res),
+					wdns_res_to_str(parse_res));
+				failures++;
+			}
+			if (parse_res == wdns_res_success)
+				wdns_clear_message(&m);
+		}
+	}
+
+	return (failures);
+}
+
+/* Patching a valid message allocates nothing. */
+static size_t
+test_patch_no_alloc(void)
+{
+	size_t failures = 0;
+#ifdef __GLIBC__
+	uint8_t buf[sizeof(pkt)];
+	unsigned n = 0;
+	size_t before;
+	wdns_res res;
+
+	memcpy(buf, pkt, sizeof(pkt));
+	before = n_allocs;
+	res = wdns_patch_message(buf, sizeof(buf), count_rr, &n);
+	if (res != wdns_res_success || n_allocs != before) {
+		fprintf(stderr, "FAIL: %s, %zd allocations\n", wdns_res_to_str(res),
+			n_allocs - before);
+		failures++;
+	}
+#endif
+	return (failures);
+}
+
+static int
+check(size_t ret, const char *s)
+{
+	if (ret == 0)
+		fprintf(stderr, NAME ": PASS: %s\n", s);
+	else
+		fprintf(stderr, NAME ": FAIL: %s (%" PRIu64 " failures)\n", s, ret);
+	return (ret);
+}
+
+int main (int argc, char **argv)
+{
+	int ret = 0;
+
+	ret |= check(test_patch_ttls(), "test-patch_message_ttls");
+	ret |= check(test_patch_message(), "test-patch_message");
+	ret |= check(test_patch_truncated(), "test-patch_message_truncated");
+	ret |= check(test_patch_corrupt(), "test-patch_message_corrupt");
+	ret |= check(test_patch_no_alloc(), "test-patch_message_no_alloc");
+
+	if (ret)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
@@ -79,6 +79,38 @@ struct test tdata[] = {
 		.expected = "ab-cd-ef-01-02-03",
 	},
 
+	{
+		.input = "\x00\x10\x03""foo\x07""example\x03""org\x00"
+			"\x00\x00\x00\x04\x00\x01\x00\x04"
+			"\x00\x01\x00\x09\x02h2\x05h3-19"
+			"\x00\x02\x00\x00"
+			"\x00\x03\x00\x02\x01\xbb"
+			"\x00\x04\x00\x08\xc0\x00\x02\x01\xc0\x00\x02\x02"
+			"\x00\x06\x00\x10\x20\x01\x0d\xb8\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x01"
+			"\x02\x9b\x00\x05hello",
+		.input_len = 19 + 8 + 13 + 4 + 6 + 12 + 20 + 9,
+		.rrtype = WDNS_TYPE_HTTPS,
+		.rrclass = WDNS_CLASS_IN,
+		.expected = "16 foo.example.org. mandatory=alpn,ipv4hint alpn=\"h2,h3-19\" no-default-alpn "
+			"port=443 ipv4hint=192.0.2.1,192.0.2.2 ipv6hint=2001:db8::1 key667=\"hello\"",
+	},
+
+	{
+		.input = "\x00\x10\x03""foo\x07""example\x03""org\x00\x00\x01\x00\x0c\x08""f\\oo,bar\x02h2",
+		.input_len = 35,
+		.rrtype = WDNS_TYPE_SVCB,
+		.rrclass = WDNS_CLASS_IN,
+		.expected = "16 foo.example.org. alpn=\"f\\\\\\\\oo\\\\,bar,h2\"",
+	},
+
+	{
+		.input = "\x00\x00\x03""foo\x07""example\x03""com\x00",
+		.input_len = 19,
+		.rrtype = WDNS_TYPE_HTTPS,
+		.rrclass = WDNS_CLASS_IN,
+		.expected = "0 foo.example.com.",
+	},
+
 	{
 		.input = "\xAB\xCD\xEF\x01\x02\x03\x04\x05",
 		.input_len = 8,
@@ -0,0 +1,303 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <wdns.h>
+
+#define NAME "test-render_message"
+
+/* compressed the way the renderer compresses: longest previous suffix */
+static const uint8_t pkt[] = {
+	/* header: id 0xbeef, qr aa rd ra, qd 1 an 2 ns 1 ar 3 */
+	0xbe, 0xef, 0x85, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x01, 0x00, 0x03,
+
+	/* question: example.com. IN MX */
+	0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+	0x00, 0x0f, 0x00, 0x01,
+
+	/* answer: example.com. 300 IN MX 10 mail.example.com. */
+	0xc0, 0x0c, 0x00, 0x0f, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x09,
+	0x00, 0x0a, 0x04, 'm', 'a', 'i', 'l', 0xc0, 0x0c,
+
+	/* answer: example.com. 300 IN MX 20 mx2.example.org. */
+	0xc0, 0x0c, 0x00, 0x0f, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x13,
+	0x00, 0x14, 0x03, 'm', 'x', '2',
+	0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'o', 'r', 'g', 0x00,
+
+	/* authority: example.com. 3600 IN NS ns1.example.com. */
+	0xc0, 0x0c, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x06,
+	0x03, 'n', 's', '1', 0xc0, 0x0c,
+
+	/* additional: mail.example.com. 300 IN A 192.0.2.25 */
+	0xc0, 0x2b, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x04,
+	192, 0, 2, 25,
+
+	/* additional: _sip._tcp.example.com. 300 IN SRV 0 5 5060 sip.example.com.
+	 * (SRV rdata is never compressed) */
+	0x04, '_', 's', 'i', 'p', 0x04, '_', 't', 'c', 'p', 0xc0, 0x0c,
+	0x00, 0x21, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x17,
+	0x00, 0x00, 0x00, 0x05, 0x13, 0xc4,
+	0x03, 's', 'i', 'p', 0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+
+	/* additional: OPT, size 4096, DO */
+	0x00, 0x00, 0x29, 0x10, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00,
+};
+
+static size_t
+test_render(void)
+{
+	size_t failures = 0;
+	uint8_t buf[512];
+	size_t sz;
+	wdns_message_t m;
+	wdns_res res;
+
+	res = wdns_parse_message(&m, pkt, sizeof(pkt));
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_parse_message: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+
+	res = wdns_render_message(&m, buf, sizeof(buf), &sz);
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_render_message: %s\n", wdns_res_to_str(res));
+		failures++;
+	} else if (sz != sizeof(pkt) || memcmp(buf, pkt, sz) != 0) {
+		fprintf(stderr, "FAIL: rendered message differs (%zd octets, expected %zd)\n",
+			sz, sizeof(pkt));
+		for (size_t i = 0; i < sz && i < sizeof(pkt); i++) {
+			if (buf[i] != pkt[i]) {
+				fprintf(stderr, "FAIL: first difference at offset %zd\n", i);
+				break;
+			}
+		}
+		failures++;
+	}
+
+	/* every shorter buffer must be refused */
+	for (size_t len = 0; len < sizeof(pkt); len++) {
+		if (wdns_render_message(&m, buf, len, &sz) != wdns_res_overflow) {
+			fprintf(stderr, "FAIL: buffer of %zd octets accepted\n", len);
+			failures++;
+		}
+	}
+
+	wdns_clear_message(&m);
+	return (failures);
+}
+
+/* Truncation points of pkt: the end of each RRset, plus the OPT RR. */
+static const struct {
+	size_t		limit;
+	bool		tc;
+	uint16_t	counts[WDNS_MSG_SEC_MAX];
+} cuts[] = {
+	{ 29 + 11, true, { 1, 0, 0, 1 } },
+	{ 81 + 11, true, { 1, 2, 0, 1 } },
+	{ 99 + 11, false, { 1, 2, 1, 1 } },
+	{ 115 + 11, false, { 1, 2, 1, 2 } },
+	{ sizeof(pkt), false, { 1, 2, 1, 3 } },
+};
+
+static size_t
+test_render_limit(void)
+{
+	size_t failures = 0;
+	uint8_t buf[512];
+	size_t sz, est_sz;
+	uint16_t counts[WDNS_MSG_SEC_MAX], est_counts[WDNS_MSG_SEC_MAX];
+	bool tc, est_tc;
+	wdns_message_t m, out;
+	wdns_res res;
+
+	res = wdns_parse_message(&m, pkt, sizeof(pkt));
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_parse_message: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+
+	if (wdns_render_message(&m, NULL, SIZE_MAX, &sz) != wdns_res_success ||
+	    sz != sizeof(pkt))
+	{
+		fprintf(stderr, "FAIL: size estimate %zd, expected %zd\n", sz, sizeof(pkt));
+		failures++;
+	}
+
+	for (size_t limit = 0; limit <= sizeof(pkt) + 1; limit++) {
+		unsigned c;
+
+		res = wdns_render_message_limit(&m, buf, limit, &sz, counts, &tc);
+		if (limit < cuts[0].limit) {
+			if (res != wdns_res_overflow) {
+				fprintf(stderr, "FAIL: limit %zd accepted\n", limit);
+				failures++;
+			}
+			continue;
+		}
+		for (c = 0; c + 1 < sizeof(cuts) / sizeof(cuts[0]) && limit >= cuts[c + 1].limit; c++)
+			;
+
+		if (res != wdns_res_success || sz != cuts[c].limit || tc != cuts[c].tc ||
+		    memcmp(counts, cuts[c].counts, sizeof(counts)) != 0)
+		{
+			fprintf(stderr, "FAIL: limit %zd: %s sz=%zd tc=%d counts=%u/%u/%u/%u\n",
+				limit, wdns_res_to_str(res), sz, tc,
+				counts[0], counts[1], counts[2], counts[3]);
+			failures++;
+			continue;
+		}
+
+		/* the estimate agrees with the rendering */
+		res = wdns_render_message_limit(&m, NULL, limit, &est_sz, est_counts, &est_tc);
+		if (res != wdns_res_success || est_sz != sz || est_tc != tc ||
+		    memcmp(counts, est_counts, sizeof(counts)) != 0)
+		{
+			fprintf(stderr, "FAIL: limit %zd: estimate differs\n", limit);
+			failures++;
+		}
+
+		/* the truncated message parses, with TC set as reported */
+		res = wdns_parse_message(&out, buf, sz);
+		if (res != wdns_res_success || (WDNS_FLAGS_TC(out) == 1) != tc ||
+		    !out.edns.present || out.edns.size != 4096 ||
+		    out.sections[WDNS_MSG_SEC_ANSWER].n_rrs != counts[WDNS_MSG_SEC_ANSWER])
+		{
+			fprintf(stderr, "FAIL: limit %zd: truncated message: %s\n",
+				limit, wdns_res_to_str(res));
+			failures++;
+		}
+		if (res == wdns_res_success)
+			wdns_clear_message(&out);
+	}
+
+	wdns_clear_message(&m);
+	return (failures);
+}
+
+/* A message that only has RRsets, as built by a caller, renders the same. */
+static size_t
+test_render_rrsets(void)
+{
+	size_t failures = 0;
+	uint8_t buf[512];
+	size_t sz;
+	char *s0 = NULL, *s1 = NULL;
+	wdns_message_t m, out;
+	wdns_res res;
+
+	res = wdns_parse_message(&m, pkt, sizeof(pkt));
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_parse_message: %s\n", wdns_res_to_str(res));
+		return (1);
+	}
+	s0 = wdns_message_to_str(&m);
+
+	for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++) {
+		wdns_rrset_array_t *a = &m.sections[sec];
+
+		for (unsigned i = 0; i < a->n_rrs; i++)
+			wdns_clear_rr(&a->rrs[i]);
+		free(a->rrs);
+		a->rrs = NULL;
+		a->n_rrs = 0;
+	}
+
+	res = wdns_render_message(&m, buf, sizeof(buf), &sz);
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_render_message: %s\n", wdns_res_to_str(res));
+		failures++;
+		goto out;
+	}
+	res = wdns_parse_message(&out, buf, sz);
+	if (res != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_parse_message: %s\n", wdns_res_to_str(res));
+		failures++;
+		goto out;
+	}
+	s1 = wdns_message_to_str(&out);
+	if (strcmp(s0, s1) != 0) {
+		fprintf(stderr, "FAIL: RRset rendering:\n%s\n%s\n", s0, s1);
+		failures++;
+	}
+	wdns_clear_message(&out);
+
+out:
+	free(s0);
+	free(s1);
+	wdns_clear_message(&m);
+	return (failures);
+}
+
+/*
+ * Enough RRsets that the names repeated within each RRset need more table
+ * entries than a fixed 512 octet message would.
+ */
+static size_t
+test_render_large(void)
+{
+	const unsigned n_rrsets = 400;
+	size_t failures = 0;
+	size_t sz, expect = 12;
+	wdns_message_t m;
+	wdns_rrset_array_t *a = &m.sections[WDNS_MSG_SEC_ANSWER];
+	char name[32];
+
+	memset(&m, 0, sizeof(m));
+	a->n_rrsets = n_rrsets;
+	a->rrsets = calloc(n_rrsets, sizeof(wdns_rrset_t));
+	for (unsigned i = 0; i < n_rrsets; i++) {
+		wdns_rrset_t *rrset = &a->rrsets[i];
+
+		snprintf(name, sizeof(name), "h%u.example.com", i);
+		wdns_str_to_name(name, &rrset->name);
+		rrset->rrtype = WDNS_TYPE_A;
+		rrset->rrclass = WDNS_CLASS_IN;
+		rrset->n_rdatas = 2;
+		rrset->rdatas = calloc(2, sizeof(wdns_rdata_t *));
+		for (unsigned j = 0; j < 2; j++) {
+			rrset->rdatas[j] = calloc(1, sizeof(wdns_rdata_t) + 4);
+			rrset->rdatas[j]->len = 4;
+			rrset->rdatas[j]->data[3] = j;
+		}
+
+		/* "hN" and a pointer to example.com (written in full the first
+		 * time), then a pointer to the whole owner name */
+		snprintf(name, sizeof(name), "h%u", i);
+		expect += 1 + strlen(name) + (i == 0 ? 13 : 2) + 10 + 4;
+		expect += 2 + 10 + 4;
+	}
+
+	if (wdns_render_message(&m, NULL, 65535, &sz) != wdns_res_success || sz != expect) {
+		fprintf(stderr, "FAIL: large message: %zd octets, expected %zd\n", sz, expect);
+		failures++;
+	}
+
+	wdns_clear_message(&m);
+	return (failures);
+}
+
+static int
+check(size_t ret, const char *s)
+{
+	if (ret == 0)
+		fprintf(stderr, NAME ": PASS: %s\n", s);
+	else
+		fprintf(stderr, NAME ": FAIL: %s (%" PRIu64 " failures)\n", s, ret);
+	return (ret);
+}
+
+int main (int argc, char **argv)
+{
+	int ret = 0;
+
+	ret |= check(test_render(), "test-render_message");
+	ret |= check(test_render_rrsets(), "test-render_message_rrsets");
+	ret |= check(test_render_limit(), "test-render_message_limit");
+	ret |= check(test_render_large(), "test-render_message_large");
+
+	if (ret)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <wdns.h>
+
+#define NAME "test-signing_input"
+
+/* MX rdatas, unsorted, mixed case, and with a duplicate in canonical form */
+static const struct {
+	size_t		len;
+	const char	*data;
+} mx[] = {
+	{ 10, "\x00\x14\x03MX2\x02\x65x\x00" },
+	{ 20, "\x00\x0a\x04Mail\x07\x45xample\x03\x63om\x00" },
+	{ 10, "\x00\x14\x03mx2\x02\x65x\x00" },
+	{ 20, "\x00\x0a\x04mail\x07\x65xample\x03\x43OM\x00" },
+	{ 10, "\x00\x0a\x03zzz\x02\x65x\x00" },
+};
+
+/* type MX, alg 8, labels 2, original TTL 3600, expiration, inception,
+ * key tag 0x1234, signer Example.COM, signature */
+static const uint8_t rrsig_data[] =
+	"\x00\x0f\x08\x02\x00\x00\x0e\x10\x60\x00\x00\x00\x5f\x00\x00\x00\x12\x34"
+	"\x07\x45xample\x03\x43OM\x00"
+	"\xde\xad\xbe\xef";
+
+static const uint8_t expect_rrsig[] =
+	"\x00\x0f\x08\x02\x00\x00\x0e\x10\x60\x00\x00\x00\x5f\x00\x00\x00\x12\x34"
+	"\x07\x65xample\x03\x63om\x00";
+
+static const uint8_t expect_rr[][40] = {
+	"\x00\x0f\x00\x01\x00\x00\x0e\x10\x00\x0a"
+	"\x00\x0a\x03zzz\x02\x65x\x00",
+	"\x00\x0f\x00\x01\x00\x00\x0e\x10\x00\x14"
+	"\x00\x0a\x04mail\x07\x65xample\x03\x63om\x00",
+	"\x00\x0f\x00\x01\x00\x00\x0e\x10\x00\x0a"
+	"\x00\x14\x03mx2\x02\x65x\x00",
+};
+static const size_t expect_rr_len[] = { 10 + 10, 10 + 20, 10 + 10 };
+
+static bool
+make_rrset(wdns_rrset_t *rrset, const char *owner)
+{
+	memset(rrset, 0, sizeof(*rrset));
+	if (wdns_str_to_name_case(owner, &rrset->name) != wdns_res_success)
+		return (false);
+	rrset->rrtype = WDNS_TYPE_MX;
+	rrset->rrclass = WDNS_CLASS_IN;
+	rrset->rrttl = 300;
+	rrset->n_rdatas = sizeof(mx) / sizeof(mx[0]);
+	rrset->rdatas = calloc(rrset->n_rdatas, sizeof(wdns_rdata_t *));
+	for (size_t i = 0; i < rrset->n_rdatas; i++) {
+		rrset->rdatas[i] = malloc(sizeof(wdns_rdata_t) + mx[i].len);
+		rrset->rdatas[i]->len = mx[i].len;
+		memcpy(rrset->rdatas[i]->data, mx[i].data, mx[i].len);
+	}
+	return (true);
+}
+
+/* Build the expected signing input for the given (lowercase) owner. */
+static size_t
+make_expected(uint8_t *buf, const uint8_t *owner, size_t owner_len, bool sig)
+{
+	size_t off = 0;
+
+	if (sig) {
+		memcpy(buf, expect_rrsig, sizeof(expect_rrsig) - 1);
+		off += sizeof(expect_rrsig) - 1;
+	}
+	for (size_t i = 0; i < sizeof(expect_rr) / sizeof(expect_rr[0]); i++) {
+		memcpy(buf + off, owner, owner_len);
+		off += owner_len;
+		memcpy(buf + off, expect_rr[i], expect_rr_len[i]);
+		if (!sig)
+			memcpy(buf + off + 4, "\x00\x00\x01\x2c", 4);
+		off += expect_rr_len[i];
+	}
+	return (off);
+}
+
+struct collect {
+	uint8_t		buf[1024];
+	size_t		len;
+	size_t		n_calls;
+};
+
+static void
+collect_cb(const uint8_t *data, size_t len, void *user)
+{
+	struct collect *c = user;
+
+	if (c->len + len <= sizeof(c->buf))
+		memcpy(c->buf + c->len, data, len);
+	c->len += len;
+	c->n_calls++;
+}
+
+static size_t
+check_input(const wdns_rrset_t *rrset, const wdns_rdata_t *rrsig,
+	    const uint8_t *expect, size_t expect_len, const char *what)
+{
+	size_t failures = 0;
+	struct collect c = { .len = 0 };
+	uint8_t buf[1024];
+	size_t sz = 0;
+	wdns_res res;
+
+	res = wdns_rrset_signing_input(rrset, rrsig, buf, sizeof(buf), &sz);
+	if (res != wdns_res_success || sz != expect_len || memcmp(buf, expect, sz) != 0) {
+		fprintf(stderr, "FAIL: %s: %s, %zd octets, expected %zd\n",
+			what, wdns_res_to_str(res), sz, expect_len);
+		failures++;
+	}
+
+	res = wdns_rrset_signing_input(rrset, rrsig, NULL, 0, &sz);
+	if (res != wdns_res_success || sz != expect_len) {
+		fprintf(stderr, "FAIL: %s: length only: %zd octets\n", what, sz);
+		failures++;
+	}
+
+	for (size_t len = 0; len < expect_len; len++) {
+		if (wdns_rrset_signing_input(rrset, rrsig, buf, len, &sz) != wdns_res_overflow) {
+			fprintf(stderr, "FAIL: %s: buffer of %zd octets accepted\n", what, len);
+			failures++;
+		}
+	}
+
+	res = wdns_rrset_signing_input_cb(rrset, rrsig, collect_cb, &c);
+	if (res != wdns_res_success || c.len != expect_len ||
+	    memcmp(c.buf, expect, c.len) != 0 || c.n_calls < 2)
+	{
+		fprintf(stderr, "FAIL: %s: callback: %s, %zd octets\n",
+			what, wdns_res_to_str(res), c.len);
+		failures++;
+	}
+
+	return (failures);
+}
+
+static size_t
+test_canonical(void)
+{
+	size_t failures = 0;
+	const uint8_t owner[] = "\x07\x65xample\x03\x63om";
+	uint8_t expect[1024];
+	size_t expect_len;
+	wdns_rdata_t *rrsig;
+	wdns_rrset_t rrset;
+
+	if (!make_rrset(&rrset, "Example.COM"))
+		return (1);
+	rrsig = malloc(sizeof(wdns_rdata_t) + sizeof(rrsig_data) - 1);
+	rrsig->len = sizeof(rrsig_data) - 1;
+	memcpy(rrsig->data, rrsig_data, rrsig->len);
+
+	expect_len = make_expected(expect, owner, sizeof(owner), false);
+	failures += check_input(&rrset, NULL, expect, expect_len, "no rrsig");
+
+	expect_len = make_expected(expect, owner, sizeof(owner), true);
+	failures += check_input(&rrset, rrsig, expect, expect_len, "rrsig");
+
+	/* the RRset is unmodified */
+	for (size_t i = 0; i < rrset.n_rdatas; i++) {
+		if (memcmp(rrset.rdatas[i]->data, mx[i].data, mx[i].len) != 0) {
+			fprintf(stderr, "FAIL: rdata %zd modified\n", i);
+			failures++;
+		}
+	}
+
+	/* an RRSIG covering another type */
+	rrsig->data[1] = WDNS_TYPE_A;
+	if (wdns_rrset_signing_input(&rrset, rrsig, NULL, 0, &expect_len) != wdns_res_parse_error) {
+		fprintf(stderr, "FAIL: RRSIG type covered mismatch accepted\n");
+		failures++;
+	}
+	rrsig->data[1] = WDNS_TYPE_MX;
+
+	/* an RRSIG with more labels than the owner */
+	rrsig->data[3] = 3;
+	if (wdns_rrset_signing_input(&rrset, rrsig, NULL, 0, &expect_len) != wdns_res_parse_error) {
+		fprintf(stderr, "FAIL: RRSIG labels mismatch accepted\n");
+		failures++;
+	}
+
+	free(rrsig);
+	wdns_clear_rrset(&rrset);
+	return (failures);
+}
+
+static size_t
+test_wildcard(void)
+{
+	size_t failures = 0;
+	const uint8_t owner[] = "\x01*\x07\x65xample\x03\x63om";
+	uint8_t expect[1024];
+	size_t expect_len;
+	wdns_rdata_t *rrsig;
+	wdns_rrset_t rrset;
+
+	rrsig = malloc(sizeof(wdns_rdata_t) + sizeof(rrsig_data) - 1);
+	rrsig->len = sizeof(rrsig_data) - 1;
+	memcpy(rrsig->data, rrsig_data, rrsig->len);
+	expect_len = make_expected(expect, owner, sizeof(owner), true);
+
+	/* synthesized from *.example.com */
+	if (!make_rrset(&rrset, "A.b.Example.COM"))
+		return (1);
+	failures += check_input(&rrset, rrsig, expect, expect_len, "wildcard expansion");
+	wdns_clear_rrset(&rrset);
+
+	/* the wildcard itself */
+	if (!make_rrset(&rrset, "*.Example.COM"))
+		return (1);
+	failures += check_input(&rrset, rrsig, expect, expect_len, "wildcard owner");
+	wdns_clear_rrset(&rrset);
+
+	/* synthesized from *.example.com by a wildcard whose owner is itself a
+	 * literal "*" label */
+	if (!make_rrset(&rrset, "*.b.Example.COM"))
+		return (1);
+	failures += check_input(&rrset, rrsig, expect, expect_len, "wildcard expansion of *");
+	wdns_clear_rrset(&rrset);
+
+	free(rrsig);
+	return (failures);
+}
+
+static int
+check(size_t ret, const char *s)
+{
+	if (ret == 0)
+		fprintf(stderr, NAME ": PASS: %s\n", s);
+	else
+		fprintf(stderr, NAME ": FAIL: %s (%" PRIu64 " failures)\n", s, ret);
+	return (ret);
+}
+
+int main (int argc, char **argv)
+{
+	int ret = 0;
+
+	ret |= check(test_canonical(), "test-signing_input_canonical");
+	ret |= check(test_wildcard(), "test-signing_input_wildcard");
+
+	if (ret)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
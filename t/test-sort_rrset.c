@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <wdns.h>
+
+#define NAME "test-sort_rrset"
+
+/* The order wdns_sort_rrset() has always produced. */
+static int
+ref_cmp(const void *e1, const void *e2)
+{
+	const wdns_rdata_t *r1 = *((wdns_rdata_t **) e1);
+	const wdns_rdata_t *r2 = *((wdns_rdata_t **) e2);
+
+	if (r1->len < r2->len) {
+		return (-1);
+	} else if (r1->len > r2->len) {
+		return (1);
+	} else {
+		return (memcmp(r1->data, r2->data, r1->len));
+	}
+}
+
+/*
+ * Build an RRset of n rdatas with lengths in [min_len, max_len]. The first
+ * prefix octets of every rdata are equal, and the remaining octets are drawn
+ * from an alphabet of the given size, so that duplicates and shared prefixes
+ * are common.
+ */
+static void
+make_rrset(wdns_rrset_t *rrset, size_t n, uint16_t min_len, uint16_t max_len,
+	   uint16_t prefix, unsigned alphabet)
+{
+	memset(rrset, 0, sizeof(*rrset));
+	rrset->n_rdatas = n;
+	rrset->rdatas = calloc(n, sizeof(wdns_rdata_t *));
+	for (size_t i = 0; i < n; i++) {
+		uint16_t len = min_len + random() % (max_len - min_len + 1);
+
+		rrset->rdatas[i] = malloc(sizeof(wdns_rdata_t) + len);
+		rrset->rdatas[i]->len = len;
+		for (uint16_t j = 0; j < len; j++)
+			rrset->rdatas[i]->data[j] = j < prefix ? 'x' : (uint8_t) (0xfe + random() % alphabet);
+	}
+}
+
+static size_t
+check_sort(size_t n, uint16_t min_len, uint16_t max_len, uint16_t prefix, unsigned alphabet)
+{
+	wdns_rrset_t rrset;
+	wdns_rdata_t **expect;
+	size_t failures = 0;
+
+	make_rrset(&rrset, n, min_len, max_len, prefix, alphabet);
+	expect = malloc(n * sizeof(*expect));
+	memcpy(expect, rrset.rdatas, n * sizeof(*expect));
+	qsort(expect, n, sizeof(*expect), ref_cmp);
+
+	if (wdns_sort_rrset(&rrset) != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_sort_rrset\n");
+		failures++;
+	}
+	for (size_t i = 0; i < n; i++) {
+		if (ref_cmp(&rrset.rdatas[i], &expect[i]) != 0) {
+			fprintf(stderr, "FAIL: n=%zd len=%u-%u prefix=%u: rdata %zd out of order\n",
+				n, min_len, max_len, prefix, i);
+			failures++;
+			break;
+		}
+	}
+
+	/* the sort is a permutation */
+	for (size_t i = 0; i < n; i++) {
+		size_t j;
+
+		for (j = 0; j < n && expect[j] != rrset.rdatas[i]; j++)
+			;
+		if (j == n) {
+			fprintf(stderr, "FAIL: rdata %zd lost\n", i);
+			failures++;
+			break;
+		}
+	}
+
+	free(expect);
+	wdns_clear_rrset(&rrset);
+	return (failures);
+}
+
+static size_t
+test_sort(void)
+{
+	size_t failures = 0;
+
+	srandom(1);
+
+	for (size_t n = 0; n <= 40; n++) {
+		failures += check_sort(n, 4, 4, 0, 2);
+		failures += check_sort(n, 0, 6, 0, 2);
+	}
+
+	/* fixed-width keys */
+	failures += check_sort(1000, 4, 4, 0, 2);
+	failures += check_sort(1000, 4, 4, 0, 256);
+	failures += check_sort(1000, 16, 16, 8, 3);
+	failures += check_sort(500, 0, 0, 0, 1);
+
+	/* variable length */
+	failures += check_sort(1000, 0, 40, 0, 2);
+	failures += check_sort(1000, 1, 300, 0, 256);
+	failures += check_sort(1000, 255, 257, 0, 2);
+	failures += check_sort(1000, 17, 17, 0, 2);
+
+	/* long common prefixes, and enough shared octets to reach the
+	 * depth limit */
+	failures += check_sort(500, 200, 210, 190, 2);
+	failures += check_sort(2000, 80, 80, 0, 2);
+
+	return (failures);
+}
+
+static bool
+make_ns_rrset(wdns_rrset_t *rrset, const char *owner, uint32_t ttl, const char **names, size_t n)
+{
+	memset(rrset, 0, sizeof(*rrset));
+	if (wdns_str_to_name_case(owner, &rrset->name) != wdns_res_success)
+		return (false);
+	rrset->rrtype = WDNS_TYPE_NS;
+	rrset->rrclass = WDNS_CLASS_IN;
+	rrset->rrttl = ttl;
+	rrset->n_rdatas = n;
+	rrset->rdatas = calloc(n, sizeof(wdns_rdata_t *));
+	for (size_t i = 0; i < n; i++) {
+		wdns_name_t name;
+
+		if (wdns_str_to_name_case(names[i], &name) != wdns_res_success)
+			return (false);
+		rrset->rdatas[i] = malloc(sizeof(wdns_rdata_t) + name.len);
+		rrset->rdatas[i]->len = name.len;
+		memcpy(rrset->rdatas[i]->data, name.data, name.len);
+		free(name.data);
+	}
+	return (true);
+}
+
+static size_t
+test_normalize(void)
+{
+	static const char *ns0[] = {
+		"NS2.example.com", "ns1.EXAMPLE.com", "ns0.example.com",
+		"ns1.example.com", "ns2.example.com", "NS1.Example.Com",
+	};
+	static const char *ns1[] = {
+		"ns0.example.com", "ns1.example.com", "ns2.example.com",
+	};
+	static const char *ns2[] = {
+		"ns0.example.com", "ns1.example.com", "ns3.example.com",
+	};
+	size_t failures = 0;
+	wdns_rrset_t r0, r1, r2;
+	uint64_t h0, h1, h2;
+
+	if (!make_ns_rrset(&r0, "WWW.Example.com", 300, ns0, 6) ||
+	    !make_ns_rrset(&r1, "www.example.com", 3600, ns1, 3) ||
+	    !make_ns_rrset(&r2, "www.example.com", 300, ns2, 3))
+	{
+		return (1);
+	}
+
+	if (wdns_normalize_rrset(&r0, &h0) != wdns_res_success ||
+	    wdns_normalize_rrset(&r1, &h1) != wdns_res_success ||
+	    wdns_normalize_rrset(&r2, &h2) != wdns_res_success)
+	{
+		fprintf(stderr, "FAIL: wdns_normalize_rrset\n");
+		failures++;
+		goto out;
+	}
+
+	/* downcased, sorted, and deduplicated; equal up to TTL */
+	if (r0.n_rdatas != 3 || r0.name.len != r1.name.len ||
+	    memcmp(r0.name.data, r1.name.data, r0.name.len) != 0)
+	{
+		fprintf(stderr, "FAIL: normalized RRset has %u rdatas\n", r0.n_rdatas);
+		failures++;
+		goto out;
+	}
+	for (size_t i = 0; i < 3; i++) {
+		if (ref_cmp(&r0.rdatas[i], &r1.rdatas[i]) != 0) {
+			fprintf(stderr, "FAIL: normalized rdata %zd\n", i);
+			failures++;
+		}
+	}
+
+	if (h0 != h1 || h0 == h2) {
+		fprintf(stderr, "FAIL: hashes %016" PRIx64 " %016" PRIx64 " %016" PRIx64 "\n",
+			h0, h1, h2);
+		failures++;
+	}
+
+	/* the hash is stable */
+	if (h1 != UINT64_C(0x6bb98725a9325317)) {
+		fprintf(stderr, "FAIL: hash %016" PRIx64 "\n", h1);
+		failures++;
+	}
+
+out:
+	wdns_clear_rrset(&r0);
+	wdns_clear_rrset(&r1);
+	wdns_clear_rrset(&r2);
+	return (failures);
+}
+
+static int
+check(size_t ret, const char *s)
+{
+	if (ret == 0)
+		fprintf(stderr, NAME ": PASS: %s\n", s);
+	else
+		fprintf(stderr, NAME ": FAIL: %s (%" PRIu64 " failures)\n", s, ret);
+	return (ret);
+}
+
+int main (int argc, char **argv)
+{
+	int ret = 0;
+
+	ret |= check(test_sort(), "test-sort_rrset");
+	ret |= check(test_normalize(), "test-normalize_rrset");
+
+	if (ret)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
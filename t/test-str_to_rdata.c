@@ -246,6 +246,27 @@ static const struct test tdata[] = {
 	{ "1 1 10 7225a239d4230bba7be2 O4K23SKVI7PTGVR5LRITC8IDIQ6KJVA0 NS DS RRSIG", WDNS_TYPE_NSEC3, WDNS_CLASS_IN, "\x01\x01\x00\x0a\x0ar%\xa2""9\xd4#\x0b\xba{\xe2\x14\xc1(!\xf2\x9f\x91\xf3\xd8\x7f""e\xae\xe5\xd6\"M\x96\x8dI\xfd@\x00\x06 \x00\x00\x00\x00\x12", 44, wdns_res_success },
 	{ "NSEC 5 5 7200 1442949945 1440354345 34572 5.in-addr.arpa. aTPqHqvtDsdyY6acy5BzbmjzJcdNWeFW2laTYY/+NJsMAedSryvDJKkA evVh4Fv4G+o9Ts3XKhYUihW2qXp7bbhHmlIvSY3qX67/Ti9DzRPymirt m5ffESFO7+4H2QFd5xIpoJH/WQysNWzCyLt+JeguH4/7PU5C9K30cqqd vJk=", WDNS_TYPE_RRSIG, WDNS_CLASS_IN, "\x00/\x05\x05\x00\x00\x1c V\x01\xab""9U\xda\x10)\x87\x0c\x01""5\x07in-addr\x04""arpa\x00i3\xea\x1e\xab\xed\x0e\xc7rc\xa6\x9c\xcb\x90snh\xf3%\xc7MY\xe1V\xdaV\x93""a\x8f\xfe""4\x9b\x0c\x01\xe7R\xaf+\xc3$\xa9\x00z\xf5""a\xe0[\xf8\x1b\xea=N\xcd\xd7*\x16\x14\x8a\x15\xb6\xa9z{m\xb8G\x9aR/I\x8d\xea_\xae\xffN/C\xcd\x13\xf2\x9a*\xed\x9b\x97\xdf\x11!N\xef\xee\x07\xd9\x01]\xe7\x12)\xa0\x91\xffY\x0c\xac""5l\xc2\xc8\xbb~%\xe8.\x1f\x8f\xfb=NB\xf4\xad\xf4r\xaa\x9d\xbc\x99", 162, wdns_res_success },
 	{ "NSEC3 10 3 172800 1443179274 1440584754 25427 go.id. TzGzKBNpQysYIEBHzCMub5PSg6H564xt2c/JYW6fCOyoUesDqECbJHDl 6pgyQaicCrsdSuqImSi1Ej63OEgJ1o5gKUQh0brq7i8oDZ343M57j9O7 hk7Hm+066r2dEKAD2c0SKeFTdOhjWk01Opkw+DW0SbhvKbsngII3e5mb y7+uSW3TH0OX/nOZMte8F1z98UyGKjRsInlXfc4nh2TknrwvGFgRZoS1 X2PWLkzVQSjGsfLS1/N01TYVGe0IyDWoY6csNQhnSS53Z1WAIZOuSoV5 oBBCQIQFDjknqT9/YkqQNCJso0xGcr2CyQHKcVduxYGgVarEABANrDQV DxpuEeaYGS7+eGJT+sznItOTQeSSYougSu6DsxVwYyTix/alO+KpUwzP 7YZBJIssnHYdqUvXQlcxpYtlhEYcISlcP5Ate/A2hoDR+KXo1+6ydBUy gmNTLRYVX7N+ajRnBIAhAoaGotpgzUe3uZIoiKi8FY/L4glE93mFCBqb +4mJ7O5rtWlnHy9jMlW9AIzoqfDmLoNaTUF1D6mdkVU5Gs+E0gST6Mln arJtIHttDLz/GZMOnd79+GKTdKUr5Ch4QP5LALys6WDWa2EdUg2ZWH5m hqU+5XQDMcOFyeyLsqudy4DkXk2rFMtGQlU0crzaKKyf+qSeMbXMda1F GU+kwrQvgtE=", WDNS_TYPE_RRSIG, WDNS_CLASS_IN, "\x00""2\x0a\x03\x00\x02\xa3\x00V\x05+\x0aU\xdd\x94""2cS\x02go\x02id\x00O1\xb3(\x13iC+\x18 @G\xcc#.o\x93\xd2\x83\xa1\xf9\xeb\x8cm\xd9\xcf\xc9""an\x9f\x08\xec\xa8Q\xeb\x03\xa8@\x9b$p\xe5\xea\x98""2A\xa8\x9c\x0a\xbb\x1dJ\xea\x88\x99(\xb5\x12>\xb7""8H\x09\xd6\x8e`)D!\xd1\xba\xea\xee/(\x0d\x9d\xf8\xdc\xce{\x8f\xd3\xbb\x86N\xc7\x9b\xed:\xea\xbd\x9d\x10\xa0\x03\xd9\xcd\x12)\xe1St\xe8""cZM5:\x99""0\xf8""5\xb4I\xb8o)\xbb'\x80\x82""7{\x99\x9b\xcb\xbf\xaeIm\xd3\x1f""C\x97\xfes\x99""2\xd7\xbc\x17\\\xfd\xf1L\x86*4l\"yW}\xce'\x87""d\xe4\x9e\xbc/\x18X\x11""f\x84\xb5_c\xd6.L\xd5""A(\xc6\xb1\xf2\xd2\xd7\xf3t\xd5""6\x15\x19\xed\x08\xc8""5\xa8""c\xa7,5\x08gI.wgU\x80!\x93\xaeJ\x85y\xa0\x10""B@\x84\x05\x0e""9'\xa9?\x7f""bJ\x90""4\"l\xa3LFr\xbd\x82\xc9\x01\xcaqWn\xc5\x81\xa0U\xaa\xc4\x00\x10\x0d\xac""4\x15\x0f\x1an\x11\xe6\x98\x19.\xfexbS\xfa\xcc\xe7\"\xd3\x93""A\xe4\x92""b\x8b\xa0J\xee\x83\xb3\x15pc$\xe2\xc7\xf6\xa5;\xe2\xa9S\x0c\xcf\xed\x86""A$\x8b,\x9cv\x1d\xa9K\xd7""BW1\xa5\x8b""e\x84""F\x1c!)\\?\x90-{\xf0""6\x86\x80\xd1\xf8\xa5\xe8\xd7\xee\xb2t\x15""2\x82""cS-\x16\x15_\xb3~j4g\x04\x80!\x02\x86\x86\xa2\xda`\xcdG\xb7\xb9\x92(\x88\xa8\xbc\x15\x8f\xcb\xe2\x09""D\xf7y\x85\x08\x1a\x9b\xfb\x89\x89\xec\xeek\xb5ig\x1f/c2U\xbd\x00\x8c\xe8\xa9\xf0\xe6.\x83ZMAu\x0f\xa9\x9d\x91U9\x1a\xcf\x84\xd2\x04\x93\xe8\xc9gj\xb2m {m\x0c\xbc\xff\x19\x93\x0e\x9d\xde\xfd\xf8""b\x93t\xa5+\xe4(x@\xfeK\x00\xbc\xac\xe9`\xd6ka\x1dR\x0d\x99X~f\x86\xa5>\xe5t\x03""1\xc3\x85\xc9\xec\x8b\xb2\xab\x9d\xcb\x80\xe4^M\xab\x14\xcb""FBU4r\xbc\xda(\xac\x9f\xfa\xa4\x9e""1\xb5\xccu\xad""E\x19O\xa4\xc2\xb4/\x82\xd1", 537, wdns_res_success },
+	/* RFC 9460 appendix D */
+	{ "0 foo.example.com.", WDNS_TYPE_HTTPS, WDNS_CLASS_IN, "\x00\x00\x03""foo\x07""example\x03""com\x00", 19, wdns_res_success },
+	{ "1 .", WDNS_TYPE_SVCB, WDNS_CLASS_IN, "\x00\x01\x00", 3, wdns_res_success },
+	{ "16 foo.example.com. port=53", WDNS_TYPE_SVCB, WDNS_CLASS_IN, "\x00\x10\x03""foo\x07""example\x03""com\x00\x00\x03\x00\x02\x00\x35", 25, wdns_res_success },
+	{ "1 foo.example.com. key667=hello", WDNS_TYPE_SVCB, WDNS_CLASS_IN, "\x00\x01\x03""foo\x07""example\x03""com\x00\x02\x9b\x00\x05hello", 28, wdns_res_success },
+	{ "1 foo.example.com. key667=\"hello\\210qoo\"", WDNS_TYPE_SVCB, WDNS_CLASS_IN, "\x00\x01\x03""foo\x07""example\x03""com\x00\x02\x9b\x00\x09hello\xd2qoo", 32, wdns_res_success },
+	{ "1 foo.example.com. ipv6hint=\"2001:db8::1,2001:db8::53:1\"", WDNS_TYPE_SVCB, WDNS_CLASS_IN, "\x00\x01\x03""foo\x07""example\x03""com\x00\x00\x06\x00\x20\x20\x01\x0d\xb8\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x01\x20\x01\x0d\xb8\x00\x00\x00\x00\x00\x00\x00\x00\x00\x53\x00\x01", 55, wdns_res_success },
+	{ "16 foo.example.org. alpn=h2,h3-19 mandatory=ipv4hint,alpn ipv4hint=192.0.2.1", WDNS_TYPE_SVCB, WDNS_CLASS_IN, "\x00\x10\x03""foo\x07""example\x03""org\x00\x00\x00\x00\x04\x00\x01\x00\x04\x00\x01\x00\x09\x02h2\x05h3-19\x00\x04\x00\x04\xc0\x00\x02\x01", 48, wdns_res_success },
+	{ "1 . mandatory=key667,port,alpn port=53 alpn=h2 key667=x", WDNS_TYPE_SVCB, WDNS_CLASS_IN, "\x00\x01\x00\x00\x00\x00\x06\x00\x01\x00\x03\x02\x9b\x00\x01\x00\x03\x02h2\x00\x03\x00\x02\x00\x35\x02\x9b\x00\x01x", 31, wdns_res_success },
+	{ "16 foo.example.org. alpn=\"f\\\\\\\\oo\\\\,bar,h2\"", WDNS_TYPE_SVCB, WDNS_CLASS_IN, "\x00\x10\x03""foo\x07""example\x03""org\x00\x00\x01\x00\x0c\x08""f\\oo,bar\x02h2", 35, wdns_res_success },
+	{ "1 foo.example.com. key123=abc key123=def", WDNS_TYPE_SVCB, WDNS_CLASS_IN, 0, 0, wdns_res_parse_error },
+	{ "1 foo.example.com. mandatory", WDNS_TYPE_SVCB, WDNS_CLASS_IN, 0, 0, wdns_res_parse_error },
+	{ "1 foo.example.com. alpn", WDNS_TYPE_SVCB, WDNS_CLASS_IN, 0, 0, wdns_res_parse_error },
+	{ "1 foo.example.com. port", WDNS_TYPE_SVCB, WDNS_CLASS_IN, 0, 0, wdns_res_parse_error },
+	{ "1 foo.example.com. ipv4hint", WDNS_TYPE_SVCB, WDNS_CLASS_IN, 0, 0, wdns_res_parse_error },
+	{ "1 foo.example.com. ipv6hint", WDNS_TYPE_SVCB, WDNS_CLASS_IN, 0, 0, wdns_res_parse_error },
+	{ "1 foo.example.com. no-default-alpn=abc", WDNS_TYPE_SVCB, WDNS_CLASS_IN, 0, 0, wdns_res_parse_error },
+	{ "1 foo.example.com. mandatory=mandatory", WDNS_TYPE_SVCB, WDNS_CLASS_IN, 0, 0, wdns_res_parse_error },
+	{ "1 foo.example.com. ipv4hint=1.2.3.4 ipv4hint=5.6.7.8", WDNS_TYPE_SVCB, WDNS_CLASS_IN, 0, 0, wdns_res_parse_error },
+	{ "1 foo.example.com. port=65536", WDNS_TYPE_SVCB, WDNS_CLASS_IN, 0, 0, wdns_res_parse_error },
+	{ "1 foo.example.com. unknown=1", WDNS_TYPE_SVCB, WDNS_CLASS_IN, 0, 0, wdns_res_parse_error },
 	/* generic encodings */
 	{ "\\# 24 d5 79 08 01 98 4e d2 96 9a 76 0c f6 09 8e a1 4a 84 65 16 9c aa 9c 48 07", 32769, WDNS_CLASS_IN, "\xd5\x79\x08\x01\x98\x4e\xd2\x96\x9a\x76\x0c\xf6\x09\x8e\xa1\x4a\x84\x65\x16\x9c\xaa\x9c\x48\x07", 24, wdns_res_success },
 	{ 0 }
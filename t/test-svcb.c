@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <wdns.h>
+
+#define NAME "test-svcb"
+
+static const uint8_t rdata[] = {
+	0x00, 0x01, 0x00,
+	/* alpn=h2,h3 */
+	0x00, 0x01, 0x00, 0x06, 0x02, 'h', '2', 0x02, 'h', '3',
+	/* ipv4hint=192.0.2.1,192.0.2.2 */
+	0x00, 0x04, 0x00, 0x08, 192, 0, 2, 1, 192, 0, 2, 2,
+	/* ipv6hint=2001:db8::1 */
+	0x00, 0x06, 0x00, 0x10,
+	0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01,
+};
+
+/* SvcParams following "1 ." which must be rejected. */
+static const struct {
+	const char	*desc;
+	const char	*params;
+	size_t		len;
+} bad[] = {
+	{ "keys out of order", "\x00\x03\x00\x02\x01\xbb\x00\x01\x00\x03\x02h2", 13 },
+	{ "duplicate key", "\x00\x03\x00\x02\x01\xbb\x00\x03\x00\x02\x01\xbb", 12 },
+	{ "truncated parameter", "\x00\x03\x00\x04\x01\xbb", 6 },
+	{ "truncated key", "\x00\x03\x00", 3 },
+	{ "empty alpn", "\x00\x01\x00\x00", 4 },
+	{ "alpn overrun", "\x00\x01\x00\x03\x03h2", 7 },
+	{ "short port", "\x00\x03\x00\x01\x01", 5 },
+	{ "ipv4hint length", "\x00\x04\x00\x05\xc0\x00\x02\x01\x00", 9 },
+	{ "ipv6hint length", "\x00\x06\x00\x04\xc0\x00\x02\x01", 8 },
+	{ "no-default-alpn value", "\x00\x02\x00\x01\x00", 5 },
+	{ "mandatory lists itself", "\x00\x00\x00\x02\x00\x00", 6 },
+};
+
+static size_t
+test_iter(void)
+{
+	size_t failures = 0;
+	wdns_svcparam_iter_t it;
+	wdns_svcparam_t param;
+	const uint8_t *id, *addr;
+	uint8_t id_len;
+	size_t off = 0;
+	wdns_res res;
+
+	if (wdns_svcparam_iter_init(&it, rdata, sizeof(rdata)) != wdns_res_success) {
+		fprintf(stderr, "FAIL: wdns_svcparam_iter_init\n");
+		return (1);
+	}
+
+	/* alpn */
+	if (wdns_svcparam_iter_next(&it, &param) != wdns_res_success ||
+	    param.key != WDNS_SVCPARAM_ALPN)
+	{
+		fprintf(stderr, "FAIL: alpn\n");
+		return (failures + 1);
+	}
+	if (!wdns_svcparam_alpn_next(&param, &off, &id, &id_len) ||
+	    id_len != 2 || memcmp(id, "h2", 2) != 0 ||
+	    !wdns_svcparam_alpn_next(&param, &off, &id, &id_len) ||
+	    id_len != 2 || memcmp(id, "h3", 2) != 0 ||
+	    wdns_svcparam_alpn_next(&param, &off, &id, &id_len))
+	{
+		fprintf(stderr, "FAIL: alpn identifiers\n");
+		failures++;
+	}
+	if (wdns_svcparam_hint(&param, 0) != NULL) {
+		fprintf(stderr, "FAIL: address of alpn\n");
+		failures++;
+	}
+
+	/* ipv4hint */
+	if (wdns_svcparam_iter_next(&it, &param) != wdns_res_success ||
+	    param.key != WDNS_SVCPARAM_IPV4HINT)
+	{
+		fprintf(stderr, "FAIL: ipv4hint\n");
+		return (failures + 1);
+	}
+	if ((addr = wdns_svcparam_hint(&param, 0)) == NULL || memcmp(addr, "\xc0\x00\x02\x01", 4) != 0 ||
+	    (addr = wdns_svcparam_hint(&param, 1)) == NULL || memcmp(addr, "\xc0\x00\x02\x02", 4) != 0 ||
+	    wdns_svcparam_hint(&param, 2) != NULL)
+	{
+		fprintf(stderr, "FAIL: ipv4hint addresses\n");
+		failures++;
+	}
+
+	/* ipv6hint */
+	if (wdns_svcparam_iter_next(&it, &param) != wdns_res_success ||
+	    param.key != WDNS_SVCPARAM_IPV6HINT)
+	{
+		fprintf(stderr, "FAIL: ipv6hint\n");
+		return (failures + 1);
+	}
+	if ((addr = wdns_svcparam_hint(&param, 0)) == NULL || addr[0] != 0x20 || addr[15] != 0x01 ||
+	    wdns_svcparam_hint(&param, 1) != NULL)
+	{
+		fprintf(stderr, "FAIL: ipv6hint addresses\n");
+		failures++;
+	}
+
+	res = wdns_svcparam_iter_next(&it, &param);
+	if (res != wdns_res_len) {
+		fprintf(stderr, "FAIL: end of parameters: %s\n", wdns_res_to_str(res));
+		failures++;
+	}
+
+	/* a truncated TargetName */
+	if (wdns_svcparam_iter_init(&it, (const uint8_t *) "\x00\x01\x03""foo", 6) == wdns_res_success) {
+		fprintf(stderr, "FAIL: truncated TargetName accepted\n");
+		failures++;
+	}
+
+	return (failures);
+}
+
+static size_t
+test_parse(void)
+{
+	size_t failures = 0;
+
+	for (size_t i = 0; i <= sizeof(bad) / sizeof(bad[0]); i++) {
+		const uint8_t *params = i < sizeof(bad) / sizeof(bad[0]) ? (const uint8_t *) bad[i].params : rdata + 3;
+		size_t len = i < sizeof(bad) / sizeof(bad[0]) ? bad[i].len : sizeof(rdata) - 3;
+		uint8_t pkt[512];
+		uint8_t *p = pkt;
+		wdns_message_t m;
+		wdns_res res;
+
+		/* a response with one root owned HTTPS RR, "1 ." and the params */
+		memcpy(p, "\x00\x01\x81\x80\x00\x00\x00\x01\x00\x00\x00\x00", 12);
+		p += 12;
+		memcpy(p, "\x00\x00\x41\x00\x01\x00\x00\x0e\x10", 9);
+		p += 9;
+		*p++ = (3 + len) >> 8;
+		*p++ = (3 + len) & 0xff;
+		memcpy(p, "\x00\x01\x00", 3);
+		p += 3;
+		memcpy(p, params, len);
+		p += len;
+
+		res = wdns_parse_message(&m, pkt, p - pkt);
+		if (i < sizeof(bad) / sizeof(bad[0])) {
+			if (res == wdns_res_success) {
+				fprintf(stderr, "FAIL: %s accepted\n", bad[i].desc);
+				wdns_clear_message(&m);
+				failures++;
+			}
+		} else {
+			if (res != wdns_res_success) {
+				fprintf(stderr, "FAIL: wdns_parse_message: %s\n", wdns_res_to_str(res));
+				failures++;
+			} else {
+				wdns_clear_message(&m);
+			}
+		}
+	}
+
+	return (failures);
+}
+
+static size_t
+test_ech(void)
+{
+	size_t failures = 0;
+	uint8_t rd[3 + 4 + 60];
+	uint8_t *out = NULL;
+	size_t out_len;
+	char *str;
+
+	/* "1 ." and a 60 byte ech, long enough for a line break in base64 */
+	memcpy(rd, "\x00\x01\x00\x00\x05\x00\x3c", 7);
+	for (size_t i = 0; i < 60; i++)
+		rd[7 + i] = i;
+
+	str = wdns_rdata_to_str(rd, sizeof(rd), WDNS_TYPE_HTTPS, WDNS_CLASS_IN);
+	if (str == NULL) {
+		fprintf(stderr, "FAIL: wdns_rdata_to_str\n");
+		return (1);
+	}
+	const char *ech = strstr(str, "ech=");
+	if (ech == NULL ||
+	    (ech[strcspn(ech, " ")] != '\0' && ech[strcspn(ech, " ") + 1] != '\0'))
+	{
+		fprintf(stderr, "FAIL: ech value split: %s\n", str);
+		failures++;
+	}
+	if (wdns_str_to_rdata(str, WDNS_TYPE_HTTPS, WDNS_CLASS_IN, &out, &out_len) != wdns_res_success ||
+	    out_len != sizeof(rd) || memcmp(out, rd, sizeof(rd)) != 0)
+	{
+		fprintf(stderr, "FAIL: ech round trip: %s\n", str);
+		failures++;
+	}
+	free(out);
+	free(str);
+
+	/* invalid base64 */
+	static const char *bad_ech[] = {
+		"1 . ech=AAEC$wQF",
+		"1 . ech=AAECAwQ",
+		"1 . ech=AA=CAwQF",
+		"1 . ech=",
+	};
+	for (size_t i = 0; i < sizeof(bad_ech) / sizeof(bad_ech[0]); i++) {
+		out = NULL;
+		if (wdns_str_to_rdata(bad_ech[i], WDNS_TYPE_HTTPS, WDNS_CLASS_IN, &out, &out_len) == wdns_res_success) {
+			fprintf(stderr, "FAIL: %s accepted\n", bad_ech[i]);
+			failures++;
+		}
+		free(out);
+	}
+
+	return (failures);
+}
+
+static int
+check(size_t ret, const char *s)
+{
+	if (ret == 0)
+		fprintf(stderr, NAME ": PASS: %s\n", s);
+	else
+		fprintf(stderr, NAME ": FAIL: %s (%" PRIu64 " failures)\n", s, ret);
+	return (ret);
+}
+
+int main (int argc, char **argv)
+{
+	int ret = 0;
+
+	ret |= check(test_iter(), "test-svcb_iter");
+	ret |= check(test_parse(), "test-svcb_parse");
+	ret |= check(test_ech(), "test-svcb_ech");
+
+	if (ret)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
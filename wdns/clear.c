@@ -15,6 +15,21 @@ wdns_clear_rrset(wdns_rrset_t *rrset)
 	rrset->n_rdatas = 0;
 }
 
+/*
+ * Release an RRset laid out in one block by wdns_deserialize_rrset_flat().
+ *
+ * wdns_clear_rrset() cannot free such an RRset with a single call: wdns_rrset_t
+ * has no field that marks the layout, and the public structs are kept
+ * unchanged so that the library stays binary compatible (libtool age 1).
+ */
+void
+wdns_clear_rrset_flat(wdns_rrset_t *rrset)
+{
+	my_free(rrset->rdatas);
+	rrset->name.data = NULL;
+	rrset->n_rdatas = 0;
+}
+
 void
 wdns_clear_rrset_array(wdns_rrset_array_t *a)
 {
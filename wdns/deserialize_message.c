@@ -0,0 +1,48 @@
+/**
+ * Parse a message serialized by wdns_serialize_message().
+ *
+ * \param[out] m parsed message
+ * \param[in] buf serialized message
+ * \param[in] sz length of buf
+ *
+ * \return wdns_res_success
+ * \return wdns_res_parse_error
+ * \return wdns_res_overflow
+ */
+
+wdns_res
+wdns_deserialize_message(wdns_message_t *m, const uint8_t *buf, size_t sz)
+{
+	wdns_serialized_message_t sm;
+	wdns_res res;
+
+	memset(m, 0, sizeof(*m));
+
+	res = wdns_serialized_message_init(&sm, buf, sz);
+	if (res != wdns_res_success)
+		return (res);
+
+	m->id = sm.id;
+	m->flags = sm.flags;
+	m->rcode = sm.rcode;
+
+	if (sm.edns_present) {
+		m->edns.present = true;
+		m->edns.version = sm.edns_version;
+		m->edns.flags = sm.edns_flags;
+		m->edns.size = sm.edns_size;
+		m->edns.options = my_malloc(sizeof(wdns_rdata_t) + sm.edns_options_len);
+		m->edns.options->len = sm.edns_options_len;
+		memcpy(m->edns.options->data, sm.edns_options, sm.edns_options_len);
+	}
+
+	for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++) {
+		res = _wdns_deserialize_rrset_array_iter(&m->sections[sec], &sm.sections[sec], sec);
+		if (res != wdns_res_success) {
+			wdns_clear_message(m);
+			return (res);
+		}
+	}
+
+	return (wdns_res_success);
+}
@@ -1,6 +1,8 @@
 /**
  * Parse a serialized wdns_rrset_t.
  *
+ * Both the version 1 and version 2 formats are accepted.
+ *
  * \param[out] rrset parsed RRset
  * \param[in] buf serialized RRset
  * \param[in] sz length of buf
@@ -9,49 +11,37 @@
 wdns_res
 wdns_deserialize_rrset(wdns_rrset_t *rrset, const uint8_t *buf, size_t sz)
 {
-
-#define copy_bytes(ptr, len) do { \
-	if (bytes_read + len > sz) { \
-		wdns_clear_rrset(rrset); \
-		return (wdns_res_overflow); \
-	} \
-	memcpy(ptr, buf, len); \
-	buf += len; \
-	bytes_read += len; \
-} while(0)
-
-	size_t bytes_read = 0;
+	wdns_rrset_view_t v;
+	wdns_res res;
 
 	memset(rrset, 0, sizeof(*rrset));
 
-	/* length of name */
-	copy_bytes(&rrset->name.len, 1);
+	res = wdns_rrset_view_init(&v, buf, sz);
+	if (res != wdns_res_success)
+		return (res);
 
 	/* name */
-	rrset->name.data = my_malloc(rrset->name.len);
-	copy_bytes(rrset->name.data, rrset->name.len);
-
-	/* type */
-	copy_bytes(&rrset->rrtype, 2);
-
-	/* class */
-	copy_bytes(&rrset->rrclass, 2);
-
-	/* ttl */
-	copy_bytes(&rrset->rrttl, 4);
+	rrset->name.len = v.name_len;
+	rrset->name.data = my_malloc(v.name_len);
+	memcpy(rrset->name.data, v.name, v.name_len);
 
-	/* number of rdatas */
-	copy_bytes(&rrset->n_rdatas, 2);
+	/* type, class, ttl */
+	rrset->rrtype = v.rrtype;
+	rrset->rrclass = v.rrclass;
+	rrset->rrttl = v.rrttl;
 
 	/* rdatas */
-	rrset->rdatas = my_calloc(1, sizeof(void *) * rrset->n_rdatas);
+	rrset->n_rdatas = v.n_rdatas;
+	rrset->rdatas = my_calloc(1, sizeof(wdns_rdata_t *) * rrset->n_rdatas);
 	for (size_t i = 0; i < rrset->n_rdatas; i++) {
+		const uint8_t *rdata;
 		uint16_t rdlen;
 
-		copy_bytes(&rdlen, 2);
-		rrset->rdatas[i] = my_malloc(sizeof(rrset->rdatas[i]) + rdlen);
+		res = wdns_rrset_view_rdata(&v, i, &rdata, &rdlen);
+		assert(res == wdns_res_success);
+		rrset->rdatas[i] = my_malloc(sizeof(wdns_rdata_t) + rdlen);
 		rrset->rdatas[i]->len = rdlen;
-		copy_bytes(&rrset->rdatas[i]->data, rdlen);
+		memcpy(rrset->rdatas[i]->data, rdata, rdlen);
 	}
 
 	return (wdns_res_success);
@@ -0,0 +1,71 @@
+wdns_res
+_wdns_deserialize_rrset_array_iter(wdns_rrset_array_t *a, wdns_rrset_iter_t *it, unsigned sec)
+{
+	wdns_rrset_view_t v;
+	wdns_res res;
+
+	memset(a, 0, sizeof(*a));
+	if (it->n_rrsets == 0)
+		return (wdns_res_success);
+
+	a->rrsets = my_calloc(it->n_rrsets, sizeof(wdns_rrset_t));
+	while (wdns_rrset_iter_next(it, &v)) {
+		wdns_rrset_t *rrset = &a->rrsets[a->n_rrsets++];
+
+		rrset->name.len = v.name_len;
+		rrset->name.data = my_malloc(v.name_len);
+		memcpy(rrset->name.data, v.name, v.name_len);
+		rrset->rrtype = v.rrtype;
+		rrset->rrclass = v.rrclass;
+		rrset->rrttl = v.rrttl;
+
+		rrset->n_rdatas = v.n_rdatas;
+		if (v.n_rdatas > 0)
+			rrset->rdatas = my_calloc(v.n_rdatas, sizeof(wdns_rdata_t *));
+		for (unsigned i = 0; i < v.n_rdatas; i++) {
+			const uint8_t *rdata;
+			uint16_t rdlen;
+
+			wdns_rrset_view_rdata(&v, i, &rdata, &rdlen);
+			rrset->rdatas[i] = my_malloc(sizeof(wdns_rdata_t) + rdlen);
+			rrset->rdatas[i]->len = rdlen;
+			memcpy(rrset->rdatas[i]->data, rdata, rdlen);
+		}
+	}
+
+	res = _wdns_rebuild_rrs(a, sec);
+	if (res != wdns_res_success)
+		wdns_clear_rrset_array(a);
+	return (res);
+}
+
+/**
+ * Parse an RRset array serialized by wdns_serialize_rrset_array().
+ *
+ * Both the RRsets and the RRs of the array are populated; the RRs appear
+ * grouped by RRset and carry the TTL of their RRset.
+ *
+ * \param[out] a parsed RRset array
+ * \param[in] sec the section the array belongs to (WDNS_MSG_SEC_*)
+ * \param[in] buf serialized RRset array
+ * \param[in] sz length of buf
+ *
+ * \return wdns_res_success
+ * \return wdns_res_parse_error
+ * \return wdns_res_overflow
+ */
+
+wdns_res
+wdns_deserialize_rrset_array(wdns_rrset_array_t *a, unsigned sec,
+			     const uint8_t *buf, size_t sz)
+{
+	wdns_rrset_iter_t it;
+	wdns_res res;
+
+	memset(a, 0, sizeof(*a));
+
+	res = wdns_rrset_iter_init(&it, buf, sz);
+	if (res != wdns_res_success)
+		return (res);
+	return (_wdns_deserialize_rrset_array_iter(a, &it, sec));
+}
@@ -0,0 +1,123 @@
+/*
+ * Layout of a deserialized RRset in a single block of memory:
+ *
+ *	wdns_rdata_t *rdatas[n_rdatas]		pointer table
+ *	wdns_rdata_t rdata[0..n_rdatas-1]	each padded to an even length
+ *	uint8_t name[name.len]
+ *
+ * rrset->rdatas points to the start of the block, so freeing rrset->rdatas
+ * (see wdns_clear_rrset_flat()) releases the entire RRset.
+ */
+
+#define RDATA_SIZE(rdlen) ((sizeof(wdns_rdata_t) + (rdlen) + 1) & ~((size_t) 1))
+
+/* Compute the size of the flat layout of a validated serialized RRset. */
+static size_t
+flat_size(wdns_rrset_view_t *v)
+{
+	size_t size;
+
+	size = v->name_len + v->n_rdatas * sizeof(wdns_rdata_t *);
+	for (unsigned i = 0; i < v->n_rdatas; i++) {
+		const uint8_t *rdata;
+		uint16_t rdlen;
+
+		wdns_rrset_view_rdata(v, i, &rdata, &rdlen);
+		size += RDATA_SIZE(rdlen);
+	}
+
+	return (size);
+}
+
+/**
+ * Parse a serialized wdns_rrset_t into a single block of memory.
+ *
+ * If mem is NULL, the serialized RRset is validated and the size of the block
+ * it requires is returned in *memsz. Otherwise the RRset is laid out in mem,
+ * which must be at least that large and suitably aligned for a pointer, and
+ * the name and rdata pointers in rrset point into mem. rrset->rdatas is always
+ * equal to mem.
+ *
+ * \param[out] rrset parsed RRset (may be NULL if mem is NULL)
+ * \param[in] buf serialized RRset
+ * \param[in] sz length of buf
+ * \param[out] mem memory for the RRset (may be NULL)
+ * \param[in,out] memsz length of mem
+ */
+
+wdns_res
+wdns_deserialize_rrset_buf(wdns_rrset_t *rrset, const uint8_t *buf, size_t sz,
+			   uint8_t *mem, size_t *memsz)
+{
+	wdns_rrset_view_t v;
+	size_t size;
+	uint8_t *p;
+	wdns_res res;
+
+	res = wdns_rrset_view_init(&v, buf, sz);
+	if (res != wdns_res_success)
+		return (res);
+	size = flat_size(&v);
+	if (mem == NULL) {
+		*memsz = size;
+		return (wdns_res_success);
+	}
+	if (*memsz < size)
+		return (wdns_res_overflow);
+
+	rrset->name.len = v.name_len;
+	rrset->name.data = mem + size - rrset->name.len;
+	memcpy(rrset->name.data, v.name, rrset->name.len);
+
+	rrset->rrtype = v.rrtype;
+	rrset->rrclass = v.rrclass;
+	rrset->rrttl = v.rrttl;
+	rrset->n_rdatas = v.n_rdatas;
+
+	rrset->rdatas = (wdns_rdata_t **) mem;
+	p = mem + rrset->n_rdatas * sizeof(wdns_rdata_t *);
+	for (unsigned i = 0; i < rrset->n_rdatas; i++) {
+		const uint8_t *rdata;
+		uint16_t rdlen;
+
+		wdns_rrset_view_rdata(&v, i, &rdata, &rdlen);
+		rrset->rdatas[i] = (wdns_rdata_t *) p;
+		rrset->rdatas[i]->len = rdlen;
+		memcpy(rrset->rdatas[i]->data, rdata, rdlen);
+		p += RDATA_SIZE(rdlen);
+	}
+
+	return (wdns_res_success);
+}
+
+/**
+ * Parse a serialized wdns_rrset_t into a single allocation.
+ *
+ * The RRset must be released with wdns_clear_rrset_flat(), not
+ * wdns_clear_rrset().
+ *
+ * \param[out] rrset parsed RRset
+ * \param[in] buf serialized RRset
+ * \param[in] sz length of buf
+ */
+
+wdns_res
+wdns_deserialize_rrset_flat(wdns_rrset_t *rrset, const uint8_t *buf, size_t sz)
+{
+	size_t memsz;
+	uint8_t *mem;
+	wdns_res res;
+
+	memset(rrset, 0, sizeof(*rrset));
+
+	res = wdns_deserialize_rrset_buf(NULL, buf, sz, NULL, &memsz);
+	if (res != wdns_res_success)
+		return (res);
+
+	/* a malloc(0) result can't be told apart from failure */
+	mem = my_malloc(memsz ? memsz : 1);
+	res = wdns_deserialize_rrset_buf(rrset, buf, sz, mem, &memsz);
+	assert(res == wdns_res_success);
+
+	return (wdns_res_success);
+}
@@ -1,5 +1,25 @@
+/**
+ * Locate the domain names in an rdata that are downcased in canonical form.
+ *
+ * Only the rrtypes specified by RFC 4034 section 6.2 and
+ * draft-ietf-dnsext-dnssec-bis-updates-11 section 5.1 have names that are
+ * downcased; for all other rrtypes no spans are returned.
+ *
+ * \param[in] rdata the rdata
+ * \param[in] rdlen length of the rdata
+ * \param[in] rrtype rrtype of the rdata
+ * \param[in] rrclass rrclass of the rdata
+ * \param[out] spans offsets and lengths of the names
+ * \param[out] n_spans number of spans
+ *
+ * \return wdns_res_success
+ * \return wdns_res_parse_error
+ */
+
 wdns_res
-wdns_downcase_rdata(wdns_rdata_t *rdata, uint16_t rrtype, uint16_t rrclass)
+_wdns_rdata_name_spans(const uint8_t *rdata, uint16_t rdlen,
+		       uint16_t rrtype, uint16_t rrclass,
+		       _wdns_span_t spans[_WDNS_MAX_NAME_SPANS], unsigned *n_spans)
 {
 
 #define advance_bytes(x) do { \
@@ -11,9 +31,11 @@ wdns_downcase_rdata(wdns_rdata_t *rdata, uint16_t rrtype, uint16_t rrclass)
 
 	const record_descr *descr;
 	const uint8_t *t;
-	size_t bytes_remaining = rdata->len;
+	size_t bytes_remaining = rdlen;
 	uint8_t oclen;
-	uint8_t *p = rdata->data;
+	const uint8_t *p = rdata;
+
+	*n_spans = 0;
 
 	if (rrtype < record_descr_len) {
 		descr = &record_descr_array[rrtype];
@@ -23,8 +45,6 @@ wdns_downcase_rdata(wdns_rdata_t *rdata, uint16_t rrtype, uint16_t rrclass)
 		return (wdns_res_success);
 	}
 
-	/* only downcase rrtypes specified by RFC 4034 section 6.2
-	 * and draft-ietf-dnsext-dnssec-bis-updates-11 section 5.1 */
 	switch (rrtype) {
 	case WDNS_TYPE_A6:
 	case WDNS_TYPE_AFSDB:
@@ -63,15 +83,18 @@ wdns_downcase_rdata(wdns_rdata_t *rdata, uint16_t rrtype, uint16_t rrclass)
 			switch (*t) {
 			case rdf_name:
 			case rdf_uname:
-				while (bytes_remaining-- != 0) {
-					if (*p == 0) {
-						p++;
-						break;
-					}
-					if (*p >= 'A' && *p <= 'Z')
-						*p |= 0x20;
-					p++;
+				if (*n_spans == _WDNS_MAX_NAME_SPANS)
+					return (wdns_res_parse_error);
+				spans[*n_spans].off = p - rdata;
+				while (*p != 0) {
+					oclen = *p;
+					advance_bytes(oclen + 1U);
+					if (bytes_remaining == 0)
+						return (wdns_res_parse_error);
 				}
+				advance_bytes(1U);
+				spans[*n_spans].len = p - rdata - spans[*n_spans].off;
+				*n_spans += 1;
 				break;
 
 			case rdf_repstring:
@@ -105,6 +128,7 @@ wdns_downcase_rdata(wdns_rdata_t *rdata, uint16_t rrtype, uint16_t rrclass)
 
 			case rdf_eui64:
 				advance_bytes(8U);
+				break;
 
 			case rdf_string:
 			case rdf_salt:
@@ -133,3 +157,26 @@ wdns_downcase_rdata(wdns_rdata_t *rdata, uint16_t rrtype, uint16_t rrclass)
 
 	return (wdns_res_success);
 }
+
+wdns_res
+wdns_downcase_rdata(wdns_rdata_t *rdata, uint16_t rrtype, uint16_t rrclass)
+{
+	_wdns_span_t spans[_WDNS_MAX_NAME_SPANS];
+	unsigned n_spans;
+	wdns_res res;
+
+	res = _wdns_rdata_name_spans(rdata->data, rdata->len, rrtype, rrclass, spans, &n_spans);
+	if (res != wdns_res_success)
+		return (res);
+
+	for (unsigned i = 0; i < n_spans; i++) {
+		uint8_t *p = rdata->data + spans[i].off;
+
+		for (unsigned j = 0; j < spans[i].len; j++) {
+			if (p[j] >= 'A' && p[j] <= 'Z')
+				p[j] |= 0x20;
+		}
+	}
+
+	return (wdns_res_success);
+}
@@ -0,0 +1,44 @@
+/**
+ * Decode an EDNS Client Subnet option (RFC 7871).
+ *
+ * The address is copied into ecs->address and padded with zero octets.
+ *
+ * \param[in] opt the option
+ * \param[out] ecs the decoded option
+ *
+ * \return wdns_res_success
+ * \return wdns_res_parse_error if the option is not a valid Client Subnet
+ *	option
+ */
+
+wdns_res
+wdns_edns_decode_ecs(const wdns_edns_option_t *opt, wdns_edns_ecs_t *ecs)
+{
+	unsigned addr_len, max_prefix;
+
+	if (opt->code != WDNS_EDNS_OPT_CLIENT_SUBNET || opt->len < 4)
+		return (wdns_res_parse_error);
+
+	memset(ecs, 0, sizeof(*ecs));
+	load_net16(opt->data, &ecs->family);
+	ecs->source_prefix = opt->data[2];
+	ecs->scope_prefix = opt->data[3];
+
+	if (ecs->family == 1)
+		max_prefix = 32;
+	else if (ecs->family == 2)
+		max_prefix = 128;
+	else
+		return (wdns_res_parse_error);
+
+	/* the address is truncated to the source prefix length */
+	addr_len = (ecs->source_prefix + 7) / 8;
+	if (ecs->source_prefix > max_prefix || ecs->scope_prefix > max_prefix ||
+	    opt->len != addr_len + 4)
+	{
+		return (wdns_res_parse_error);
+	}
+	memcpy(ecs->address, opt->data + 4, addr_len);
+
+	return (wdns_res_success);
+}
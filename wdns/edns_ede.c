@@ -0,0 +1,24 @@
+/**
+ * Decode an EDNS Extended DNS Error option (RFC 8914).
+ *
+ * \param[in] opt the option
+ * \param[out] ede the decoded option, whose text points into the option data
+ *	and is not NUL terminated
+ *
+ * \return wdns_res_success
+ * \return wdns_res_parse_error if the option is not a valid Extended DNS Error
+ *	option
+ */
+
+wdns_res
+wdns_edns_decode_ede(const wdns_edns_option_t *opt, wdns_edns_ede_t *ede)
+{
+	if (opt->code != WDNS_EDNS_OPT_EDE || opt->len < 2)
+		return (wdns_res_parse_error);
+
+	load_net16(opt->data, &ede->info_code);
+	ede->text = opt->data + 2;
+	ede->text_len = opt->len - 2;
+
+	return (wdns_res_success);
+}
@@ -0,0 +1,149 @@
+/**
+ * Initialize an iterator over the options of an EDNS OPT RR.
+ *
+ * \param[out] it the iterator
+ * \param[in] options OPT rdata, a sequence of option TLVs
+ * \param[in] len length of the OPT rdata
+ */
+
+void
+wdns_edns_option_iter_init(wdns_edns_option_iter_t *it, const uint8_t *options, size_t len)
+{
+	it->_p = options;
+	it->_end = options + len;
+}
+
+/**
+ * Return the next option of an EDNS OPT RR.
+ *
+ * \param[in,out] it the iterator
+ * \param[out] opt the option, whose data points into the OPT rdata
+ *
+ * \return wdns_res_success
+ * \return wdns_res_len if there are no more options
+ * \return wdns_res_overflow if the option is truncated
+ */
+
+wdns_res
+wdns_edns_option_iter_next(wdns_edns_option_iter_t *it, wdns_edns_option_t *opt)
+{
+	if (it->_p == it->_end)
+		return (wdns_res_len);
+	if (it->_end - it->_p < 4)
+		return (wdns_res_overflow);
+
+	load_net16(it->_p, &opt->code);
+	load_net16(it->_p + 2, &opt->len);
+	if (it->_end - it->_p - 4 < opt->len)
+		return (wdns_res_overflow);
+	opt->data = it->_p + 4;
+	it->_p += 4 + opt->len;
+
+	return (wdns_res_success);
+}
+
+/**
+ * Find an option of an EDNS OPT RR.
+ *
+ * OPT rdata is small, so the options are simply searched in order. To look
+ * up several options of the same OPT RR, build a wdns_edns_option_index_t
+ * with wdns_edns_option_index_init() and use wdns_edns_option_index_find().
+ *
+ * \param[in] edns EDNS information of a message
+ * \param[in] code option code
+ * \param[out] opt the first option with the code, whose data points into the
+ *	OPT rdata
+ *
+ * \return true if the option is present, false otherwise
+ */
+
+bool
+wdns_edns_find_option(const wdns_edns_t *edns, uint16_t code, wdns_edns_option_t *opt)
+{
+	wdns_edns_option_iter_t it;
+
+	if (!edns->present || edns->options == NULL)
+		return (false);
+
+	wdns_edns_option_iter_init(&it, edns->options->data, edns->options->len);
+	while (wdns_edns_option_iter_next(&it, opt) == wdns_res_success) {
+		if (opt->code == code)
+			return (true);
+	}
+	return (false);
+}
+
+/**
+ * Index the options of an EDNS OPT RR.
+ *
+ * The offset of the first option with each code below
+ * WDNS_EDNS_OPTION_INDEX_CODES is recorded, which covers the common options
+ * such as Client Subnet, Cookie and Extended DNS Error. Options following a
+ * truncated option are not indexed, as wdns_edns_find_option() does not find
+ * them either. The index refers to the OPT rdata without copying it, so it
+ * is only valid while edns->options is unchanged.
+ *
+ * \param[out] idx the index
+ * \param[in] edns EDNS information of a message
+ */
+
+void
+wdns_edns_option_index_init(wdns_edns_option_index_t *idx, const wdns_edns_t *edns)
+{
+	wdns_edns_option_iter_t it;
+	wdns_edns_option_t opt;
+
+	memset(idx, 0, sizeof(*idx));
+	if (!edns->present || edns->options == NULL)
+		return;
+
+	idx->_options = edns->options->data;
+	idx->_len = edns->options->len;
+
+	/* the offsets are stored plus one, so that zero means absent */
+	wdns_edns_option_iter_init(&it, idx->_options, idx->_len);
+	while (wdns_edns_option_iter_next(&it, &opt) == wdns_res_success) {
+		if (opt.code < WDNS_EDNS_OPTION_INDEX_CODES && idx->_first[opt.code] == 0)
+			idx->_first[opt.code] = opt.data - 4 - idx->_options + 1;
+	}
+}
+
+/**
+ * Find an option of an EDNS OPT RR using an index.
+ *
+ * Options with a code below WDNS_EDNS_OPTION_INDEX_CODES are found in
+ * constant time; other codes are searched for in order.
+ *
+ * \param[in] idx index built by wdns_edns_option_index_init()
+ * \param[in] code option code
+ * \param[out] opt the first option with the code, whose data points into the
+ *	OPT rdata
+ *
+ * \return true if the option is present, false otherwise
+ */
+
+bool
+wdns_edns_option_index_find(const wdns_edns_option_index_t *idx, uint16_t code,
+			    wdns_edns_option_t *opt)
+{
+	wdns_edns_option_iter_t it;
+
+	if (code < WDNS_EDNS_OPTION_INDEX_CODES) {
+		const uint8_t *p;
+
+		if (idx->_first[code] == 0)
+			return (false);
+		p = idx->_options + idx->_first[code] - 1;
+		opt->code = code;
+		load_net16(p + 2, &opt->len);
+		opt->data = p + 4;
+		return (true);
+	}
+
+	wdns_edns_option_iter_init(&it, idx->_options, idx->_len);
+	while (wdns_edns_option_iter_next(&it, opt) == wdns_res_success) {
+		if (opt->code == code)
+			return (true);
+	}
+	return (false);
+}
@@ -0,0 +1,107 @@
+/*
+ * Export record format.
+ *
+ * An export record is a compact, self-delimiting binary encoding of a parsed
+ * DNS message. Owner names are stored uncompressed and rdata is stored as the
+ * raw (uncompressed) wire bytes held in the wdns_message_t. All integers are
+ * base 128 varints (see libmy/varint.h), so most fields cost a single octet.
+ *
+ *	record	:= varint(body_len) body
+ *
+ *	body	:= header
+ *		   varint(qdcount) varint(ancount) varint(nscount) varint(arcount)
+ *		   rr*
+ *
+ *	rr	:= octet(namelen) namelen*octet varint(rrtype) varint(rrclass)
+ *		   [ varint(rrttl) varint(rdlen) rdlen*octet ]	unless question
+ *
+ * header is the message header encoding described in message_header.c.
+ * body_len is the number of octets in body, so a reader can skip a record
+ * without decoding it. The RRs of each section appear in the order they were
+ * parsed from the original message, question section first.
+ */
+
+static size_t
+export_body_size(const wdns_message_t *m)
+{
+	size_t sz = _wdns_message_header_len(m);
+
+	for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++) {
+		const wdns_rrset_array_t *a = &m->sections[sec];
+
+		sz += varint_length(a->n_rrs);
+
+		for (unsigned i = 0; i < a->n_rrs; i++) {
+			const wdns_rr_t *rr = &a->rrs[i];
+
+			sz += 1 + rr->name.len;
+			sz += varint_length(rr->rrtype);
+			sz += varint_length(rr->rrclass);
+
+			if (sec != WDNS_MSG_SEC_QUESTION) {
+				sz += varint_length(rr->rrttl);
+				sz += varint_length(rr->rdata->len);
+				sz += rr->rdata->len;
+			}
+		}
+	}
+
+	return (sz);
+}
+
+/**
+ * Encode a parsed DNS message as an export record.
+ *
+ * Like wdns_serialize_rrset(), this function is normally called twice: once
+ * with a NULL buffer to obtain the encoded length, and once to write the
+ * record into a buffer of at least that length. Callers accumulating records
+ * in a ubuf can reserve the returned length, write at ubuf_ptr(), and then
+ * ubuf_advance() by the same length.
+ *
+ * \param[in] m the message to encode
+ * \param[out] buf the output buffer (may be NULL)
+ * \param[out] sz encoded length of the record (may be NULL)
+ *
+ * \return wdns_res_success
+ */
+
+wdns_res
+wdns_export_message(const wdns_message_t *m, uint8_t *buf, size_t *sz)
+{
+	size_t body_len = export_body_size(m);
+
+	if (sz)
+		*sz = varint_length(body_len) + body_len;
+
+	if (buf) {
+		buf += varint_encode32(buf, body_len);
+		buf += _wdns_put_message_header(m, buf);
+
+		for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++)
+			buf += varint_encode32(buf, m->sections[sec].n_rrs);
+
+		for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++) {
+			const wdns_rrset_array_t *a = &m->sections[sec];
+
+			for (unsigned i = 0; i < a->n_rrs; i++) {
+				const wdns_rr_t *rr = &a->rrs[i];
+
+				*buf++ = rr->name.len;
+				memcpy(buf, rr->name.data, rr->name.len);
+				buf += rr->name.len;
+
+				buf += varint_encode32(buf, rr->rrtype);
+				buf += varint_encode32(buf, rr->rrclass);
+
+				if (sec != WDNS_MSG_SEC_QUESTION) {
+					buf += varint_encode32(buf, rr->rrttl);
+					buf += varint_encode32(buf, rr->rdata->len);
+					memcpy(buf, rr->rdata->data, rr->rdata->len);
+					buf += rr->rdata->len;
+				}
+			}
+		}
+	}
+
+	return (wdns_res_success);
+}
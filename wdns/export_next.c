@@ -0,0 +1,140 @@
+static bool
+get_rr(const uint8_t **p, const uint8_t *end, unsigned sec, wdns_export_rr_t *rr)
+{
+	const uint8_t *src = *p;
+	uint32_t val;
+
+	if (src >= end)
+		return (false);
+	rr->name_len = *src++;
+	if (rr->name_len == 0 || rr->name_len > end - src)
+		return (false);
+	rr->name = src;
+	src += rr->name_len;
+
+	if (!_wdns_get_varint(&src, end, UINT16_MAX, &val))
+		return (false);
+	rr->rrtype = val;
+	if (!_wdns_get_varint(&src, end, UINT16_MAX, &val))
+		return (false);
+	rr->rrclass = val;
+
+	rr->sec = sec;
+	if (sec == WDNS_MSG_SEC_QUESTION) {
+		rr->rrttl = 0;
+		rr->rdlen = 0;
+		rr->rdata = NULL;
+	} else {
+		if (!_wdns_get_varint(&src, end, UINT32_MAX, &rr->rrttl))
+			return (false);
+		if (!_wdns_get_varint(&src, end, UINT16_MAX, &val))
+			return (false);
+		rr->rdlen = val;
+		if (rr->rdlen > end - src)
+			return (false);
+		rr->rdata = src;
+		src += rr->rdlen;
+	}
+
+	*p = src;
+	return (true);
+}
+
+/**
+ * Decode the next export record from a buffer.
+ *
+ * The record is validated in its entirety, so that the RRs it contains can
+ * subsequently be visited with wdns_export_next_rr() without further bounds
+ * checking. No data is copied: the name, rdata, and EDNS option pointers in
+ * the decoded record refer to the input buffer, which must remain valid for
+ * as long as the record is in use.
+ *
+ * \param[in,out] buf pointer to the start of the record; advanced past the
+ *	record on success
+ * \param[in] end pointer to the end of the buffer
+ * \param[out] rec decoded record
+ *
+ * \return wdns_res_success
+ * \return wdns_res_len
+ * \return wdns_res_parse_error
+ */
+
+wdns_res
+wdns_export_next(const uint8_t **buf, const uint8_t *end, wdns_export_record_t *rec)
+{
+	const uint8_t *p = *buf;
+	const uint8_t *rec_end;
+	uint32_t body_len;
+	uint32_t val;
+	_wdns_message_header_t h;
+	wdns_export_rr_t rr;
+
+	memset(rec, 0, sizeof(*rec));
+
+	if (p >= end)
+		return (wdns_res_len);
+
+	if (!_wdns_get_varint(&p, end, UINT32_MAX, &body_len) || body_len > end - p)
+		return (wdns_res_parse_error);
+	rec_end = p + body_len;
+
+	if (!_wdns_get_message_header(&p, rec_end, &h))
+		return (wdns_res_parse_error);
+	rec->id = h.id;
+	rec->flags = h.flags;
+	rec->rcode = h.rcode;
+	rec->edns_present = h.edns_present;
+	rec->edns_version = h.edns_version;
+	rec->edns_flags = h.edns_flags;
+	rec->edns_size = h.edns_size;
+	rec->edns_options_len = h.edns_options_len;
+	rec->edns_options = h.edns_options;
+
+	for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++) {
+		if (!_wdns_get_varint(&p, rec_end, UINT16_MAX, &val))
+			return (wdns_res_parse_error);
+		rec->counts[sec] = val;
+	}
+
+	/* validate every RR up front */
+	rec->_rr = p;
+	for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++) {
+		for (unsigned n = 0; n < rec->counts[sec]; n++) {
+			if (!get_rr(&p, rec_end, sec, &rr))
+				return (wdns_res_parse_error);
+		}
+	}
+	if (p != rec_end)
+		return (wdns_res_parse_error);
+
+	rec->_end = rec_end;
+	*buf = rec_end;
+	return (wdns_res_success);
+}
+
+/**
+ * Visit the next RR of an export record decoded by wdns_export_next().
+ *
+ * RRs are returned section by section, in the order they were encoded.
+ *
+ * \param[in,out] rec decoded record
+ * \param[out] rr the next RR
+ *
+ * \return true if an RR was returned, false if all RRs have been visited
+ */
+
+bool
+wdns_export_next_rr(wdns_export_record_t *rec, wdns_export_rr_t *rr)
+{
+	while (rec->_sec < WDNS_MSG_SEC_MAX && rec->_n == rec->counts[rec->_sec]) {
+		rec->_sec++;
+		rec->_n = 0;
+	}
+	if (rec->_sec == WDNS_MSG_SEC_MAX)
+		return (false);
+
+	if (!get_rr(&rec->_rr, rec->_end, rec->_sec, rr))
+		return (false);
+	rec->_n++;
+	return (true);
+}
@@ -0,0 +1,188 @@
+/*
+ * Framed record streams.
+ *
+ *	frame	:= octet(0xfd) octet('W') octet('F') octet('1')
+ *		   u32(len) u32(crc) len*octet
+ *
+ * len and crc are in network byte order; crc is the CRC32C of the len octets
+ * of payload. The four octet sync marker lets a reader that meets a corrupt
+ * or torn frame find the start of the next one without trusting the damaged
+ * length: it scans forward for the marker and resumes at the first frame
+ * whose payload checksums correctly.
+ *
+ * Every candidate marker found while resynchronizing brings an untrusted
+ * length, and checksumming each one could make a buffer of fake markers cost
+ * time quadratic in its length. The octets checksummed for candidates that
+ * turn out to be invalid are therefore limited to FRAME_CRC_BUDGET times the
+ * size of the buffer; once that is spent, a candidate whose length exceeds
+ * what is left is treated as invalid without checksumming it.
+ */
+
+#include "libmy/crc32c.h"
+
+#define FRAME_LEN_HEADER	12
+#define FRAME_CRC_BUDGET	2
+
+static const uint8_t frame_sync[4] = { 0xfd, 'W', 'F', '1' };
+
+static void
+write_header(uint8_t *buf, size_t len)
+{
+	memcpy(buf, frame_sync, sizeof(frame_sync));
+	store_net32(buf + 4, len);
+	store_net32(buf + 8, my_crc32c(buf + FRAME_LEN_HEADER, len));
+}
+
+/**
+ * Write a payload as a frame.
+ *
+ * Like wdns_serialize_rrset(), this function is normally called twice: once
+ * with a NULL buffer to obtain the frame length, and once to write the frame
+ * into a buffer of at least that length.
+ *
+ * \param[in] payload the payload
+ * \param[in] len length of the payload
+ * \param[out] buf the output buffer (may be NULL)
+ * \param[out] sz length of the frame (may be NULL)
+ *
+ * \return wdns_res_success
+ * \return wdns_res_len if the payload is too long to be framed
+ */
+
+wdns_res
+wdns_frame_write(const uint8_t *payload, size_t len, uint8_t *buf, size_t *sz)
+{
+	if (len > UINT32_MAX)
+		return (wdns_res_len);
+
+	if (sz)
+		*sz = FRAME_LEN_HEADER + len;
+
+	if (buf) {
+		memmove(buf + FRAME_LEN_HEADER, payload, len);
+		write_header(buf, len);
+	}
+
+	return (wdns_res_success);
+}
+
+/**
+ * Serialize a wdns_rrset_t directly into a frame.
+ *
+ * The RRset is written in the version 2 format of wdns_serialize_rrset_v2()
+ * with varint rdata lengths, without an intermediate copy, so the payload
+ * can be read in place with wdns_rrset_view_init() on any host. Calling
+ * convention as for wdns_frame_write().
+ *
+ * \param[in] rrset the RRset to serialize
+ * \param[out] buf the output buffer (may be NULL)
+ * \param[out] sz length of the frame (may be NULL)
+ *
+ * \return wdns_res_success
+ */
+
+wdns_res
+wdns_frame_write_rrset(const wdns_rrset_t *rrset, uint8_t *buf, size_t *sz)
+{
+	size_t len;
+
+	wdns_serialize_rrset_v2(rrset, WDNS_SERIALIZE_V2_VARINT, NULL, &len);
+
+	if (sz)
+		*sz = FRAME_LEN_HEADER + len;
+
+	if (buf) {
+		wdns_serialize_rrset_v2(rrset, WDNS_SERIALIZE_V2_VARINT,
+					buf + FRAME_LEN_HEADER, NULL);
+		write_header(buf, len);
+	}
+
+	return (wdns_res_success);
+}
+
+/**
+ * Initialize a reader over a buffer of frames.
+ *
+ * Nothing is copied, so buf may be a read-only mapping of a file; it must
+ * outlive the reader and the payloads it returns.
+ *
+ * \param[out] r the reader
+ * \param[in] buf the frames
+ * \param[in] sz length of buf
+ */
+
+void
+wdns_frame_reader_init(wdns_frame_reader_t *r, const uint8_t *buf, size_t sz)
+{
+	memset(r, 0, sizeof(*r));
+	r->_p = buf;
+	r->_end = buf + sz;
+	r->_crc_budget = (uint64_t) sz * FRAME_CRC_BUDGET;
+}
+
+/* Return the payload length if a valid frame starts at p, else -1. */
+static int64_t
+frame_valid(wdns_frame_reader_t *r, const uint8_t *p)
+{
+	uint32_t len, crc;
+
+	if (r->_end - p < FRAME_LEN_HEADER || memcmp(p, frame_sync, sizeof(frame_sync)) != 0)
+		return (-1);
+	load_net32(p + 4, &len);
+	load_net32(p + 8, &crc);
+	if (len > (size_t) (r->_end - p - FRAME_LEN_HEADER) || len > r->_crc_budget)
+		return (-1);
+	if (my_crc32c(p + FRAME_LEN_HEADER, len) != crc) {
+		r->_crc_budget -= len;
+		return (-1);
+	}
+	return (len);
+}
+
+/**
+ * Return the payload of the next valid frame.
+ *
+ * Corrupt or truncated frames, and any other data between frames, are
+ * skipped and counted in r->n_corrupt (once per damaged region) and
+ * r->n_skipped (in octets). The checksum work spent on corrupt frames is
+ * bounded, so a buffer with more damage than that bound allows may have its
+ * remaining frames skipped as well.
+ *
+ * \param[in,out] r the reader
+ * \param[out] payload the payload, pointing into the reader's buffer
+ * \param[out] len length of the payload
+ *
+ * \return wdns_res_success
+ * \return wdns_res_len if there are no more frames
+ */
+
+wdns_res
+wdns_frame_reader_next(wdns_frame_reader_t *r, const uint8_t **payload, size_t *len)
+{
+	const uint8_t *p = r->_p;
+	int64_t n;
+
+	if (p == r->_end)
+		return (wdns_res_len);
+
+	while ((n = frame_valid(r, p)) < 0) {
+		if (p == r->_p)
+			r->n_corrupt++;
+
+		/* resynchronize at the next sync marker */
+		p = memchr(p + 1, frame_sync[0], r->_end - p - 1);
+		if (p == NULL) {
+			r->n_skipped += r->_end - r->_p;
+			r->_p = r->_end;
+			return (wdns_res_len);
+		}
+	}
+	r->n_skipped += p - r->_p;
+
+	*payload = p + FRAME_LEN_HEADER;
+	*len = n;
+	r->_p = p + FRAME_LEN_HEADER + n;
+	r->n_frames++;
+
+	return (wdns_res_success);
+}
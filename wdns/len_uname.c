@@ -26,14 +26,16 @@ wdns_len_uname(const uint8_t *p, const uint8_t *eop, size_t *sz)
 
 		if (oclen > 63 || oclen > len)
 			return (wdns_res_invalid_length_octet);
-		if (oclen == 0)
-			break;
+		if (oclen == 0) {
+			*sz = olen - len;
+			if (*sz > WDNS_MAXLEN_NAME)
+				return (wdns_res_name_len);
+			return (wdns_res_success);
+		}
 
 		WDNS_BUF_ADVANCE(p, len, oclen);
 	}
 
-	*sz = olen - len;
-	if (*sz > WDNS_MAXLEN_NAME)
-		return (wdns_res_name_len);
-	return (wdns_res_success);
+	/* no terminating zero-length label */
+	return (wdns_res_overflow);
 }
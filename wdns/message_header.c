@@ -0,0 +1,117 @@
+/*
+ * Message header encoding shared by the export record format (see
+ * export_message.c) and the serialized message format (see
+ * serialize_rrset_array.c):
+ *
+ *	header	:= varint(id) varint(flags) varint(rcode)
+ *		   varint(edns_present)
+ *		   [ varint(edns_version) varint(edns_flags) varint(edns_size)
+ *		     varint(optlen) optlen*octet ]		if edns_present
+ */
+
+bool
+_wdns_get_varint(const uint8_t **p, const uint8_t *end, uint32_t max, uint32_t *val)
+{
+	size_t avail = end - *p;
+	unsigned len;
+
+	len = varint_length_packed(*p, avail < 5 ? avail : 5);
+	if (len == 0)
+		return (false);
+	varint_decode32(*p, val);
+	if (*val > max)
+		return (false);
+	*p += len;
+	return (true);
+}
+
+size_t
+_wdns_message_header_len(const wdns_message_t *m)
+{
+	size_t sz = 0;
+
+	sz += varint_length(m->id);
+	sz += varint_length(m->flags);
+	sz += varint_length(m->rcode);
+
+	sz += 1;
+	if (m->edns.present) {
+		uint16_t optlen = m->edns.options ? m->edns.options->len : 0;
+
+		sz += varint_length(m->edns.version);
+		sz += varint_length(m->edns.flags);
+		sz += varint_length(m->edns.size);
+		sz += varint_length(optlen);
+		sz += optlen;
+	}
+
+	return (sz);
+}
+
+size_t
+_wdns_put_message_header(const wdns_message_t *m, uint8_t *buf)
+{
+	uint8_t *start = buf;
+
+	buf += varint_encode32(buf, m->id);
+	buf += varint_encode32(buf, m->flags);
+	buf += varint_encode32(buf, m->rcode);
+
+	*buf++ = m->edns.present ? 1 : 0;
+	if (m->edns.present) {
+		uint16_t optlen = m->edns.options ? m->edns.options->len : 0;
+
+		buf += varint_encode32(buf, m->edns.version);
+		buf += varint_encode32(buf, m->edns.flags);
+		buf += varint_encode32(buf, m->edns.size);
+		buf += varint_encode32(buf, optlen);
+		if (optlen > 0) {
+			memcpy(buf, m->edns.options->data, optlen);
+			buf += optlen;
+		}
+	}
+
+	return (buf - start);
+}
+
+bool
+_wdns_get_message_header(const uint8_t **p, const uint8_t *end, _wdns_message_header_t *h)
+{
+	const uint8_t *src = *p;
+	uint32_t val;
+
+	memset(h, 0, sizeof(*h));
+
+	if (!_wdns_get_varint(&src, end, UINT16_MAX, &val))
+		return (false);
+	h->id = val;
+	if (!_wdns_get_varint(&src, end, UINT16_MAX, &val))
+		return (false);
+	h->flags = val;
+	if (!_wdns_get_varint(&src, end, UINT16_MAX, &val))
+		return (false);
+	h->rcode = val;
+
+	if (!_wdns_get_varint(&src, end, 1, &val))
+		return (false);
+	h->edns_present = (val == 1);
+	if (h->edns_present) {
+		if (!_wdns_get_varint(&src, end, UINT8_MAX, &val))
+			return (false);
+		h->edns_version = val;
+		if (!_wdns_get_varint(&src, end, UINT16_MAX, &val))
+			return (false);
+		h->edns_flags = val;
+		if (!_wdns_get_varint(&src, end, UINT16_MAX, &val))
+			return (false);
+		h->edns_size = val;
+		if (!_wdns_get_varint(&src, end, UINT16_MAX, &val) || val > end - src)
+			return (false);
+		h->edns_options_len = val;
+		h->edns_options = src;
+		src += val;
+	}
+
+	*p = src;
+	return (true);
+}
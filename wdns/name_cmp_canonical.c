@@ -0,0 +1,66 @@
+/* Record the offsets of the labels of a name; returns the number of labels. */
+static unsigned
+label_offsets(const wdns_name_t *name, uint8_t *offsets)
+{
+	unsigned n = 0;
+	size_t off = 0;
+
+	while (off < name->len && name->data[off] != 0 && n < WDNS_MAXLEN_NAME / 2) {
+		offsets[n++] = off;
+		off += 1 + name->data[off];
+	}
+	return (n);
+}
+
+/**
+ * Compare two domain names in the canonical DNS name order of RFC 4034
+ * section 6.1.
+ *
+ * Names are compared label by label starting from the rightmost label. Labels
+ * are compared as case-insensitive octet strings, where a shorter label sorts
+ * before a longer label it is a prefix of, and a name sorts before its
+ * subdomains.
+ *
+ * \param[in] n0 uncompressed wire format domain name
+ * \param[in] n1 uncompressed wire format domain name
+ *
+ * \return less than, equal to, or greater than zero if n0 sorts before, is
+ *	equal to, or sorts after n1
+ */
+
+int
+wdns_name_cmp_canonical(const wdns_name_t *n0, const wdns_name_t *n1)
+{
+	uint8_t off0[WDNS_MAXLEN_NAME / 2], off1[WDNS_MAXLEN_NAME / 2];
+	unsigned i0 = label_offsets(n0, off0);
+	unsigned i1 = label_offsets(n1, off1);
+
+	while (i0 > 0 && i1 > 0) {
+		const uint8_t *l0 = n0->data + off0[--i0];
+		const uint8_t *l1 = n1->data + off1[--i1];
+		unsigned len0 = l0[0], len1 = l1[0];
+
+		/* a malformed final label is compared as far as it goes */
+		if (l0 + 1 + len0 > n0->data + n0->len)
+			len0 = n0->data + n0->len - (l0 + 1);
+		if (l1 + 1 + len1 > n1->data + n1->len)
+			len1 = n1->data + n1->len - (l1 + 1);
+
+		for (unsigned j = 1; j <= len0 && j <= len1; j++) {
+			uint8_t c0 = l0[j], c1 = l1[j];
+
+			if (c0 >= 'A' && c0 <= 'Z')
+				c0 |= 0x20;
+			if (c1 >= 'A' && c1 <= 'Z')
+				c1 |= 0x20;
+			if (c0 != c1)
+				return (c0 < c1 ? -1 : 1);
+		}
+		if (len0 != len1)
+			return (len0 < len1 ? -1 : 1);
+	}
+
+	if (i0 != i1)
+		return (i0 < i1 ? -1 : 1);
+	return (0);
+}
@@ -0,0 +1,67 @@
+/**
+ * Generate a sort key for a domain name.
+ *
+ * Sort keys compare with memcmp() in the canonical DNS name order of RFC 4034
+ * section 6.1, the same order as wdns_name_cmp_canonical(); when two keys of
+ * different lengths are equal up to the length of the shorter, the shorter
+ * one sorts first.
+ *
+ * The key holds the labels of the name from the rightmost to the leftmost,
+ * downcased, each followed by a zero octet, and then one more zero octet.
+ * Label octets 0x00 and 0x01 are escaped as 0x01 0x01 and 0x01 0x02, so that
+ * the zero octets sort before any label octet. Since the key is terminated,
+ * other fields may be appended to it to sort by name and then by those
+ * fields.
+ *
+ * \param[in] name uncompressed wire format domain name
+ * \param[out] key sort key, at least WDNS_MAXLEN_SORTKEY octets
+ * \param[out] sz length of the sort key
+ *
+ * \return wdns_res_success
+ * \return wdns_res_invalid_length_octet
+ * \return wdns_res_name_overflow
+ */
+
+wdns_res
+wdns_name_sortkey(const wdns_name_t *name, uint8_t *key, size_t *sz)
+{
+	const uint8_t *labels[WDNS_MAXLEN_NAME / 2 + 1];
+	const uint8_t *p = name->data;
+	const uint8_t *end = p + name->len;
+	unsigned n_labels = 0;
+	uint8_t *k = key;
+
+	for (;;) {
+		if (p >= end)
+			return (wdns_res_name_overflow);
+		if (*p == 0)
+			break;
+		if (*p > 63)
+			return (wdns_res_invalid_length_octet);
+		if (n_labels == sizeof(labels) / sizeof(labels[0]) || end - p < 1 + *p)
+			return (wdns_res_name_overflow);
+		labels[n_labels++] = p;
+		p += 1 + *p;
+	}
+
+	while (n_labels-- > 0) {
+		const uint8_t *l = labels[n_labels];
+
+		for (unsigned i = 1; i <= l[0]; i++) {
+			uint8_t c = l[i];
+
+			if (c >= 'A' && c <= 'Z')
+				c |= 0x20;
+			if (c <= 1) {
+				*k++ = 1;
+				c++;
+			}
+			*k++ = c;
+		}
+		*k++ = 0;
+	}
+	*k++ = 0;
+
+	*sz = k - key;
+	return (wdns_res_success);
+}
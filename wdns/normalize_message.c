@@ -0,0 +1,176 @@
+/*
+ * RRsets are ordered by a precomputed key compared with memcmp(): the sort
+ * key of the owner name, as generated by wdns_name_sortkey(), followed by
+ * the rrtype and rrclass.
+ */
+
+#define LEN_SORTKEY_MAX		(WDNS_MAXLEN_SORTKEY + 4)
+
+struct entry {
+	const uint8_t	*key;
+	size_t		len;
+	uint16_t	idx;
+};
+
+static size_t
+make_key(const wdns_rrset_t *rrset, uint8_t *key)
+{
+	size_t len = 0;
+
+	/* a malformed owner name sorts as the root */
+	if (wdns_name_sortkey(&rrset->name, key, &len) != wdns_res_success)
+		key[len++] = 0;
+
+	store_net16(key + len, rrset->rrtype);
+	store_net16(key + len + 2, rrset->rrclass);
+	return (len + 4);
+}
+
+static inline int
+entry_cmp(const struct entry *e1, const struct entry *e2)
+{
+	size_t len = e1->len < e2->len ? e1->len : e2->len;
+	int ret = memcmp(e1->key, e2->key, len);
+
+	if (ret != 0)
+		return (ret);
+	if (e1->len != e2->len)
+		return (e1->len < e2->len ? -1 : 1);
+	return (0);
+}
+
+/* Stable bottom-up merge sort of n entries, using tmp as scratch space. */
+static struct entry *
+sort_entries(struct entry *e, struct entry *tmp, size_t n)
+{
+	for (size_t w = 1; w < n; w *= 2) {
+		struct entry *swap;
+
+		for (size_t lo = 0; lo < n; lo += 2 * w) {
+			size_t mid = lo + w < n ? lo + w : n;
+			size_t hi = lo + 2 * w < n ? lo + 2 * w : n;
+			size_t i = lo, j = mid, k = lo;
+
+			while (i < mid && j < hi)
+				tmp[k++] = entry_cmp(&e[j], &e[i]) < 0 ? e[j++] : e[i++];
+			while (i < mid)
+				tmp[k++] = e[i++];
+			while (j < hi)
+				tmp[k++] = e[j++];
+		}
+		swap = e;
+		e = tmp;
+		tmp = swap;
+	}
+	return (e);
+}
+
+/* Move the rdatas of src to the end of dst, and free the rest of src. */
+static void
+merge_rrset(wdns_rrset_t *dst, wdns_rrset_t *src)
+{
+	dst->rdatas = my_realloc(dst->rdatas,
+				 (dst->n_rdatas + src->n_rdatas) * sizeof(dst->rdatas[0]));
+	memcpy(&dst->rdatas[dst->n_rdatas], src->rdatas,
+	       src->n_rdatas * sizeof(src->rdatas[0]));
+	dst->n_rdatas += src->n_rdatas;
+	if (src->rrttl < dst->rrttl)
+		dst->rrttl = src->rrttl;
+
+	my_free(src->rdatas);
+	my_free(src->name.data);
+	src->n_rdatas = 0;
+}
+
+static wdns_res
+normalize_section(wdns_rrset_array_t *a, unsigned sec)
+{
+	struct entry *entries, *sorted;
+	wdns_rrset_t *rrsets;
+	uint8_t *keys, *k;
+	size_t n = a->n_rrsets;
+	size_t n_out = 0;
+	wdns_res res;
+
+	for (size_t i = 0; i < n; i++) {
+		if (sec == WDNS_MSG_SEC_QUESTION) {
+			wdns_downcase_name(&a->rrsets[i].name);
+		} else {
+			res = wdns_normalize_rrset(&a->rrsets[i], NULL);
+			if (res != wdns_res_success)
+				return (res);
+		}
+	}
+
+	if (n > 1) {
+		entries = my_malloc(2 * n * sizeof(*entries));
+		keys = k = my_malloc(n * LEN_SORTKEY_MAX);
+		for (size_t i = 0; i < n; i++) {
+			entries[i].key = k;
+			entries[i].len = make_key(&a->rrsets[i], k);
+			entries[i].idx = i;
+			k += entries[i].len;
+		}
+		sorted = sort_entries(entries, entries + n, n);
+
+		rrsets = my_malloc(n * sizeof(*rrsets));
+		for (size_t i = 0; i < n; i++) {
+			wdns_rrset_t *rrset = &a->rrsets[sorted[i].idx];
+
+			/* RRsets that differed only in the case of their owner
+			 * names now have equal keys */
+			if (sec != WDNS_MSG_SEC_QUESTION && i > 0 &&
+			    entry_cmp(&sorted[i - 1], &sorted[i]) == 0 &&
+			    rrsets[n_out - 1].n_rdatas + rrset->n_rdatas <= UINT16_MAX)
+			{
+				merge_rrset(&rrsets[n_out - 1], rrset);
+				res = wdns_normalize_rrset(&rrsets[n_out - 1], NULL);
+				assert(res == wdns_res_success);
+				continue;
+			}
+			rrsets[n_out++] = *rrset;
+		}
+
+		my_free(a->rrsets);
+		a->rrsets = rrsets;
+		a->n_rrsets = n_out;
+		my_free(keys);
+		my_free(entries);
+	}
+
+	return (_wdns_rebuild_rrs(a, sec));
+}
+
+/**
+ * Normalize a message for comparison and deduplication.
+ *
+ * In each section, owner names are downcased, the RRsets are sorted in
+ * canonical order of their owner names, then by rrtype and rrclass, and
+ * RRsets whose owner names differ only in case are merged. Each RRset is
+ * normalized by wdns_normalize_rrset(). Question entries are downcased and
+ * sorted, but not merged.
+ *
+ * The RRs of each section are rebuilt from the normalized RRsets; they appear
+ * grouped by RRset and carry the TTL of their RRset.
+ *
+ * \param[in,out] m the message
+ *
+ * \return wdns_res_success
+ * \return wdns_res_parse_error if an rdata is malformed, in which case the
+ *	message is only partially normalized
+ * \return wdns_res_overflow
+ */
+
+wdns_res
+wdns_normalize_message(wdns_message_t *m)
+{
+	wdns_res res;
+
+	for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++) {
+		res = normalize_section(&m->sections[sec], sec);
+		if (res != wdns_res_success)
+			return (res);
+	}
+
+	return (wdns_res_success);
+}
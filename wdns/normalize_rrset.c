@@ -0,0 +1,77 @@
+#define FNV64_OFFSET	0xcbf29ce484222325ULL
+#define FNV64_PRIME	0x00000100000001b3ULL
+
+static uint64_t
+fnv64(uint64_t h, const uint8_t *p, size_t len)
+{
+	while (len-- != 0) {
+		h ^= *p++;
+		h *= FNV64_PRIME;
+	}
+	return (h);
+}
+
+/**
+ * Normalize an RRset: downcase it, sort its rdata set, and remove duplicate
+ * rdatas.
+ *
+ * The result is the same as calling wdns_downcase_rrset() and
+ * wdns_sort_rrset() and then freeing each rdata equal to its predecessor.
+ *
+ * If hash is non-NULL, a 64 bit FNV-1a hash of the normalized RRset is
+ * returned in it. The hash covers the owner name, rrtype, rrclass, and
+ * rdatas, but not the TTL, so RRsets differing only in TTL hash alike. It is
+ * computed over network byte order fields and is stable across platforms
+ * and releases.
+ *
+ * \param[in,out] rrset the RRset
+ * \param[out] hash content hash, or NULL
+ *
+ * \return wdns_res_success
+ * \return wdns_res_parse_error if an rdata is malformed
+ */
+
+wdns_res
+wdns_normalize_rrset(wdns_rrset_t *rrset, uint64_t *hash)
+{
+	uint64_t h = FNV64_OFFSET;
+	uint8_t buf[4];
+	size_t n = 0;
+	wdns_res res;
+
+	/* the rdatas are downcased by the pass that chooses the sort, and
+	 * duplicates are dropped by the pass that hashes the sorted set */
+	wdns_downcase_name(&rrset->name);
+	res = _wdns_sort_rrset(rrset, true);
+	if (res != wdns_res_success)
+		return (res);
+
+	h = fnv64(h, &rrset->name.len, 1);
+	h = fnv64(h, rrset->name.data, rrset->name.len);
+	store_net16(buf, rrset->rrtype);
+	store_net16(buf + 2, rrset->rrclass);
+	h = fnv64(h, buf, 4);
+
+	for (size_t i = 0; i < rrset->n_rdatas; i++) {
+		wdns_rdata_t *r = rrset->rdatas[i];
+
+		/* the rdata set is sorted, so duplicates are adjacent */
+		if (n > 0 && rrset->rdatas[n - 1]->len == r->len &&
+		    memcmp(rrset->rdatas[n - 1]->data, r->data, r->len) == 0)
+		{
+			my_free(r);
+			continue;
+		}
+
+		store_net16(buf, r->len);
+		h = fnv64(h, buf, 2);
+		h = fnv64(h, r->data, r->len);
+		rrset->rdatas[n++] = r;
+	}
+	rrset->n_rdatas = n;
+
+	if (hash != NULL)
+		*hash = h;
+
+	return (wdns_res_success);
+}
@@ -1,21 +1,15 @@
-/**
- * Parse a DNS resource record contained in a DNS message.
- *
- * \param[in] sec section the RR is contained in
- * \param[in] p the DNS message that contains the resource record
- * \param[in] eop pointer to end of buffer containing message
- * \param[in] data pointer to start of resource record
- * \param[out] rrsz number of wire bytes read from message
- * \param[out] rr parsed resource record
+/*
+ * Check a DNS resource record contained in a DNS message, and if rr is
+ * non-NULL, copy it into rr. Nothing is allocated unless rr is non-NULL.
  */
-
-wdns_res
-_wdns_parse_message_rr(unsigned sec, const uint8_t *p, const uint8_t *eop, const uint8_t *data,
-		       size_t *rrsz, wdns_rr_t *rr)
+static wdns_res
+parse_message_rr(unsigned sec, const uint8_t *p, const uint8_t *eop, const uint8_t *data,
+		 size_t *rrsz, wdns_rr_t *rr)
 {
 	const uint8_t *src = data;
 	size_t len;
-	uint16_t rdlen;
+	uint16_t rrtype, rrclass, rdlen;
+	uint32_t rrttl = 0;
 	uint8_t domain_name[WDNS_MAXLEN_NAME];
 	wdns_res res;
 
@@ -24,59 +18,101 @@ _wdns_parse_message_rr(unsigned sec, const uint8_t *p, const uint8_t *eop, const
 	if (res != wdns_res_success)
 		return (res);
 
-	/* copy name */
-	rr->name.len = len;
-	rr->name.data = my_malloc(len);
-	memcpy(rr->name.data, domain_name, len);
-
 	/* skip name */
 	wdns_skip_name(&src, eop);
 
 	/* if this is a question RR, then we need 4 more bytes, rrtype (2) + rrclass (2). */
 	/* if this is a response RR, then we need 10 more bytes, rrtype (2) + rrclass (2) +
 	 * rrttl (4) + rdlen (2). */
-	if (src + 4 > eop || (sec != WDNS_MSG_SEC_QUESTION && src + 10 > eop)) {
-		res = wdns_res_parse_error;
-		goto err;
-	}
+	if (src + 4 > eop || (sec != WDNS_MSG_SEC_QUESTION && src + 10 > eop))
+		return (wdns_res_parse_error);
 
 	/* rrtype */
-	WDNS_BUF_GET16(rr->rrtype, src);
+	WDNS_BUF_GET16(rrtype, src);
 
 	/* rrclass */
-	WDNS_BUF_GET16(rr->rrclass, src);
+	WDNS_BUF_GET16(rrclass, src);
 
-	/* finished parsing if this is a question RR */
-	if (sec == WDNS_MSG_SEC_QUESTION) {
+	if (rr != NULL) {
+		rr->rrtype = rrtype;
+		rr->rrclass = rrclass;
 		rr->rrttl = 0;
 		rr->rdata = NULL;
+	}
+
+	/* finished parsing if this is a question RR */
+	if (sec == WDNS_MSG_SEC_QUESTION) {
 		*rrsz = (src - data);
-		return (wdns_res_success);
+		goto copy_name;
 	}
 
 	/* rrttl */
-	WDNS_BUF_GET32(rr->rrttl, src);
+	WDNS_BUF_GET32(rrttl, src);
 
 	/* rdlen */
 	WDNS_BUF_GET16(rdlen, src);
 
 	/* rdlen overflow check */
-	if (src + rdlen > eop) {
-		res = wdns_res_overflow;
-		goto err;
-	}
+	if (src + rdlen > eop)
+		return (wdns_res_overflow);
 
-	/* parse and copy the rdata */
-	res = _wdns_parse_rdata(rr, p, eop, src, rdlen);
+	/* check, or parse and copy, the rdata */
+	if (rr != NULL) {
+		rr->rrttl = rrttl;
+		res = _wdns_parse_rdata(rr, p, eop, src, rdlen);
+	} else {
+		res = _wdns_check_rdata(rrtype, rrclass, p, eop, src, rdlen, NULL);
+	}
 	if (res != wdns_res_success)
-		goto err;
+		return (res);
 
 	/* calculate the number of wire bytes that were read from the message */
 	*rrsz = (src - data) + rdlen;
 
+copy_name:
+	if (rr != NULL) {
+		rr->name.len = len;
+		rr->name.data = my_malloc(len);
+		memcpy(rr->name.data, domain_name, len);
+	}
+
 	return (wdns_res_success);
+}
+
+/**
+ * Parse a DNS resource record contained in a DNS message.
+ *
+ * \param[in] sec section the RR is contained in
+ * \param[in] p the DNS message that contains the resource record
+ * \param[in] eop pointer to end of buffer containing message
+ * \param[in] data pointer to start of resource record
+ * \param[out] rrsz number of wire bytes read from message
+ * \param[out] rr parsed resource record
+ */
+
+wdns_res
+_wdns_parse_message_rr(unsigned sec, const uint8_t *p, const uint8_t *eop, const uint8_t *data,
+		       size_t *rrsz, wdns_rr_t *rr)
+{
+	return (parse_message_rr(sec, p, eop, data, rrsz, rr));
+}
+
+/**
+ * Check a DNS resource record contained in a DNS message.
+ *
+ * The checks are those of _wdns_parse_message_rr(), including those of
+ * compression pointers and rdata, but nothing is copied or allocated.
+ *
+ * \param[in] sec section the RR is contained in
+ * \param[in] p the DNS message that contains the resource record
+ * \param[in] eop pointer to end of buffer containing message
+ * \param[in] data pointer to start of resource record
+ * \param[out] rrsz number of wire bytes read from message
+ */
 
-err:
-	my_free(rr->name.data);
-	return (res);
+wdns_res
+_wdns_check_message_rr(unsigned sec, const uint8_t *p, const uint8_t *eop, const uint8_t *data,
+		       size_t *rrsz)
+{
+	return (parse_message_rr(sec, p, eop, data, rrsz, NULL));
 }
@@ -1,16 +1,22 @@
 /**
- * Parse the rdata component of a resource record.
+ * Check the rdata component of a resource record.
  *
- * \param[out] rr resource record object whose ->rdata field will be populated
+ * The rdata is checked as _wdns_parse_rdata() would, without allocating:
+ * compressed names are expanded into a stack buffer. If u is non-NULL, the
+ * rdata with its names uncompressed is appended to it.
+ *
+ * \param[in] rrtype
+ * \param[in] rrclass
  * \param[in] p pointer to start of message
  * \param[in] eop end of message buffer
  * \param[in] rdata pointer to rdata
  * \param[in] rdlen
+ * \param[out] u buffer for the uncompressed rdata (may be NULL)
  */
 
 wdns_res
-_wdns_parse_rdata(wdns_rr_t *rr, const uint8_t *p, const uint8_t *eop,
-		  const uint8_t *rdata, uint16_t rdlen)
+_wdns_check_rdata(uint16_t rrtype, uint16_t rrclass, const uint8_t *p, const uint8_t *eop,
+		  const uint8_t *rdata, uint16_t rdlen, ubuf *u)
 {
 
 #define advance_bytes(x) do { \
@@ -27,12 +33,12 @@ _wdns_parse_rdata(wdns_rr_t *rr, const uint8_t *p, const uint8_t *eop,
 		res = wdns_res_parse_error; \
 		goto parse_error; \
 	} \
-	ubuf_append(u, src, x); \
+	if (u != NULL) \
+		ubuf_append(u, src, x); \
 	src += (x); \
 	src_bytes -= (x); \
 } while (0)
 
-	ubuf *u;
 	const record_descr *descr = NULL;
 	const uint8_t *src;
 	const uint8_t *t;
@@ -42,21 +48,29 @@ _wdns_parse_rdata(wdns_rr_t *rr, const uint8_t *p, const uint8_t *eop,
 	uint8_t oclen;
 	wdns_res res;
 
-	u = ubuf_new();
+	/* fixed length rrtypes are copied without being parsed field by field */
+	if (rrtype < record_descr_len && rdlen != 0 &&
+	    rdlen == record_descr_fixed_len[rrtype])
+	{
+		if (u != NULL)
+			ubuf_append(u, rdata, rdlen);
+		return (wdns_res_success);
+	}
+
 	src = rdata;
 	src_bytes = (ssize_t) rdlen;
 
-	if (rr->rrtype < record_descr_len)
-		descr = &record_descr_array[rr->rrtype];
+	if (rrtype < record_descr_len)
+		descr = &record_descr_array[rrtype];
 
-	if (rr->rrtype >= record_descr_len ||
+	if (rrtype >= record_descr_len ||
 	    (descr != NULL && descr->types[0] == rdf_unknown))
 	{
 		/* unknown rrtype, treat generically */
 		copy_bytes(src_bytes);
 	} else if (descr != NULL &&
 		   (descr->record_class == class_un ||
-		    descr->record_class == rr->rrclass))
+		    descr->record_class == rrclass))
 	{
 		for (t = &descr->types[0]; *t != rdf_end; t++) {
 			if (src_bytes == 0)
@@ -73,7 +87,8 @@ _wdns_parse_rdata(wdns_rr_t *rr, const uint8_t *p, const uint8_t *eop,
 					res = wdns_res_out_of_bounds;
 					goto parse_error;
 				}
-				ubuf_append(u, domain_name, len);
+				if (u != NULL)
+					ubuf_append(u, domain_name, len);
 				break;
 
 			case rdf_bytes:
@@ -152,6 +167,21 @@ _wdns_parse_rdata(wdns_rr_t *rr, const uint8_t *p, const uint8_t *eop,
 				break;
 			}
 
+			case rdf_svcparams: {
+				wdns_svcparam_iter_t it;
+				wdns_svcparam_t param;
+
+				_wdns_svcparam_iter_params(&it, src, src_bytes);
+				while ((res = wdns_svcparam_iter_next(&it, &param)) == wdns_res_success)
+					;
+				if (res != wdns_res_len) {
+					res = wdns_res_parse_error;
+					goto parse_error;
+				}
+				copy_bytes(src_bytes);
+				break;
+			}
+
 			default:
 				fprintf(stderr, "%s: unhandled rdf type %u\n", __func__, *t);
 				abort();
@@ -167,6 +197,50 @@ _wdns_parse_rdata(wdns_rr_t *rr, const uint8_t *p, const uint8_t *eop,
 		copy_bytes(src_bytes);
 	}
 
+	return (wdns_res_success);
+
+parse_error:
+	return (res);
+
+#undef advance_bytes
+#undef copy_bytes
+}
+
+/**
+ * Parse the rdata component of a resource record.
+ *
+ * \param[out] rr resource record object whose ->rdata field will be populated
+ * \param[in] p pointer to start of message
+ * \param[in] eop end of message buffer
+ * \param[in] rdata pointer to rdata
+ * \param[in] rdlen
+ */
+
+wdns_res
+_wdns_parse_rdata(wdns_rr_t *rr, const uint8_t *p, const uint8_t *eop,
+		  const uint8_t *rdata, uint16_t rdlen)
+{
+	ubuf *u;
+	size_t len;
+	wdns_res res;
+
+	/* fixed length rrtypes are copied without being parsed field by field */
+	if (rr->rrtype < record_descr_len && rdlen != 0 &&
+	    rdlen == record_descr_fixed_len[rr->rrtype])
+	{
+		rr->rdata = my_malloc(sizeof(wdns_rdata_t) + rdlen);
+		rr->rdata->len = rdlen;
+		memcpy(rr->rdata->data, rdata, rdlen);
+		return (wdns_res_success);
+	}
+
+	u = ubuf_new();
+	res = _wdns_check_rdata(rr->rrtype, rr->rrclass, p, eop, rdata, rdlen, u);
+	if (res != wdns_res_success) {
+		ubuf_destroy(&u);
+		return (res);
+	}
+
 	/* load rr->rdata */
 	len = ubuf_size(u);
 	rr->rdata = my_malloc(sizeof(wdns_rdata_t) + len);
@@ -175,11 +249,4 @@ _wdns_parse_rdata(wdns_rr_t *rr, const uint8_t *p, const uint8_t *eop,
 	ubuf_destroy(&u);
 
 	return (wdns_res_success);
-
-parse_error:
-	ubuf_destroy(&u);
-	return (res);
-
-#undef advance_bytes
-#undef copy_bytes
 }
@@ -0,0 +1,138 @@
+/*
+ * In-place patching of wire format DNS messages.
+ *
+ * These functions edit fixed-length fields of a message at their wire
+ * offsets. Each RR is checked with _wdns_check_message_rr(), which applies the
+ * same checks as wdns_parse_message(), including those of compression
+ * pointers and rdata, before it is patched. Nothing is allocated, and the
+ * message itself is never copied or resized.
+ */
+
+/**
+ * Walk the resource records of a wire format DNS message, allowing their
+ * fixed-length fields to be modified in place.
+ *
+ * cb is called for each RR in the answer, authority, and additional sections,
+ * including an EDNS OPT RR, in wire order. Changes the callback makes to the
+ * rrttl field are written back to the message after it returns, and it may
+ * modify the octets of the rdata, but not its length. Names within the rdata
+ * may be compressed. Question RRs are skipped.
+ *
+ * As with wdns_parse_message(), a message whose section counts exceed the
+ * RRs present is accepted if it ends on an RR boundary.
+ *
+ * \param[in,out] pkt the DNS message
+ * \param[in] len length of the message
+ * \param[in] cb called for each RR
+ * \param[in] user passed to cb
+ *
+ * \return wdns_res_success
+ * \return wdns_res_len
+ * \return any error returned by wdns_parse_message() for a malformed RR
+ */
+
+wdns_res
+wdns_patch_message(uint8_t *pkt, size_t len, wdns_callback_patch cb, void *user)
+{
+	const uint8_t *eop = pkt + len;
+	uint8_t *p = pkt + WDNS_LEN_HEADER;
+	uint16_t sec_counts[WDNS_MSG_SEC_MAX];
+	wdns_res res;
+
+	if (len < WDNS_LEN_HEADER)
+		return (wdns_res_len);
+
+	for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++)
+		load_net16(pkt + 4 + 2 * sec, &sec_counts[sec]);
+
+	for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++) {
+		for (unsigned n = 0; n < sec_counts[sec]; n++) {
+			wdns_patch_rr_t rr;
+			const uint8_t *name = p;
+			uint8_t *f;
+			size_t rrsz;
+			uint32_t rrttl;
+
+			if (p == eop)
+				return (wdns_res_success);
+
+			res = _wdns_check_message_rr(sec, pkt, eop, p, &rrsz);
+			if (res != wdns_res_success)
+				return (res);
+
+			if (sec != WDNS_MSG_SEC_QUESTION) {
+				f = p + wdns_skip_name(&name, eop);
+				rr.sec = sec;
+				load_net16(f, &rr.rrtype);
+				load_net16(f + 2, &rr.rrclass);
+				load_net32(f + 4, &rr.rrttl);
+				load_net16(f + 8, &rr.rdlen);
+				rr.rdata = f + 10;
+
+				rrttl = rr.rrttl;
+				cb(&rr, user);
+				if (rr.rrttl != rrttl)
+					store_net32(f + 4, rr.rrttl);
+			}
+
+			p += rrsz;
+		}
+	}
+
+	return (wdns_res_success);
+}
+
+/**
+ * Set the ID and flags of a wire format DNS message.
+ *
+ * \param[in,out] pkt the DNS message
+ * \param[in] len length of the message
+ * \param[in] id message ID
+ * \param[in] flags header flags, including the opcode and rcode
+ *
+ * \return wdns_res_success
+ * \return wdns_res_len
+ */
+
+wdns_res
+wdns_patch_header(uint8_t *pkt, size_t len, uint16_t id, uint16_t flags)
+{
+	if (len < WDNS_LEN_HEADER)
+		return (wdns_res_len);
+
+	store_net16(pkt, id);
+	store_net16(pkt + 2, flags);
+
+	return (wdns_res_success);
+}
+
+static void
+decrement_ttl(wdns_patch_rr_t *rr, void *user)
+{
+	uint32_t n = *((uint32_t *) user);
+
+	/* the TTL field of an OPT RR holds the extended rcode and flags */
+	if (rr->rrtype == WDNS_TYPE_OPT)
+		return;
+
+	rr->rrttl = rr->rrttl > n ? rr->rrttl - n : 0;
+}
+
+/**
+ * Decrement the TTLs of the RRs of a wire format DNS message.
+ *
+ * TTLs less than n are set to zero. The EDNS OPT RR is left unchanged.
+ *
+ * \param[in,out] pkt the DNS message
+ * \param[in] len length of the message
+ * \param[in] n number of seconds to subtract
+ *
+ * \return wdns_res_success
+ * \return any error returned by wdns_patch_message()
+ */
+
+wdns_res
+wdns_patch_ttls(uint8_t *pkt, size_t len, uint32_t n)
+{
+	return (wdns_patch_message(pkt, len, decrement_ttl, &n));
+}
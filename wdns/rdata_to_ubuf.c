@@ -35,6 +35,123 @@ rdata_to_str_string(const uint8_t *src, size_t len, ubuf *u)
 	return n_bytes;
 }
 
+static void
+svcparam_key_to_str(uint16_t key, ubuf *u)
+{
+	const char *s = _wdns_svcparam_key_to_str(key);
+
+	if (s != NULL)
+		ubuf_add_cstr(u, s);
+	else
+		ubuf_add_fmt(u, "key%hu", key);
+}
+
+static bool
+rdata_to_str_svcparams(const uint8_t *src, size_t len, ubuf *u)
+{
+	wdns_svcparam_iter_t it;
+	wdns_svcparam_t param;
+	wdns_res res;
+
+	_wdns_svcparam_iter_params(&it, src, len);
+	while ((res = wdns_svcparam_iter_next(&it, &param)) == wdns_res_success) {
+		svcparam_key_to_str(param.key, u);
+		if (param.len == 0) {
+			ubuf_add(u, ' ');
+			continue;
+		}
+		ubuf_add(u, '=');
+
+		switch (param.key) {
+		case WDNS_SVCPARAM_MANDATORY:
+			for (size_t i = 0; i < param.len; i += 2) {
+				uint16_t key;
+
+				load_net16(param.value + i, &key);
+				if (i != 0)
+					ubuf_add(u, ',');
+				svcparam_key_to_str(key, u);
+			}
+			break;
+
+		case WDNS_SVCPARAM_ALPN: {
+			const uint8_t *id;
+			uint8_t id_len;
+			size_t off = 0;
+
+			/* commas and backslashes within an identifier are
+			 * escaped once for the list and once for the string */
+			ubuf_add(u, '"');
+			while (wdns_svcparam_alpn_next(&param, &off, &id, &id_len)) {
+				if (off != 1U + id_len)
+					ubuf_add(u, ',');
+				for (size_t i = 0; i < id_len; i++) {
+					if (id[i] == ',')
+						ubuf_add_cstr(u, "\\\\,");
+					else if (id[i] == '\\')
+						ubuf_add_cstr(u, "\\\\\\\\");
+					else
+						rdata_to_str_string_unquoted(&id[i], 1, u);
+				}
+			}
+			ubuf_add(u, '"');
+			break;
+		}
+
+		case WDNS_SVCPARAM_PORT: {
+			uint16_t port;
+
+			load_net16(param.value, &port);
+			ubuf_add_fmt(u, "%hu", port);
+			break;
+		}
+
+		case WDNS_SVCPARAM_IPV4HINT:
+		case WDNS_SVCPARAM_IPV6HINT: {
+			char pres[WDNS_PRESLEN_TYPE_AAAA];
+			const uint8_t *addr;
+			int af = param.key == WDNS_SVCPARAM_IPV4HINT ? AF_INET : AF_INET6;
+
+			for (size_t i = 0; (addr = wdns_svcparam_hint(&param, i)) != NULL; i++) {
+				if (i != 0)
+					ubuf_add(u, ',');
+				inet_ntop(af, addr, pres, sizeof(pres));
+				ubuf_add_cstr(u, pres);
+			}
+			break;
+		}
+
+		case WDNS_SVCPARAM_ECH: {
+			base64_encodestate b64;
+			char *buf;
+			size_t buf_len;
+
+			base64_init_encodestate(&b64);
+			buf = alloca(2 * param.len + 4);
+			buf_len = base64_encode_block((const char *) param.value, param.len, buf, &b64);
+			buf_len += base64_encode_blockend(buf + buf_len, &b64);
+
+			/* the encoder breaks lines with spaces, which would end the value */
+			for (size_t i = 0; i < buf_len; i++) {
+				if (buf[i] != ' ')
+					ubuf_add(u, buf[i]);
+			}
+			break;
+		}
+
+		default:
+			ubuf_add(u, '"');
+			rdata_to_str_string_unquoted(param.value, param.len, u);
+			ubuf_add(u, '"');
+			break;
+		}
+
+		ubuf_add(u, ' ');
+	}
+
+	return (res == wdns_res_len);
+}
+
 void
 _wdns_rdata_to_ubuf(ubuf *u, const uint8_t *rdata, uint16_t rdlen,
 		    uint16_t rrtype, uint16_t rrclass)
@@ -340,6 +457,12 @@ _wdns_rdata_to_ubuf(ubuf *u, const uint8_t *rdata, uint16_t rdlen,
 			break;
 		} /* end case */
 
+		case rdf_svcparams:
+			if (!rdata_to_str_svcparams(src, src_bytes, u))
+				goto err;
+			src_bytes = 0;
+			break;
+
 		}
 	}
 
@@ -0,0 +1,50 @@
+/**
+ * Rebuild the RRs of an RRset array from its RRsets.
+ *
+ * Any existing RRs are freed. The new RRs appear grouped by RRset, one per
+ * rdata (or one per question), and carry the TTL of their RRset.
+ *
+ * \return wdns_res_success
+ * \return wdns_res_overflow if there would be more than 65535 RRs
+ */
+
+wdns_res
+_wdns_rebuild_rrs(wdns_rrset_array_t *a, unsigned sec)
+{
+	unsigned n_rrs = 0;
+
+	for (unsigned i = 0; i < a->n_rrs; i++)
+		wdns_clear_rr(&a->rrs[i]);
+	my_free(a->rrs);
+	a->n_rrs = 0;
+
+	for (unsigned i = 0; i < a->n_rrsets; i++)
+		n_rrs += sec == WDNS_MSG_SEC_QUESTION ? 1 : a->rrsets[i].n_rdatas;
+	if (n_rrs > UINT16_MAX)
+		return (wdns_res_overflow);
+
+	a->rrs = my_calloc(n_rrs > 0 ? n_rrs : 1, sizeof(wdns_rr_t));
+	for (unsigned i = 0; i < a->n_rrsets; i++) {
+		const wdns_rrset_t *rrset = &a->rrsets[i];
+		unsigned n = sec == WDNS_MSG_SEC_QUESTION ? 1 : rrset->n_rdatas;
+
+		for (unsigned j = 0; j < n; j++) {
+			wdns_rr_t *rr = &a->rrs[a->n_rrs++];
+
+			rr->rrttl = rrset->rrttl;
+			rr->rrtype = rrset->rrtype;
+			rr->rrclass = rrset->rrclass;
+			rr->name.len = rrset->name.len;
+			rr->name.data = my_malloc(rrset->name.len);
+			memcpy(rr->name.data, rrset->name.data, rrset->name.len);
+			if (sec != WDNS_MSG_SEC_QUESTION) {
+				size_t rdsz = sizeof(wdns_rdata_t) + rrset->rdatas[j]->len;
+
+				rr->rdata = my_malloc(rdsz);
+				memcpy(rr->rdata, rrset->rdatas[j], rdsz);
+			}
+		}
+	}
+
+	return (wdns_res_success);
+}
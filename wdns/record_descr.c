@@ -212,6 +212,78 @@ const record_descr record_descr_array[] = {
 		}
 
 	},
+
+	/* RFC 9460 */
+
+	[WDNS_TYPE_SVCB] = {
+		class_un,
+		{
+			rdf_int16,	/* SvcPriority */
+			rdf_uname,	/* TargetName */
+			rdf_svcparams,	/* SvcParams */
+			rdf_end,
+		}
+	},
+
+	[WDNS_TYPE_HTTPS] = {
+		class_un,
+		{
+			rdf_int16,	/* SvcPriority */
+			rdf_uname,	/* TargetName */
+			rdf_svcparams,	/* SvcParams */
+			rdf_end,
+		}
+	},
 };
 
 const size_t record_descr_len = sizeof(record_descr_array) / sizeof(record_descr);
+
+uint8_t record_descr_fixed_len[sizeof(record_descr_array) / sizeof(record_descr)];
+
+/*
+ * Derive record_descr_fixed_len[] from record_descr_array[]: the rdata length
+ * of each type made up only of fixed size fields, or zero. If the table is not
+ * built, every type takes the general path.
+ */
+
+#if defined(__GNUC__)
+__attribute__((constructor))
+#endif
+static void
+record_descr_fixed_len_init(void)
+{
+	for (size_t i = 0; i < record_descr_len; i++) {
+		const uint8_t *t;
+		size_t len = 0;
+
+		for (t = &record_descr_array[i].types[0]; *t != rdf_end; t++) {
+			switch (*t) {
+			case rdf_int8:
+				len += 1;
+				continue;
+			case rdf_int16:
+			case rdf_rrtype:
+				len += 2;
+				continue;
+			case rdf_int32:
+			case rdf_ipv4:
+				len += 4;
+				continue;
+			case rdf_eui48:
+				len += 6;
+				continue;
+			case rdf_eui64:
+				len += 8;
+				continue;
+			case rdf_ipv6:
+				len += 16;
+				continue;
+			default:
+				len = 0;
+				break;
+			}
+			break;
+		}
+		record_descr_fixed_len[i] = len <= UINT8_MAX ? len : 0;
+	}
+}
@@ -29,6 +29,7 @@ typedef enum {
 	rdf_type_bitmap,/* rr type bitmap */
 	rdf_salt,	/* length-prefixed salt value (hex presentation) */
 	rdf_hash,	/* length-prefixed hash value (base32 presentation) */
+	rdf_svcparams,	/* SVCB service parameters (terminal) */
 	rdf_end		/* sentinel (terminal) */
 } rdf_type;
 
@@ -39,5 +40,6 @@ typedef struct {
 
 extern const record_descr	record_descr_array[];
 extern const size_t		record_descr_len;
+extern uint8_t			record_descr_fixed_len[];
 
 #endif /* WDNS_RECORD_DESCR_H */
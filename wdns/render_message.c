@@ -0,0 +1,606 @@
+/*
+ * Name compression.
+ *
+ * Every name suffix written to the message (at an offset a compression
+ * pointer can reach) is entered in a small open addressing hash table, keyed
+ * by a hash of the suffix's uncompressed labels. To write a name, the hashes
+ * of all of its suffixes are computed right to left in one pass over the
+ * name, and the longest suffix already present in the message is replaced by
+ * a pointer. Candidates are confirmed by comparing the uncompressed names
+ * they were entered for, so hash collisions never produce a wrong pointer and
+ * the output buffer is never read back, which also allows the compressed size
+ * to be computed without an output buffer. Suffixes are matched
+ * case-sensitively, so that names decompress to exactly the original octets.
+ *
+ * Every entered suffix starts a label of at least two octets at an offset
+ * below RENDER_MAX_OFFSET, so the number of entries is bounded by the
+ * smaller of the output length and RENDER_MAX_OFFSET, halved. The table is
+ * sized from that bound when rendering starts and is never more than three
+ * quarters full. It lives on the stack for messages up to about 768 octets
+ * and is allocated for longer ones.
+ *
+ * Following RFC 3597 section 4, names in rdata are compressed only for the
+ * RFC 1035 well-known types. Names in the rdata of later types are written
+ * uncompressed and are not entered in the table, so they are never the
+ * target of a pointer either.
+ */
+
+#define RENDER_TABLE_STACK	512
+#define RENDER_MAX_OFFSET	0x3fff
+
+struct render_entry {
+	const uint8_t		*name;
+	uint32_t		hash;
+	uint16_t		off;
+};
+
+struct render {
+	uint8_t			*buf;
+	size_t			len;
+	size_t			off;
+
+	/* table slots in order of use, so that entries can be rolled back */
+	unsigned		n_entries;
+	unsigned		max_entries;
+	unsigned		mask;
+	uint16_t		*log;
+	struct render_entry	*table;
+};
+
+static inline uint32_t
+hash_label(const uint8_t *label, uint32_t h)
+{
+	for (unsigned i = 0; i <= label[0]; i++)
+		h = (h ^ label[i]) * 16777619U;
+	return (h ^ (h >> 15));
+}
+
+/* Compare two validated uncompressed names. */
+static bool
+suffix_equal(const uint8_t *a, const uint8_t *b)
+{
+	for (;;) {
+		if (a[0] != b[0])
+			return (false);
+		if (a[0] == 0)
+			return (true);
+		if (memcmp(a + 1, b + 1, a[0]) != 0)
+			return (false);
+		a += 1 + a[0];
+		b += 1 + b[0];
+	}
+}
+
+static int
+table_find(struct render *r, uint32_t hash, const uint8_t *name)
+{
+	for (unsigned i = hash & r->mask;
+	     r->table[i].name != NULL;
+	     i = (i + 1) & r->mask)
+	{
+		if (r->table[i].hash == hash && suffix_equal(r->table[i].name, name))
+			return (r->table[i].off);
+	}
+	return (-1);
+}
+
+static void
+table_add(struct render *r, uint32_t hash, const uint8_t *name, size_t off)
+{
+	unsigned i;
+
+	if (off > RENDER_MAX_OFFSET)
+		return;
+	assert(r->n_entries < r->max_entries);
+	for (i = hash & r->mask;
+	     r->table[i].name != NULL;
+	     i = (i + 1) & r->mask)
+		;
+	r->table[i].name = name;
+	r->table[i].hash = hash;
+	r->table[i].off = off;
+	r->log[r->n_entries++] = i;
+}
+
+/*
+ * Undo everything written since r->off was 'off' and the table held
+ * 'n_entries' entries. Removing linear probing entries in the reverse of the
+ * order they were added restores the table exactly.
+ */
+static void
+rollback(struct render *r, size_t off, unsigned n_entries)
+{
+	while (r->n_entries > n_entries)
+		r->table[r->log[--r->n_entries]].name = NULL;
+	r->off = off;
+}
+
+/* Return the length of the uncompressed name at p, or 0 if it is invalid. */
+static size_t
+name_len(const uint8_t *p, size_t len)
+{
+	size_t n = 0;
+
+	while (n < len && p[n] != 0) {
+		if (p[n] > 63)
+			return (0);
+		n += 1 + p[n];
+	}
+	if (n >= len || n + 1 > WDNS_MAXLEN_NAME)
+		return (0);
+	return (n + 1);
+}
+
+/* The write functions only count octets if there is no output buffer. */
+
+static wdns_res
+write_bytes(struct render *r, const void *p, size_t len)
+{
+	if (r->len - r->off < len)
+		return (wdns_res_overflow);
+	if (r->buf != NULL)
+		memcpy(r->buf + r->off, p, len);
+	r->off += len;
+	return (wdns_res_success);
+}
+
+static wdns_res
+write16(struct render *r, uint16_t val)
+{
+	if (r->len - r->off < 2)
+		return (wdns_res_overflow);
+	if (r->buf != NULL)
+		store_net16(r->buf + r->off, val);
+	r->off += 2;
+	return (wdns_res_success);
+}
+
+static wdns_res
+write32(struct render *r, uint32_t val)
+{
+	if (r->len - r->off < 4)
+		return (wdns_res_overflow);
+	if (r->buf != NULL)
+		store_net32(r->buf + r->off, val);
+	r->off += 4;
+	return (wdns_res_success);
+}
+
+/* Write a validated uncompressed name, compressing it if allowed. */
+static wdns_res
+write_name(struct render *r, const uint8_t *name, bool compress)
+{
+	uint32_t hashes[WDNS_MAXLEN_NAME / 2];
+	uint8_t offs[WDNS_MAXLEN_NAME / 2];
+	unsigned n_labels = 0, match;
+	size_t n = 0, len;
+	int ptr = -1;
+	uint32_t h = 0;
+
+	while (name[n] != 0) {
+		offs[n_labels++] = n;
+		n += 1 + name[n];
+	}
+
+	for (unsigned i = n_labels; i > 0; i--) {
+		h = hash_label(name + offs[i - 1], h);
+		hashes[i - 1] = h;
+	}
+
+	/* the longest suffix already present */
+	match = n_labels;
+	if (compress) {
+		for (unsigned i = 0; i < n_labels; i++) {
+			ptr = table_find(r, hashes[i], name + offs[i]);
+			if (ptr >= 0) {
+				match = i;
+				break;
+			}
+		}
+	}
+
+	len = match < n_labels ? offs[match] + 2U : n + 1;
+	if (r->len - r->off < len)
+		return (wdns_res_overflow);
+
+	for (unsigned i = 0; i < match; i++)
+		table_add(r, hashes[i], name + offs[i], r->off + offs[i]);
+
+	if (match < n_labels) {
+		write_bytes(r, name, offs[match]);
+		write16(r, 0xc000 | ptr);
+	} else {
+		write_bytes(r, name, n + 1);
+	}
+
+	return (wdns_res_success);
+}
+
+/* Return the record descriptor for rdata that may contain compressed names. */
+static const record_descr *
+compressible_descr(uint16_t rrtype, uint16_t rrclass, const wdns_rdata_t *rdata)
+{
+	const record_descr *descr;
+	const uint8_t *p = rdata->data;
+	size_t left = rdata->len;
+	bool has_name = false;
+
+	if (rrtype > WDNS_TYPE_TXT || rrtype >= record_descr_len)
+		return (NULL);
+	descr = &record_descr_array[rrtype];
+	if (descr->record_class != class_un && descr->record_class != rrclass)
+		return (NULL);
+
+	/* check the layout, so that writing can't fail halfway */
+	for (const uint8_t *t = &descr->types[0]; *t != rdf_end && left > 0; t++) {
+		size_t n;
+
+		switch (*t) {
+		case rdf_name:
+			n = name_len(p, left);
+			if (n == 0)
+				return (NULL);
+			has_name = true;
+			break;
+		case rdf_int16:
+			n = 2;
+			break;
+		case rdf_int32:
+			n = 4;
+			break;
+		default:
+			return (has_name ? descr : NULL);
+		}
+		if (n > left)
+			return (NULL);
+		p += n;
+		left -= n;
+	}
+	if (left != 0 || !has_name)
+		return (NULL);
+	return (descr);
+}
+
+static wdns_res
+write_rdata(struct render *r, uint16_t rrtype, uint16_t rrclass, const wdns_rdata_t *rdata)
+{
+	const record_descr *descr;
+	const uint8_t *p, *end;
+	size_t start;
+	wdns_res res;
+
+	descr = compressible_descr(rrtype, rrclass, rdata);
+	if (descr == NULL) {
+		res = write16(r, rdata->len);
+		if (res != wdns_res_success)
+			return (res);
+		return (write_bytes(r, rdata->data, rdata->len));
+	}
+
+	if (r->len - r->off < 2)
+		return (wdns_res_overflow);
+	start = r->off;
+	r->off += 2;
+
+	p = rdata->data;
+	end = p + rdata->len;
+	for (const uint8_t *t = &descr->types[0]; *t != rdf_end && p < end; t++) {
+		size_t n;
+
+		switch (*t) {
+		case rdf_name:
+			res = write_name(r, p, true);
+			n = name_len(p, end - p);
+			break;
+		case rdf_int16:
+			res = write_bytes(r, p, 2);
+			n = 2;
+			break;
+		case rdf_int32:
+			res = write_bytes(r, p, 4);
+			n = 4;
+			break;
+		default:
+			res = write_bytes(r, p, end - p);
+			n = end - p;
+			break;
+		}
+		if (res != wdns_res_success)
+			return (res);
+		p += n;
+	}
+
+	if (r->buf != NULL)
+		store_net16(r->buf + start, r->off - start - 2);
+	return (wdns_res_success);
+}
+
+static wdns_res
+write_rr(struct render *r, const wdns_name_t *name, uint16_t rrtype, uint16_t rrclass,
+	 uint32_t rrttl, const wdns_rdata_t *rdata, unsigned sec)
+{
+	wdns_res res;
+
+	if (name_len(name->data, name->len) != name->len)
+		return (wdns_res_name_len);
+
+	res = write_name(r, name->data, true);
+	if (res != wdns_res_success)
+		return (res);
+	res = write16(r, rrtype);
+	if (res != wdns_res_success)
+		return (res);
+	res = write16(r, rrclass);
+	if (res != wdns_res_success)
+		return (res);
+	if (sec == WDNS_MSG_SEC_QUESTION)
+		return (wdns_res_success);
+	res = write32(r, rrttl);
+	if (res != wdns_res_success)
+		return (res);
+	return (write_rdata(r, rrtype, rrclass, rdata));
+}
+
+static bool
+same_rrset(const wdns_rr_t *a, const wdns_rr_t *b)
+{
+	return (a->rrtype == b->rrtype && a->rrclass == b->rrclass &&
+		a->name.len == b->name.len &&
+		memcmp(a->name.data, b->name.data, a->name.len) == 0);
+}
+
+/*
+ * Write as many whole RRsets of a section as fit. On wdns_res_overflow,
+ * *count holds the number of RRs that were written before the RRset that did
+ * not fit, and that RRset has been rolled back.
+ */
+static wdns_res
+write_section(struct render *r, const wdns_rrset_array_t *a, unsigned sec, uint16_t *count)
+{
+	size_t off;
+	unsigned n_entries;
+	wdns_res res;
+
+	*count = 0;
+
+	/* the RR array holds the original order and TTLs, if populated */
+	if (a->n_rrs > 0) {
+		for (unsigned i = 0, j; i < a->n_rrs; i = j) {
+			off = r->off;
+			n_entries = r->n_entries;
+
+			for (j = i; j < a->n_rrs; j++) {
+				const wdns_rr_t *rr = &a->rrs[j];
+
+				if (j > i && (sec == WDNS_MSG_SEC_QUESTION ||
+					      !same_rrset(&a->rrs[i], rr)))
+					break;
+				res = write_rr(r, &rr->name, rr->rrtype, rr->rrclass,
+					       rr->rrttl, rr->rdata, sec);
+				if (res != wdns_res_success) {
+					rollback(r, off, n_entries);
+					return (res);
+				}
+			}
+			*count += j - i;
+		}
+		return (wdns_res_success);
+	}
+
+	for (unsigned i = 0; i < a->n_rrsets; i++) {
+		const wdns_rrset_t *rrset = &a->rrsets[i];
+		unsigned n = sec == WDNS_MSG_SEC_QUESTION ? 1 : rrset->n_rdatas;
+
+		if (*count + n > UINT16_MAX)
+			return (wdns_res_overflow);
+
+		off = r->off;
+		n_entries = r->n_entries;
+		for (unsigned j = 0; j < n; j++) {
+			res = write_rr(r, &rrset->name, rrset->rrtype, rrset->rrclass,
+				       rrset->rrttl,
+				       sec == WDNS_MSG_SEC_QUESTION ? NULL : rrset->rdatas[j],
+				       sec);
+			if (res != wdns_res_success) {
+				rollback(r, off, n_entries);
+				return (res);
+			}
+		}
+		*count += n;
+	}
+
+	return (wdns_res_success);
+}
+
+static size_t
+opt_size(const wdns_message_t *m)
+{
+	return (1 + 2 + 2 + 4 + 2 + (m->edns.options ? m->edns.options->len : 0));
+}
+
+static wdns_res
+write_opt(struct render *r, const wdns_message_t *m)
+{
+	static const wdns_rdata_t empty = { .len = 0 };
+	wdns_res res;
+
+	res = write_bytes(r, "", 1);
+	if (res != wdns_res_success)
+		return (res);
+	res = write16(r, WDNS_TYPE_OPT);
+	if (res != wdns_res_success)
+		return (res);
+	res = write16(r, m->edns.size);
+	if (res != wdns_res_success)
+		return (res);
+	res = write32(r, ((uint32_t) (m->rcode >> 8) << 24) |
+			 ((uint32_t) m->edns.version << 16) |
+			 m->edns.flags);
+	if (res != wdns_res_success)
+		return (res);
+	return (write_rdata(r, WDNS_TYPE_OPT, m->edns.size,
+			    m->edns.options ? m->edns.options : &empty));
+}
+
+static wdns_res
+render_sections(const wdns_message_t *m, struct render *r, size_t len, bool truncate,
+		uint16_t *counts, bool *tc)
+{
+	wdns_res res;
+
+	/* the OPT RR is written even if the sections are truncated */
+	r->len = len;
+	if (m->edns.present) {
+		if (r->len < opt_size(m))
+			return (wdns_res_overflow);
+		r->len -= opt_size(m);
+	}
+	if (r->len < WDNS_LEN_HEADER)
+		return (wdns_res_overflow);
+	r->off = WDNS_LEN_HEADER;
+
+	for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++)
+		counts[sec] = 0;
+
+	for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++) {
+		res = write_section(r, &m->sections[sec], sec, &counts[sec]);
+		if (res == wdns_res_overflow && truncate && sec != WDNS_MSG_SEC_QUESTION) {
+			/*
+			 * RFC 2181 section 9: TC is set only if RRsets that are
+			 * required in the answer or authority section are missing.
+			 */
+			if (sec != WDNS_MSG_SEC_ADDITIONAL)
+				*tc = true;
+			break;
+		}
+		if (res != wdns_res_success)
+			return (res);
+	}
+
+	if (m->edns.present) {
+		if (counts[WDNS_MSG_SEC_ADDITIONAL] == UINT16_MAX)
+			return (wdns_res_overflow);
+		r->len = len;
+		res = write_opt(r, m);
+		assert(res == wdns_res_success);
+		counts[WDNS_MSG_SEC_ADDITIONAL]++;
+	}
+
+	if (r->buf != NULL) {
+		store_net16(r->buf, m->id);
+		store_net16(r->buf + 2, (m->flags & ~0xf) | (m->rcode & 0xf) | (*tc ? 0x0200 : 0));
+		for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++)
+			store_net16(r->buf + 4 + 2 * sec, counts[sec]);
+	}
+
+	return (wdns_res_success);
+}
+
+static wdns_res
+render(const wdns_message_t *m, uint8_t *buf, size_t len, bool truncate,
+       size_t *sz, uint16_t *counts, bool *truncated)
+{
+	struct render_entry table[RENDER_TABLE_STACK];
+	uint16_t log[RENDER_TABLE_STACK / 4 * 3];
+	struct render r;
+	uint16_t n[WDNS_MSG_SEC_MAX];
+	bool tc = false;
+	size_t size = RENDER_TABLE_STACK;
+	size_t need = (len < RENDER_MAX_OFFSET ? len : RENDER_MAX_OFFSET) / 2 + 1;
+	wdns_res res;
+
+	if (counts == NULL)
+		counts = n;
+
+	r.buf = buf;
+	r.n_entries = 0;
+	while (size / 4 * 3 < need)
+		size *= 2;
+	r.mask = size - 1;
+	r.max_entries = size / 4 * 3;
+	if (size == RENDER_TABLE_STACK) {
+		memset(table, 0, sizeof(table));
+		r.table = table;
+		r.log = log;
+	} else {
+		r.table = my_calloc(size, sizeof(*r.table));
+		r.log = my_calloc(r.max_entries, sizeof(*r.log));
+	}
+
+	res = render_sections(m, &r, len, truncate, counts, &tc);
+	if (res == wdns_res_success) {
+		*sz = r.off;
+		if (truncated != NULL)
+			*truncated = tc;
+	}
+
+	if (r.table != table) {
+		my_free(r.table);
+		my_free(r.log);
+	}
+	return (res);
+}
+
+/**
+ * Render a wdns_message_t in DNS wire format.
+ *
+ * Owner names and the names in the rdata of the RFC 1035 well-known types are
+ * compressed. If the message has EDNS, an OPT RR carrying m->edns and the
+ * extended RCODE bits of m->rcode is appended to the additional section.
+ *
+ * Each section is rendered from its RR array, which preserves the order and
+ * TTLs of a parsed message, or, if that is empty, from its RRset array.
+ *
+ * If buf is NULL, nothing is written, and *sz receives the exact length the
+ * rendered message would have. Memory is allocated only for the compression
+ * table, and only if len is more than about 768 octets.
+ *
+ * \param[in] m the message to render
+ * \param[out] buf the output buffer (may be NULL)
+ * \param[in] len length of buf
+ * \param[out] sz length of the rendered message
+ *
+ * \return wdns_res_success
+ * \return wdns_res_overflow if the message does not fit in len octets
+ * \return wdns_res_name_len if an owner name is malformed
+ */
+
+wdns_res
+wdns_render_message(const wdns_message_t *m, uint8_t *buf, size_t len, size_t *sz)
+{
+	return (render(m, buf, len, false, sz, NULL, NULL));
+}
+
+/**
+ * Render a wdns_message_t in DNS wire format, truncating it to fit a limit.
+ *
+ * As wdns_render_message(), except that rendering stops at the first RRset
+ * that would take the message past limit octets. If that RRset belongs to the
+ * answer or authority section, the remaining sections are omitted and the TC
+ * bit is set; if it belongs to the additional section, the remaining
+ * additional RRsets are omitted and TC is not set (RFC 2181 section 9).
+ * Room for the OPT RR is reserved, so it is always included.
+ *
+ * With a NULL buf, the length and counts of the truncated message are
+ * computed without writing it, with the same compression as a real render.
+ *
+ * \param[in] m the message to render
+ * \param[out] buf the output buffer (may be NULL)
+ * \param[in] limit maximum length of the rendered message
+ * \param[out] sz length of the rendered message
+ * \param[out] counts number of RRs rendered in each section, including the
+ *	OPT RR (may be NULL)
+ * \param[out] truncated whether TC was set (may be NULL)
+ *
+ * \return wdns_res_success
+ * \return wdns_res_overflow if the header, question section, and OPT RR
+ *	do not fit within limit
+ * \return wdns_res_name_len if an owner name is malformed
+ */
+
+wdns_res
+wdns_render_message_limit(const wdns_message_t *m, uint8_t *buf, size_t limit,
+			  size_t *sz, uint16_t counts[WDNS_MSG_SEC_MAX], bool *truncated)
+{
+	return (render(m, buf, limit, true, sz, counts, truncated));
+}
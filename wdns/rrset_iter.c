@@ -0,0 +1,136 @@
+/* Validate the serialized RRset array at *p and advance *p past it. */
+static wdns_res
+iter_init(wdns_rrset_iter_t *it, const uint8_t **p, const uint8_t *end)
+{
+	const uint8_t *src = *p;
+	uint32_t val;
+	wdns_rrset_view_t v;
+	wdns_res res;
+
+	if (!_wdns_get_varint(&src, end, UINT16_MAX, &val))
+		return (wdns_res_parse_error);
+	it->n_rrsets = val;
+	it->_p = src;
+	it->_n = 0;
+
+	for (unsigned i = 0; i < it->n_rrsets; i++) {
+		if (end - src < 4)
+			return (wdns_res_parse_error);
+		load_net32(src, &val);
+		src += 4;
+		if (val > end - src)
+			return (wdns_res_parse_error);
+		res = wdns_rrset_view_init(&v, src, val);
+		if (res != wdns_res_success)
+			return (res);
+		src += val;
+	}
+
+	it->_end = src;
+	*p = src;
+	return (wdns_res_success);
+}
+
+/**
+ * Initialize an iterator over a serialized RRset array.
+ *
+ * The array is validated in its entirety, so that its RRsets can
+ * subsequently be visited with wdns_rrset_iter_next() without further bounds
+ * checking. Nothing is copied; buf must outlive the iterator and the views it
+ * returns.
+ *
+ * \param[out] it the iterator
+ * \param[in] buf RRset array serialized by wdns_serialize_rrset_array()
+ * \param[in] sz length of buf
+ *
+ * \return wdns_res_success
+ * \return wdns_res_parse_error
+ */
+
+wdns_res
+wdns_rrset_iter_init(wdns_rrset_iter_t *it, const uint8_t *buf, size_t sz)
+{
+	const uint8_t *end = buf + sz;
+	wdns_res res;
+
+	res = iter_init(it, &buf, end);
+	if (res != wdns_res_success)
+		return (res);
+	if (buf != end)
+		return (wdns_res_parse_error);
+	return (wdns_res_success);
+}
+
+/**
+ * Visit the next RRset of a serialized RRset array.
+ *
+ * \param[in,out] it the iterator
+ * \param[out] v a view of the next RRset
+ *
+ * \return true if an RRset was returned, false if all RRsets have been visited
+ */
+
+bool
+wdns_rrset_iter_next(wdns_rrset_iter_t *it, wdns_rrset_view_t *v)
+{
+	uint32_t len;
+	wdns_res res;
+
+	if (it->_n == it->n_rrsets)
+		return (false);
+
+	load_net32(it->_p, &len);
+	it->_p += 4;
+	res = wdns_rrset_view_init(v, it->_p, len);
+	assert(res == wdns_res_success);
+	it->_p += len;
+	it->_n++;
+	return (true);
+}
+
+/**
+ * Decode a message serialized by wdns_serialize_message().
+ *
+ * The header and EDNS fields are decoded, and each section is validated and
+ * prepared for iteration with wdns_rrset_iter_next(). As with
+ * wdns_rrset_iter_init(), nothing is copied.
+ *
+ * \param[out] sm the decoded message
+ * \param[in] buf serialized message
+ * \param[in] sz length of buf
+ *
+ * \return wdns_res_success
+ * \return wdns_res_parse_error
+ */
+
+wdns_res
+wdns_serialized_message_init(wdns_serialized_message_t *sm, const uint8_t *buf, size_t sz)
+{
+	const uint8_t *end = buf + sz;
+	_wdns_message_header_t h;
+	wdns_res res;
+
+	memset(sm, 0, sizeof(*sm));
+
+	if (!_wdns_get_message_header(&buf, end, &h))
+		return (wdns_res_parse_error);
+	sm->id = h.id;
+	sm->flags = h.flags;
+	sm->rcode = h.rcode;
+	sm->edns_present = h.edns_present;
+	sm->edns_version = h.edns_version;
+	sm->edns_flags = h.edns_flags;
+	sm->edns_size = h.edns_size;
+	sm->edns_options_len = h.edns_options_len;
+	sm->edns_options = h.edns_options;
+
+	for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++) {
+		res = iter_init(&sm->sections[sec], &buf, end);
+		if (res != wdns_res_success)
+			return (res);
+	}
+	if (buf != end)
+		return (wdns_res_parse_error);
+
+	return (wdns_res_success);
+}
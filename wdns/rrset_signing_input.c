@@ -0,0 +1,291 @@
+/*
+ * The RFC 4034 section 3.1.8.1 signing input of an RRset is
+ *
+ *	RRSIG_RDATA | RR(1) | RR(2) | ...
+ *
+ * where RRSIG_RDATA is the RRSIG rdata without the signature, and each RR is
+ *
+ *	owner | type | class | original TTL | rdlength | rdata
+ *
+ * in the canonical form of RFC 4034 section 6: names are uncompressed and
+ * downcased, and the RRs are in canonical order with duplicates removed.
+ *
+ * The signing input is written without modifying the RRset. The names in each
+ * rdata are located once, and the rdatas are then sorted by their canonical
+ * form in a small array that lives on the stack unless the RRset is large.
+ */
+
+#define LEN_RRSIG_FIXED		18
+#define LEN_CHUNK		256
+#define N_CANON_STACK		16
+
+struct canon_rdata {
+	const wdns_rdata_t	*r;
+	unsigned		n_spans;
+	_wdns_span_t		spans[_WDNS_MAX_NAME_SPANS];
+};
+
+struct sink {
+	uint8_t			*buf;
+	size_t			len;
+	size_t			off;
+	wdns_callback_data	cb;
+	void			*user;
+};
+
+static void
+emit(struct sink *s, const uint8_t *data, size_t n)
+{
+	if (n == 0)
+		return;
+	if (s->cb != NULL)
+		s->cb(data, n, s->user);
+	else if (s->buf != NULL && s->off + n <= s->len)
+		memcpy(s->buf + s->off, data, n);
+	s->off += n;
+}
+
+static void
+emit_lower(struct sink *s, const uint8_t *data, size_t n)
+{
+	uint8_t chunk[LEN_CHUNK];
+
+	while (n > 0) {
+		size_t c = n < sizeof(chunk) ? n : sizeof(chunk);
+
+		for (size_t i = 0; i < c; i++) {
+			chunk[i] = data[i];
+			if (chunk[i] >= 'A' && chunk[i] <= 'Z')
+				chunk[i] |= 0x20;
+		}
+		emit(s, chunk, c);
+		data += c;
+		n -= c;
+	}
+}
+
+static void
+emit_u16(struct sink *s, uint16_t val)
+{
+	uint8_t b[2];
+
+	store_net16(b, val);
+	emit(s, b, sizeof(b));
+}
+
+static void
+emit_u32(struct sink *s, uint32_t val)
+{
+	uint8_t b[4];
+
+	store_net32(b, val);
+	emit(s, b, sizeof(b));
+}
+
+/* Octet i of the canonical form of an rdata. */
+static uint8_t
+canon_octet(const struct canon_rdata *c, size_t i)
+{
+	uint8_t o = c->r->data[i];
+
+	if (o >= 'A' && o <= 'Z') {
+		for (unsigned j = 0; j < c->n_spans; j++) {
+			if (i >= c->spans[j].off && i < (size_t) c->spans[j].off + c->spans[j].len)
+				return (o | 0x20);
+		}
+	}
+	return (o);
+}
+
+/*
+ * Compare the canonical forms of two rdatas as left-justified unsigned octet
+ * sequences, where a shorter sequence sorts first (RFC 4034 section 6.3).
+ */
+static int
+canon_cmp(const void *a, const void *b)
+{
+	const struct canon_rdata *c1 = a, *c2 = b;
+	size_t len = c1->r->len < c2->r->len ? c1->r->len : c2->r->len;
+
+	for (size_t i = 0; i < len; i++) {
+		uint8_t o1 = canon_octet(c1, i);
+		uint8_t o2 = canon_octet(c2, i);
+
+		if (o1 != o2)
+			return (o1 < o2 ? -1 : 1);
+	}
+	if (c1->r->len != c2->r->len)
+		return (c1->r->len < c2->r->len ? -1 : 1);
+	return (0);
+}
+
+static void
+emit_rdata(struct sink *s, const struct canon_rdata *c)
+{
+	size_t off = 0;
+
+	for (unsigned j = 0; j < c->n_spans; j++) {
+		emit(s, c->r->data + off, c->spans[j].off - off);
+		emit_lower(s, c->r->data + c->spans[j].off, c->spans[j].len);
+		off = c->spans[j].off + c->spans[j].len;
+	}
+	emit(s, c->r->data + off, c->r->len - off);
+}
+
+static wdns_res
+signing_input(const wdns_rrset_t *rrset, const wdns_rdata_t *rrsig, struct sink *s)
+{
+	struct canon_rdata stack[N_CANON_STACK], *canon = stack;
+	const uint8_t *owner = rrset->name.data;
+	size_t owner_len = rrset->name.len;
+	uint32_t ttl = rrset->rrttl;
+	bool wildcard = false;
+	wdns_res res = wdns_res_success;
+
+	if (rrset->n_rdatas > N_CANON_STACK)
+		canon = my_malloc(rrset->n_rdatas * sizeof(*canon));
+
+	for (size_t i = 0; i < rrset->n_rdatas; i++) {
+		canon[i].r = rrset->rdatas[i];
+		res = _wdns_rdata_name_spans(canon[i].r->data, canon[i].r->len,
+					     rrset->rrtype, rrset->rrclass,
+					     canon[i].spans, &canon[i].n_spans);
+		if (res != wdns_res_success)
+			goto out;
+	}
+
+	if (rrsig != NULL) {
+		wdns_name_t name = { .len = owner_len, .data = rrset->name.data };
+		size_t signer_len, n_labels;
+		uint16_t covered;
+
+		res = wdns_res_parse_error;
+		if (rrsig->len < LEN_RRSIG_FIXED ||
+		    wdns_len_uname(rrsig->data + LEN_RRSIG_FIXED, rrsig->data + rrsig->len,
+				   &signer_len) != wdns_res_success)
+		{
+			goto out;
+		}
+		load_net16(rrsig->data, &covered);
+		if (covered != rrset->rrtype)
+			goto out;
+		load_net32(rrsig->data + 4, &ttl);
+
+		/* a wildcard owner "*" label is not counted (RFC 4034 section 3.1.3) */
+		if (wdns_count_labels(&name, &n_labels) != wdns_res_success)
+			goto out;
+		if (owner_len >= 2 && owner[0] == 1 && owner[1] == '*')
+			n_labels--;
+		if (rrsig->data[3] > n_labels)
+			goto out;
+
+		/* the owner of an RR synthesized from a wildcard is the wildcard
+		 * name (RFC 4035 section 5.3.2), so the owner keeps only the
+		 * rightmost labels counted by the RRSIG, below a new "*" label */
+		if (rrsig->data[3] < n_labels) {
+			wildcard = true;
+			if (owner[0] == 1 && owner[1] == '*') {
+				owner_len -= 2;
+				owner += 2;
+			}
+			for (; n_labels > rrsig->data[3]; n_labels--) {
+				owner_len -= 1 + owner[0];
+				owner += 1 + owner[0];
+			}
+			if (owner_len + 2 > WDNS_MAXLEN_NAME) {
+				res = wdns_res_name_len;
+				goto out;
+			}
+		}
+		res = wdns_res_success;
+
+		emit(s, rrsig->data, LEN_RRSIG_FIXED);
+		emit_lower(s, rrsig->data + LEN_RRSIG_FIXED, signer_len);
+	}
+
+	qsort(canon, rrset->n_rdatas, sizeof(*canon), canon_cmp);
+
+	for (size_t i = 0; i < rrset->n_rdatas; i++) {
+		if (i > 0 && canon_cmp(&canon[i - 1], &canon[i]) == 0)
+			continue;
+
+		if (wildcard)
+			emit(s, (const uint8_t *) "\x01*", 2);
+		emit_lower(s, owner, owner_len);
+		emit_u16(s, rrset->rrtype);
+		emit_u16(s, rrset->rrclass);
+		emit_u32(s, ttl);
+		emit_u16(s, canon[i].r->len);
+		emit_rdata(s, &canon[i]);
+	}
+
+out:
+	if (canon != stack)
+		my_free(canon);
+	return (res);
+}
+
+/**
+ * Write the DNSSEC signing input of an RRset.
+ *
+ * If rrsig is non-NULL, the signing input begins with the RRSIG rdata
+ * excluding the signature, the RRs carry the original TTL of the RRSIG, and
+ * if the RRSIG labels field indicates that the RRset was synthesized from a
+ * wildcard, the owner of each RR is the wildcard name. If rrsig is NULL, only
+ * the canonical form of the RRset is written, with the TTL of the RRset.
+ *
+ * The RRset itself is not modified.
+ *
+ * \param[in] rrset the RRset
+ * \param[in] rrsig rdata of the RRSIG covering the RRset, or NULL
+ * \param[out] buf output buffer, or NULL to only compute the length
+ * \param[in] len length of buf
+ * \param[out] sz length of the signing input
+ *
+ * \return wdns_res_success
+ * \return wdns_res_overflow if the signing input is longer than len
+ * \return wdns_res_name_len if the wildcard owner name is too long
+ * \return wdns_res_parse_error if an rdata or the RRSIG is malformed
+ */
+
+wdns_res
+wdns_rrset_signing_input(const wdns_rrset_t *rrset, const wdns_rdata_t *rrsig,
+			 uint8_t *buf, size_t len, size_t *sz)
+{
+	struct sink s = { .buf = buf, .len = len };
+	wdns_res res;
+
+	res = signing_input(rrset, rrsig, &s);
+	if (res != wdns_res_success)
+		return (res);
+	if (sz != NULL)
+		*sz = s.off;
+	if (buf != NULL && s.off > len)
+		return (wdns_res_overflow);
+	return (wdns_res_success);
+}
+
+/**
+ * Pass the DNSSEC signing input of an RRset to a callback.
+ *
+ * The signing input is the same as that written by wdns_rrset_signing_input(),
+ * delivered in pieces suitable for an incremental hash or signature function.
+ *
+ * \param[in] rrset the RRset
+ * \param[in] rrsig rdata of the RRSIG covering the RRset, or NULL
+ * \param[in] cb called with each piece of the signing input, in order
+ * \param[in] user passed to cb
+ *
+ * \return wdns_res_success
+ * \return wdns_res_name_len if the wildcard owner name is too long
+ * \return wdns_res_parse_error if an rdata or the RRSIG is malformed
+ */
+
+wdns_res
+wdns_rrset_signing_input_cb(const wdns_rrset_t *rrset, const wdns_rdata_t *rrsig,
+			    wdns_callback_data cb, void *user)
+{
+	struct sink s = { .cb = cb, .user = user };
+
+	return (signing_input(rrset, rrsig, &s));
+}
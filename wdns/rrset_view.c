@@ -0,0 +1,176 @@
+#define V2_LEN_HEADER	4
+
+/* Read the rdata length at p, which may not extend past end. */
+static const uint8_t *
+get_rdlen(const wdns_rrset_view_t *v, const uint8_t *p, const uint8_t *end, uint16_t *rdlen)
+{
+	if (v->_flags & WDNS_SERIALIZE_V2_VARINT) {
+		size_t avail = end - p;
+		uint32_t val;
+		unsigned len;
+
+		len = varint_length_packed(p, avail < 3 ? avail : 3);
+		if (len == 0)
+			return (NULL);
+		varint_decode32(p, &val);
+		if (val > UINT16_MAX)
+			return (NULL);
+		*rdlen = val;
+		return (p + len);
+	}
+
+	if (end - p < 2)
+		return (NULL);
+	if (v->_table != NULL)
+		load_net16(p, rdlen);
+	else
+		memcpy(rdlen, p, 2);
+	return (p + 2);
+}
+
+/**
+ * Initialize a view of a serialized wdns_rrset_t.
+ *
+ * Both the version 1 format written by wdns_serialize_rrset() and the version
+ * 2 format written by wdns_serialize_rrset_v2() are accepted. The serialized
+ * RRset is validated, but nothing is copied or allocated; the name and rdata
+ * pointers returned by the view point into buf, which must outlive the view.
+ * buf may be a read-only mapping of a file.
+ *
+ * \param[out] v the view
+ * \param[in] buf serialized RRset
+ * \param[in] sz length of buf
+ *
+ * \return wdns_res_success
+ * \return wdns_res_overflow if buf is truncated
+ * \return wdns_res_parse_error if buf is not a valid serialized RRset
+ */
+
+wdns_res
+wdns_rrset_view_init(wdns_rrset_view_t *v, const uint8_t *buf, size_t sz)
+{
+	const uint8_t *end = buf + sz;
+	const uint8_t *p = buf;
+
+	v->_buf = buf;
+	v->_table = NULL;
+	v->_flags = 0;
+
+	if (sz >= 1 && buf[0] == 0) {
+		if (sz < V2_LEN_HEADER)
+			return (wdns_res_overflow);
+		if (buf[1] != 'W' || buf[2] != 2 || (buf[3] & ~WDNS_SERIALIZE_V2_VARINT) != 0)
+			return (wdns_res_parse_error);
+		v->_flags = buf[3];
+		p += V2_LEN_HEADER;
+	}
+
+	if (end - p < 1 || end - p < 1 + p[0] + 2 + 2 + 4 + 2)
+		return (wdns_res_overflow);
+
+	v->name_len = p[0];
+	v->name = p + 1;
+	p += 1 + v->name_len;
+
+	if (buf[0] == 0) {
+		load_net16(p, &v->rrtype);
+		load_net16(p + 2, &v->rrclass);
+		load_net32(p + 4, &v->rrttl);
+		load_net16(p + 8, &v->n_rdatas);
+		p += 10;
+
+		/* the offset table occupies the end of the buffer */
+		if ((size_t) (end - p) < 4U * v->n_rdatas)
+			return (wdns_res_overflow);
+		end -= 4U * v->n_rdatas;
+		v->_table = end;
+	} else {
+		memcpy(&v->rrtype, p, 2);
+		memcpy(&v->rrclass, p + 2, 2);
+		memcpy(&v->rrttl, p + 4, 4);
+		memcpy(&v->n_rdatas, p + 8, 2);
+		p += 10;
+	}
+
+	v->_rdatas = v->_cur = p;
+	v->_cur_idx = 0;
+
+	for (unsigned i = 0; i < v->n_rdatas; i++) {
+		uint16_t rdlen;
+
+		if (v->_table != NULL) {
+			uint32_t off;
+
+			load_net32(v->_table + 4 * i, &off);
+			if (off != (size_t) (p - buf))
+				return (wdns_res_parse_error);
+		}
+		p = get_rdlen(v, p, end, &rdlen);
+		if (p == NULL || end - p < rdlen)
+			return (wdns_res_overflow);
+		p += rdlen;
+	}
+	if (v->_table != NULL && p != end)
+		return (wdns_res_parse_error);
+
+	return (wdns_res_success);
+}
+
+/**
+ * Return an rdata of an RRset view.
+ *
+ * Version 2 serializations are accessed through their offset table in O(1).
+ * For version 1, the view remembers the position following the last rdata
+ * returned, so accessing the rdatas in order costs O(1) each.
+ *
+ * \param[in] v the view
+ * \param[in] i index of the rdata
+ * \param[out] rdata the rdata, pointing into the serialized RRset
+ * \param[out] rdlen length of the rdata
+ *
+ * \return wdns_res_success
+ * \return wdns_res_out_of_bounds if i >= v->n_rdatas
+ */
+
+wdns_res
+wdns_rrset_view_rdata(wdns_rrset_view_t *v, uint16_t i,
+		      const uint8_t **rdata, uint16_t *rdlen)
+{
+	const uint8_t *p;
+	uint16_t len;
+
+	if (i >= v->n_rdatas)
+		return (wdns_res_out_of_bounds);
+
+	/* the buffer was validated by wdns_rrset_view_init() */
+	if (v->_table != NULL) {
+		uint32_t off;
+
+		load_net32(v->_table + 4 * i, &off);
+		p = get_rdlen(v, v->_buf + off, v->_table, &len);
+		assert(p != NULL);
+		*rdata = p;
+		*rdlen = len;
+		return (wdns_res_success);
+	}
+
+	if (i < v->_cur_idx) {
+		v->_cur = v->_rdatas;
+		v->_cur_idx = 0;
+	}
+
+	p = v->_cur;
+	for (unsigned j = v->_cur_idx; j < i; j++) {
+		memcpy(&len, p, 2);
+		p += 2 + len;
+	}
+
+	memcpy(&len, p, 2);
+	*rdata = p + 2;
+	*rdlen = len;
+
+	v->_cur = p + 2 + len;
+	v->_cur_idx = i + 1;
+
+	return (wdns_res_success);
+}
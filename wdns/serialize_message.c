@@ -0,0 +1,31 @@
+/**
+ * Serialize a parsed DNS message into a single buffer.
+ *
+ * The header, EDNS fields, and the RRsets of every section are written into
+ * one contiguous buffer. See serialize_rrset_array.c for the format.
+ *
+ * \param[in] m the message to serialize
+ * \param[out] buf the serialized message, which must be freed by the caller
+ * \param[out] sz length of buf
+ *
+ * \return wdns_res_success
+ */
+
+wdns_res
+wdns_serialize_message(const wdns_message_t *m, uint8_t **buf, size_t *sz)
+{
+	ubuf *u;
+
+	u = ubuf_new();
+
+	ubuf_reserve(u, _wdns_message_header_len(m));
+	ubuf_advance(u, _wdns_put_message_header(m, ubuf_ptr(u)));
+
+	for (unsigned sec = 0; sec < WDNS_MSG_SEC_MAX; sec++)
+		_wdns_serialize_rrset_array_ubuf(u, &m->sections[sec]);
+
+	ubuf_detach(u, buf, sz);
+	ubuf_destroy(&u);
+
+	return (wdns_res_success);
+}
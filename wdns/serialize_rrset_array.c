@@ -0,0 +1,54 @@
+/*
+ * Serialized RRset array and message formats.
+ *
+ *	array	:= varint(n_rrsets) (u32(len) rrset)*
+ *	message	:= header array array array array
+ *
+ * Each rrset is len octets in the version 2 format written by
+ * wdns_serialize_rrset_v2() with varint rdata lengths, so it can be read in
+ * place with wdns_rrset_view_init() on any host. len is a fixed width network
+ * byte order integer, so that it can be filled in after the rrset has been
+ * written. header is the message header encoding described in
+ * message_header.c, and the arrays of a message are its sections, question
+ * section first. Only the RRsets of an array are stored; its RRs are rebuilt
+ * from them by wdns_deserialize_rrset_array().
+ */
+
+void
+_wdns_serialize_rrset_array_ubuf(ubuf *u, const wdns_rrset_array_t *a)
+{
+	ubuf_reserve(u, varint_length(a->n_rrsets));
+	ubuf_advance(u, varint_encode32(ubuf_ptr(u), a->n_rrsets));
+
+	for (unsigned i = 0; i < a->n_rrsets; i++) {
+		size_t len_off = ubuf_size(u);
+
+		ubuf_reserve(u, 4);
+		ubuf_advance(u, 4);
+		_wdns_serialize_rrset_v2_ubuf(u, &a->rrsets[i], WDNS_SERIALIZE_V2_VARINT);
+		store_net32(ubuf_data(u) + len_off, ubuf_size(u) - len_off - 4);
+	}
+}
+
+/**
+ * Serialize the RRsets of a wdns_rrset_array_t into a single buffer.
+ *
+ * \param[in] a the RRset array to serialize
+ * \param[out] buf the serialized array, which must be freed by the caller
+ * \param[out] sz length of buf
+ *
+ * \return wdns_res_success
+ */
+
+wdns_res
+wdns_serialize_rrset_array(const wdns_rrset_array_t *a, uint8_t **buf, size_t *sz)
+{
+	ubuf *u;
+
+	u = ubuf_new();
+	_wdns_serialize_rrset_array_ubuf(u, a);
+	ubuf_detach(u, buf, sz);
+	ubuf_destroy(&u);
+
+	return (wdns_res_success);
+}
@@ -0,0 +1,147 @@
+/*
+ * Serialized RRset format, version 2.
+ *
+ *	header	:= octet(0) octet('W') octet(2) octet(flags)
+ *	rrset	:= header octet(namelen) namelen*octet
+ *		   u16(rrtype) u16(rrclass) u32(rrttl) u16(n_rdatas)
+ *		   rdata* u32(offset)*n_rdatas
+ *	rdata	:= rdlen rdlen*octet
+ *	rdlen	:= u16			unless flags & WDNS_SERIALIZE_V2_VARINT
+ *		 | varint		if flags & WDNS_SERIALIZE_V2_VARINT
+ *
+ * Fixed width integers are in network byte order. The leading zero octet
+ * can't begin a version 1 serialization, whose first octet is the length of a
+ * wire format name, so readers tell the two formats apart by the first octet.
+ * The trailing table holds the offset of each rdata (that is, of its rdlen)
+ * from the start of the serialization, giving O(1) access to any rdata.
+ */
+
+/**
+ * Serialize a wdns_rrset_t in the version 2 format.
+ *
+ * \param[in] rrset the RRset to serialize
+ * \param[in] flags WDNS_SERIALIZE_V2_* flags
+ * \param[out] buf the output buffer (may be NULL)
+ * \param[out] sz serialized length (may be NULL)
+ *
+ * \return wdns_res_success
+ */
+
+wdns_res
+wdns_serialize_rrset_v2(const wdns_rrset_t *rrset, unsigned flags, uint8_t *buf, size_t *sz)
+{
+	bool varint = (flags & WDNS_SERIALIZE_V2_VARINT) != 0;
+
+	if (sz) {
+		*sz = 4;			/* header */
+		*sz += 1 + rrset->name.len;	/* name */
+		*sz += 2 + 2 + 4 + 2;		/* type, class, ttl, number of rdatas */
+
+		for (size_t i = 0; i < rrset->n_rdatas; i++) {
+			uint16_t rdlen = rrset->rdatas[i]->len;
+
+			*sz += varint ? varint_length(rdlen) : 2;
+			*sz += rdlen;
+		}
+
+		*sz += 4 * rrset->n_rdatas;	/* offset table */
+	}
+
+	if (buf) {
+		uint8_t *start = buf;
+		uint8_t *table;
+
+		*buf++ = 0;
+		*buf++ = 'W';
+		*buf++ = 2;
+		*buf++ = flags & WDNS_SERIALIZE_V2_VARINT;
+
+		*buf++ = rrset->name.len;
+		memcpy(buf, rrset->name.data, rrset->name.len);
+		buf += rrset->name.len;
+
+		store_net16(buf, rrset->rrtype);
+		store_net16(buf + 2, rrset->rrclass);
+		store_net32(buf + 4, rrset->rrttl);
+		store_net16(buf + 8, rrset->n_rdatas);
+		buf += 10;
+
+		/* the table follows the rdatas */
+		table = buf;
+		for (size_t i = 0; i < rrset->n_rdatas; i++)
+			table += (varint ? varint_length(rrset->rdatas[i]->len) : 2) +
+				 rrset->rdatas[i]->len;
+
+		for (size_t i = 0; i < rrset->n_rdatas; i++) {
+			uint16_t rdlen = rrset->rdatas[i]->len;
+
+			store_net32(table + 4 * i, buf - start);
+			if (varint) {
+				buf += varint_encode32(buf, rdlen);
+			} else {
+				store_net16(buf, rdlen);
+				buf += 2;
+			}
+			memcpy(buf, rrset->rdatas[i]->data, rdlen);
+			buf += rdlen;
+		}
+	}
+
+	return (wdns_res_success);
+}
+
+/*
+ * Append the version 2 serialization of an RRset to a ubuf in a single pass:
+ * the rdatas are copied as they are visited, and the offset table, which
+ * only depends on their lengths, is appended after them.
+ */
+
+void
+_wdns_serialize_rrset_v2_ubuf(ubuf *u, const wdns_rrset_t *rrset, unsigned flags)
+{
+	bool varint = (flags & WDNS_SERIALIZE_V2_VARINT) != 0;
+	uint8_t *buf;
+	uint32_t off;
+
+	ubuf_reserve(u, 4 + 1 + rrset->name.len + 10);
+	buf = ubuf_ptr(u);
+	*buf++ = 0;
+	*buf++ = 'W';
+	*buf++ = 2;
+	*buf++ = flags & WDNS_SERIALIZE_V2_VARINT;
+	*buf++ = rrset->name.len;
+	memcpy(buf, rrset->name.data, rrset->name.len);
+	buf += rrset->name.len;
+	store_net16(buf, rrset->rrtype);
+	store_net16(buf + 2, rrset->rrclass);
+	store_net32(buf + 4, rrset->rrttl);
+	store_net16(buf + 8, rrset->n_rdatas);
+	ubuf_advance(u, 4 + 1 + rrset->name.len + 10);
+
+	for (size_t i = 0; i < rrset->n_rdatas; i++) {
+		uint16_t rdlen = rrset->rdatas[i]->len;
+
+		ubuf_reserve(u, 3 + rdlen);
+		buf = ubuf_ptr(u);
+		if (varint) {
+			buf += varint_encode32(buf, rdlen);
+		} else {
+			store_net16(buf, rdlen);
+			buf += 2;
+		}
+		memcpy(buf, rrset->rdatas[i]->data, rdlen);
+		buf += rdlen;
+		ubuf_advance(u, buf - ubuf_ptr(u));
+	}
+
+	ubuf_reserve(u, 4 * rrset->n_rdatas);
+	buf = ubuf_ptr(u);
+	off = 4 + 1 + rrset->name.len + 10;
+	for (size_t i = 0; i < rrset->n_rdatas; i++) {
+		uint16_t rdlen = rrset->rdatas[i]->len;
+
+		store_net32(buf + 4 * i, off);
+		off += (varint ? varint_length(rdlen) : 2) + rdlen;
+	}
+	ubuf_advance(u, 4 * rrset->n_rdatas);
+}
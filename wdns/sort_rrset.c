@@ -1,3 +1,20 @@
+/*
+ * The rdata set is ordered by rdata length, then by rdata octets. Small sets
+ * are insertion sorted. Larger sets whose rdatas all have the same short
+ * length (e.g. A and AAAA) are sorted by an LSD radix sort on inline keys,
+ * and all others by an MSD radix sort whose key is the two length octets
+ * followed by the rdata octets.
+ */
+
+#define INSERTION_SORT_MAX	16
+#define FIXED_KEY_MAX		16
+#define MSD_DEPTH_MAX		32
+
+struct fixed_key {
+	uint8_t		key[FIXED_KEY_MAX];
+	wdns_rdata_t	*rdata;
+};
+
 static int
 rdata_cmp(const void *e1, const void *e2)
 {
@@ -13,6 +30,173 @@ rdata_cmp(const void *e1, const void *e2)
 	}
 }
 
+static void
+insertion_sort(wdns_rdata_t **rdatas, size_t n)
+{
+	for (size_t i = 1; i < n; i++) {
+		wdns_rdata_t *r = rdatas[i];
+		size_t j = i;
+
+		while (j > 0 && rdata_cmp(&rdatas[j - 1], &r) > 0) {
+			rdatas[j] = rdatas[j - 1];
+			j--;
+		}
+		rdatas[j] = r;
+	}
+}
+
+/* Sort rdatas that all have length len <= FIXED_KEY_MAX. */
+static void
+fixed_sort(wdns_rdata_t **rdatas, size_t n, size_t len)
+{
+	struct fixed_key *base, *keys, *tmp, *swap;
+	size_t count[256];
+
+	base = keys = my_malloc(2 * n * sizeof(*keys));
+	tmp = keys + n;
+
+	for (size_t i = 0; i < n; i++) {
+		memcpy(keys[i].key, rdatas[i]->data, len);
+		keys[i].rdata = rdatas[i];
+	}
+
+	for (size_t d = len; d-- > 0; ) {
+		size_t sum = 0;
+
+		memset(count, 0, sizeof(count));
+		for (size_t i = 0; i < n; i++)
+			count[keys[i].key[d]]++;
+		for (unsigned b = 0; b < 256; b++) {
+			size_t c = count[b];
+			count[b] = sum;
+			sum += c;
+		}
+		for (size_t i = 0; i < n; i++)
+			tmp[count[keys[i].key[d]]++] = keys[i];
+
+		swap = keys;
+		keys = tmp;
+		tmp = swap;
+	}
+
+	for (size_t i = 0; i < n; i++)
+		rdatas[i] = keys[i].rdata;
+
+	my_free(base);
+}
+
+/* Key octet d: the big-endian length, then the rdata. */
+static inline uint8_t
+msd_octet(const wdns_rdata_t *r, size_t d)
+{
+	if (d == 0)
+		return (r->len >> 8);
+	if (d == 1)
+		return (r->len & 0xff);
+	return (r->data[d - 2]);
+}
+
+/*
+ * Sort rdatas that are equal in the first d key octets. Beyond d = 2, all
+ * rdatas in a bucket have the same length.
+ *
+ * count is scratch space shared by every level of the recursion: it is only
+ * used to distribute the rdatas into buckets, and the buckets are found again
+ * afterwards by scanning for runs of equal octets, so a recursive call only
+ * costs a few words of stack.
+ */
+static void
+msd_sort(wdns_rdata_t **rdatas, wdns_rdata_t **tmp, size_t *count,
+	 size_t n, size_t d, unsigned depth)
+{
+	for (;;) {
+		size_t sum = 0;
+		unsigned b;
+
+		if (n <= INSERTION_SORT_MAX) {
+			insertion_sort(rdatas, n);
+			return;
+		}
+		if (d >= 2 && d - 2 == rdatas[0]->len)
+			return;
+		if (depth == MSD_DEPTH_MAX) {
+			qsort(rdatas, n, sizeof(rdatas[0]), rdata_cmp);
+			return;
+		}
+
+		memset(count, 0, 256 * sizeof(count[0]));
+		for (size_t i = 0; i < n; i++)
+			count[msd_octet(rdatas[i], d)]++;
+
+		/* all rdatas share this octet: move on to the next one */
+		b = msd_octet(rdatas[0], d);
+		if (count[b] == n) {
+			d++;
+			continue;
+		}
+
+		/* count[b] becomes the start of bucket b */
+		for (b = 0; b < 256; b++) {
+			size_t c = count[b];
+			count[b] = sum;
+			sum += c;
+		}
+		for (size_t i = 0; i < n; i++)
+			tmp[count[msd_octet(rdatas[i], d)]++] = rdatas[i];
+		memcpy(rdatas, tmp, n * sizeof(rdatas[0]));
+
+		for (size_t i = 0, j; i < n; i = j) {
+			b = msd_octet(rdatas[i], d);
+			for (j = i + 1; j < n && msd_octet(rdatas[j], d) == b; j++)
+				;
+			if (j - i > 1)
+				msd_sort(rdatas + i, tmp, count, j - i, d + 1, depth + 1);
+		}
+		return;
+	}
+}
+
+/*
+ * Sort the rdata set of an RRset, optionally downcasing each rdata in the
+ * pass that chooses the sort.
+ */
+
+wdns_res
+_wdns_sort_rrset(wdns_rrset_t *rrset, bool downcase)
+{
+	wdns_rdata_t **rdatas = rrset->rdatas;
+	size_t n = rrset->n_rdatas;
+	uint16_t len = n > 0 ? rdatas[0]->len : 0;
+	bool fixed = (len <= FIXED_KEY_MAX);
+	wdns_res res;
+
+	for (size_t i = 0; i < n && (downcase || fixed); i++) {
+		if (downcase) {
+			res = wdns_downcase_rdata(rdatas[i], rrset->rrtype, rrset->rrclass);
+			if (res != wdns_res_success)
+				return (res);
+		}
+		fixed = fixed && (rdatas[i]->len == len);
+	}
+
+	if (n <= INSERTION_SORT_MAX) {
+		insertion_sort(rdatas, n);
+		return (wdns_res_success);
+	}
+
+	if (fixed) {
+		fixed_sort(rdatas, n, len);
+	} else {
+		wdns_rdata_t **tmp = my_malloc(n * sizeof(*tmp));
+		size_t count[256];
+
+		msd_sort(rdatas, tmp, count, n, 0, 0);
+		my_free(tmp);
+	}
+
+	return (wdns_res_success);
+}
+
 /**
  * Sort the rdata set of an RRset.
  *
@@ -22,10 +206,5 @@ rdata_cmp(const void *e1, const void *e2)
 wdns_res
 wdns_sort_rrset(wdns_rrset_t *rrset)
 {
-	if (rrset->n_rdatas > 1)
-		qsort(&rrset->rdatas[0],
-		      rrset->n_rdatas,
-		      sizeof(rrset->rdatas[0]),
-		      rdata_cmp);
-	return (wdns_res_success);
+	return (_wdns_sort_rrset(rrset, false));
 }
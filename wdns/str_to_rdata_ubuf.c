@@ -61,6 +61,258 @@ err:
 	return 0;
 }
 
+#define MAX_MANDATORY_KEYS	(UINT16_MAX / 2)
+
+/* Compare two network byte order 16-bit integers. */
+static int
+cmp_net16(const void *a, const void *b)
+{
+	return (memcmp(a, b, 2));
+}
+
+struct svcparam {
+	uint16_t	key;
+	size_t		off;
+	size_t		len;
+};
+
+VECTOR_GENERATE(svcparam_vec, struct svcparam);
+
+/*
+ * Convert the value of an SVCB service parameter, already decoded from its
+ * character-string form, to wire format.
+ */
+static wdns_res
+svcparam_from_str(uint16_t key, const uint8_t *v, size_t n, ubuf *u)
+{
+	switch (key) {
+	case WDNS_SVCPARAM_MANDATORY: {
+		size_t start = ubuf_size(u);
+		size_t n_keys = 0;
+
+		/* the keys are appended as they are parsed and then sorted in
+		 * place; a value of at most 65535 octets holds at most 32767 */
+		for (size_t i = 0, j = 0; j <= n; j++) {
+			uint8_t buf[2];
+			uint16_t k;
+
+			if (j < n && v[j] != ',')
+				continue;
+			if (_wdns_str_to_svcparam_key((const char *) v + i, j - i, &k) != wdns_res_success ||
+			    n_keys == MAX_MANDATORY_KEYS)
+				return (wdns_res_parse_error);
+			store_net16(buf, k);
+			ubuf_append(u, buf, 2);
+			n_keys++;
+			i = j + 1;
+		}
+
+		/* keys appear in ascending order on the wire */
+		qsort(ubuf_data(u) + start, n_keys, 2, cmp_net16);
+		break;
+	}
+
+	case WDNS_SVCPARAM_ALPN: {
+		size_t len_offset = ubuf_size(u);
+		uint8_t len = 0;
+
+		/* a comma-separated list, in which "\," and "\\" escape a
+		 * comma and a backslash within an identifier */
+		ubuf_append(u, &len, 1);
+		for (size_t i = 0; i <= n; i++) {
+			if (i == n || v[i] == ',') {
+				size_t id_len = ubuf_size(u) - len_offset - 1;
+
+				if (id_len == 0 || id_len > UINT8_MAX)
+					return (wdns_res_parse_error);
+				ubuf_data(u)[len_offset] = id_len;
+				if (i < n) {
+					len_offset = ubuf_size(u);
+					ubuf_append(u, &len, 1);
+				}
+				continue;
+			}
+			if (v[i] == '\\' && i + 1 < n)
+				i++;
+			ubuf_append(u, &v[i], 1);
+		}
+		break;
+	}
+
+	case WDNS_SVCPARAM_NO_DEFAULT_ALPN:
+	case WDNS_SVCPARAM_OHTTP:
+		if (n != 0)
+			return (wdns_res_parse_error);
+		break;
+
+	case WDNS_SVCPARAM_PORT: {
+		uint32_t port = 0;
+		uint8_t buf[2];
+
+		if (n == 0 || n > 5)
+			return (wdns_res_parse_error);
+		for (size_t i = 0; i < n; i++) {
+			if (!isdigit(v[i]))
+				return (wdns_res_parse_error);
+			port = port * 10 + (v[i] - '0');
+		}
+		if (port > UINT16_MAX)
+			return (wdns_res_parse_error);
+		store_net16(buf, port);
+		ubuf_append(u, buf, 2);
+		break;
+	}
+
+	case WDNS_SVCPARAM_IPV4HINT:
+	case WDNS_SVCPARAM_IPV6HINT: {
+		int af = key == WDNS_SVCPARAM_IPV4HINT ? AF_INET : AF_INET6;
+		char pres[WDNS_PRESLEN_TYPE_AAAA];
+		uint8_t addr[16];
+
+		for (size_t i = 0, j = 0; j <= n; j++) {
+			if (j < n && v[j] != ',')
+				continue;
+			if (j - i >= sizeof(pres))
+				return (wdns_res_parse_error);
+			memcpy(pres, v + i, j - i);
+			pres[j - i] = '\0';
+			if (inet_pton(af, pres, addr) != 1)
+				return (wdns_res_parse_error);
+			ubuf_append(u, addr, af == AF_INET ? 4 : 16);
+			i = j + 1;
+		}
+		break;
+	}
+
+	case WDNS_SVCPARAM_ECH: {
+		base64_decodestate b64;
+		char *buf;
+		size_t buf_len, pad = 0;
+
+		/*
+		 * The decoder silently skips characters outside the base64
+		 * alphabet, so check for complete, correctly padded quanta.
+		 */
+		if (n == 0 || n % 4 != 0)
+			return (wdns_res_parse_error);
+		for (size_t i = 0; i < n; i++) {
+			uint8_t c = v[i];
+
+			if (c == '=') {
+				if (i + 2 < n)
+					return (wdns_res_parse_error);
+				pad++;
+			} else if (pad != 0 ||
+				   !((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+				     (c >= '0' && c <= '9') || c == '+' || c == '/'))
+			{
+				return (wdns_res_parse_error);
+			}
+		}
+
+		base64_init_decodestate(&b64);
+		buf = my_malloc(n + 1);
+		buf_len = base64_decode_block((const char *) v, n, buf, &b64);
+		ubuf_append(u, (uint8_t *) buf, buf_len);
+		my_free(buf);
+		break;
+	}
+
+	default:
+		ubuf_append(u, v, n);
+		break;
+	}
+
+	return (wdns_res_success);
+}
+
+/*
+ * Convert the SvcParams of an SVCB or HTTPS record, a whitespace-separated
+ * list of "key" or "key=value" elements in any order, to wire format.
+ */
+static wdns_res
+str_to_svcparams(const char *str, ubuf *u)
+{
+	svcparam_vec *params = svcparam_vec_init(8);
+	ubuf *vals = ubuf_new();
+	ubuf *tmp = ubuf_new();
+	size_t u_orig_size = ubuf_size(u);
+	wdns_svcparam_iter_t it;
+	wdns_svcparam_t param;
+	wdns_res res = wdns_res_parse_error;
+
+	while (*str) {
+		struct svcparam p;
+		const char *key = str;
+
+		if (isspace(*str)) {
+			str++;
+			continue;
+		}
+
+		while (*str && *str != '=' && !isspace(*str))
+			str++;
+		if (_wdns_str_to_svcparam_key(key, str - key, &p.key) != wdns_res_success)
+			goto out;
+
+		ubuf_reset(tmp);
+		if (*str == '=') {
+			str++;
+			if (*str && !isspace(*str)) {
+				size_t n = rdata_from_str_string((const uint8_t *) str, tmp);
+				if (n == 0)
+					goto out;
+				str += n;
+			}
+		}
+
+		p.off = ubuf_size(vals);
+		if (svcparam_from_str(p.key, ubuf_data(tmp), ubuf_size(tmp), vals) != wdns_res_success)
+			goto out;
+		p.len = ubuf_size(vals) - p.off;
+		if (p.len > UINT16_MAX)
+			goto out;
+		svcparam_vec_add(params, p);
+	}
+
+	/* parameters appear in ascending order of their keys on the wire */
+	for (size_t i = 1; i < svcparam_vec_size(params); i++) {
+		struct svcparam p = svcparam_vec_value(params, i);
+		size_t j = i;
+
+		for (; j > 0 && svcparam_vec_value(params, j - 1).key > p.key; j--)
+			svcparam_vec_data(params)[j] = svcparam_vec_value(params, j - 1);
+		svcparam_vec_data(params)[j] = p;
+	}
+
+	for (size_t i = 0; i < svcparam_vec_size(params); i++) {
+		struct svcparam p = svcparam_vec_value(params, i);
+		uint8_t buf[4];
+
+		store_net16(buf, p.key);
+		store_net16(buf + 2, p.len);
+		ubuf_append(u, buf, 4);
+		ubuf_append(u, ubuf_data(vals) + p.off, p.len);
+	}
+
+	/* duplicate keys and values malformed for their keys are rejected */
+	_wdns_svcparam_iter_params(&it, ubuf_data(u) + u_orig_size, ubuf_size(u) - u_orig_size);
+	while ((res = wdns_svcparam_iter_next(&it, &param)) == wdns_res_success)
+		;
+	if (res == wdns_res_len)
+		res = wdns_res_success;
+	else
+		res = wdns_res_parse_error;
+
+out:
+	if (res != wdns_res_success)
+		ubuf_clip(u, u_orig_size);
+	svcparam_vec_destroy(&params);
+	ubuf_destroy(&vals);
+	ubuf_destroy(&tmp);
+	return (res);
+}
+
 static int
 cmp_u16(const void *a, const void *b) {
 	uint16_t *u1 = (uint16_t *)a;
@@ -732,6 +984,13 @@ _wdns_str_to_rdata_ubuf(ubuf *u, const char *str,
 			u16buf_destroy(&rrtypes);
 			break;
 		}
+		case rdf_svcparams:
+			res = str_to_svcparams(str, u);
+			if (res != wdns_res_success)
+				goto err;
+			str += strlen(str);
+			break;
+
 		default: {
 			res = wdns_res_failure;
 			goto err;
@@ -0,0 +1,251 @@
+static const char *svcparam_keys[] = {
+	[WDNS_SVCPARAM_MANDATORY]	= "mandatory",
+	[WDNS_SVCPARAM_ALPN]		= "alpn",
+	[WDNS_SVCPARAM_NO_DEFAULT_ALPN]	= "no-default-alpn",
+	[WDNS_SVCPARAM_PORT]		= "port",
+	[WDNS_SVCPARAM_IPV4HINT]	= "ipv4hint",
+	[WDNS_SVCPARAM_ECH]		= "ech",
+	[WDNS_SVCPARAM_IPV6HINT]	= "ipv6hint",
+	[WDNS_SVCPARAM_DOHPATH]		= "dohpath",
+	[WDNS_SVCPARAM_OHTTP]		= "ohttp",
+};
+
+#define N_SVCPARAM_KEYS (sizeof(svcparam_keys) / sizeof(svcparam_keys[0]))
+
+/**
+ * Return the presentation name of a registered SvcParamKey, or NULL.
+ */
+
+const char *
+_wdns_svcparam_key_to_str(uint16_t key)
+{
+	if (key < N_SVCPARAM_KEYS)
+		return (svcparam_keys[key]);
+	return (NULL);
+}
+
+/**
+ * Convert the presentation form of a SvcParamKey, either a registered name
+ * or "keyNNNNN", of length len.
+ *
+ * \return wdns_res_success
+ * \return wdns_res_parse_error
+ */
+
+wdns_res
+_wdns_str_to_svcparam_key(const char *str, size_t len, uint16_t *key)
+{
+	unsigned long val = 0;
+
+	for (size_t i = 0; i < N_SVCPARAM_KEYS; i++) {
+		if (strlen(svcparam_keys[i]) == len && strncmp(str, svcparam_keys[i], len) == 0) {
+			*key = i;
+			return (wdns_res_success);
+		}
+	}
+
+	if (len < 4 || len > 8 || strncmp(str, "key", 3) != 0)
+		return (wdns_res_parse_error);
+	for (size_t i = 3; i < len; i++) {
+		if (!isdigit((unsigned char) str[i]))
+			return (wdns_res_parse_error);
+		val = val * 10 + (str[i] - '0');
+	}
+	if (val > UINT16_MAX)
+		return (wdns_res_parse_error);
+	*key = val;
+	return (wdns_res_success);
+}
+
+/* Check the value of a parameter against the format of its key. */
+static wdns_res
+check_value(const wdns_svcparam_t *param)
+{
+	const uint8_t *p = param->value;
+	size_t len = param->len;
+
+	switch (param->key) {
+	case WDNS_SVCPARAM_MANDATORY: {
+		uint16_t key, last_key = 0;
+
+		if (len == 0 || len % 2 != 0)
+			return (wdns_res_parse_error);
+		for (size_t i = 0; i < len; i += 2) {
+			load_net16(p + i, &key);
+			if (key == WDNS_SVCPARAM_MANDATORY || (i > 0 && key <= last_key))
+				return (wdns_res_parse_error);
+			last_key = key;
+		}
+		break;
+	}
+
+	case WDNS_SVCPARAM_ALPN:
+		if (len == 0)
+			return (wdns_res_parse_error);
+		while (len > 0) {
+			if (p[0] == 0 || p[0] >= len)
+				return (wdns_res_parse_error);
+			len -= p[0] + 1;
+			p += p[0] + 1;
+		}
+		break;
+
+	case WDNS_SVCPARAM_NO_DEFAULT_ALPN:
+	case WDNS_SVCPARAM_OHTTP:
+		if (len != 0)
+			return (wdns_res_parse_error);
+		break;
+
+	case WDNS_SVCPARAM_PORT:
+		if (len != 2)
+			return (wdns_res_parse_error);
+		break;
+
+	case WDNS_SVCPARAM_IPV4HINT:
+		if (len == 0 || len % 4 != 0)
+			return (wdns_res_parse_error);
+		break;
+
+	case WDNS_SVCPARAM_IPV6HINT:
+		if (len == 0 || len % 16 != 0)
+			return (wdns_res_parse_error);
+		break;
+	}
+
+	return (wdns_res_success);
+}
+
+/**
+ * Initialize an iterator over the SvcParams region of an SVCB or HTTPS rdata,
+ * which is the part following the TargetName.
+ */
+
+void
+_wdns_svcparam_iter_params(wdns_svcparam_iter_t *it, const uint8_t *params, size_t len)
+{
+	it->_p = params;
+	it->_end = params + len;
+	it->_last_key = -1;
+}
+
+/**
+ * Initialize an iterator over the service parameters of an SVCB or HTTPS
+ * rdata.
+ *
+ * \param[out] it the iterator
+ * \param[in] rdata SVCB or HTTPS rdata
+ * \param[in] rdlen length of the rdata
+ *
+ * \return wdns_res_success
+ * \return wdns_res_parse_error if the SvcPriority or TargetName is malformed
+ */
+
+wdns_res
+wdns_svcparam_iter_init(wdns_svcparam_iter_t *it, const uint8_t *rdata, size_t rdlen)
+{
+	size_t len;
+
+	if (rdlen < 2 ||
+	    wdns_len_uname(rdata + 2, rdata + rdlen, &len) != wdns_res_success)
+	{
+		return (wdns_res_parse_error);
+	}
+	_wdns_svcparam_iter_params(it, rdata + 2 + len, rdlen - 2 - len);
+
+	return (wdns_res_success);
+}
+
+/**
+ * Return the next service parameter of an SVCB or HTTPS rdata.
+ *
+ * Parameters are returned in wire order, which is ascending by key. The value
+ * of each parameter with a registered key is checked against the format of
+ * that key, so, for instance, the value of an ipv4hint parameter is always a
+ * non-empty sequence of 4 octet addresses.
+ *
+ * \param[in,out] it the iterator
+ * \param[out] param the parameter, whose value points into the rdata
+ *
+ * \return wdns_res_success
+ * \return wdns_res_len if there are no more parameters
+ * \return wdns_res_overflow if the parameter is truncated
+ * \return wdns_res_parse_error if the keys are not in strictly ascending order
+ *	or the value is malformed
+ */
+
+wdns_res
+wdns_svcparam_iter_next(wdns_svcparam_iter_t *it, wdns_svcparam_t *param)
+{
+	if (it->_p == it->_end)
+		return (wdns_res_len);
+	if (it->_end - it->_p < 4)
+		return (wdns_res_overflow);
+
+	load_net16(it->_p, &param->key);
+	load_net16(it->_p + 2, &param->len);
+	if (it->_end - it->_p - 4 < param->len)
+		return (wdns_res_overflow);
+	if ((int32_t) param->key <= it->_last_key)
+		return (wdns_res_parse_error);
+	param->value = it->_p + 4;
+	if (check_value(param) != wdns_res_success)
+		return (wdns_res_parse_error);
+
+	it->_p += 4 + param->len;
+	it->_last_key = param->key;
+
+	return (wdns_res_success);
+}
+
+/**
+ * Return the next protocol identifier of an alpn parameter.
+ *
+ * \param[in] param an alpn parameter returned by wdns_svcparam_iter_next()
+ * \param[in,out] off offset of the next identifier, initially zero
+ * \param[out] id the identifier, which points into the rdata
+ * \param[out] id_len length of the identifier
+ *
+ * \return true if an identifier was returned, false at the end of the list
+ */
+
+bool
+wdns_svcparam_alpn_next(const wdns_svcparam_t *param, size_t *off,
+			const uint8_t **id, uint8_t *id_len)
+{
+	if (param->key != WDNS_SVCPARAM_ALPN || *off >= param->len)
+		return (false);
+
+	*id_len = param->value[*off];
+	*id = &param->value[*off + 1];
+	*off += 1 + *id_len;
+
+	return (true);
+}
+
+/**
+ * Return an address of an ipv4hint or ipv6hint parameter.
+ *
+ * \param[in] param an ipv4hint or ipv6hint parameter returned by
+ *	wdns_svcparam_iter_next()
+ * \param[in] i index of the address
+ *
+ * \return the 4 octet IPv4 or 16 octet IPv6 address, which points into the
+ *	rdata, or NULL if there are not that many addresses
+ */
+
+const uint8_t *
+wdns_svcparam_hint(const wdns_svcparam_t *param, size_t i)
+{
+	size_t sz;
+
+	if (param->key == WDNS_SVCPARAM_IPV4HINT)
+		sz = 4;
+	else if (param->key == WDNS_SVCPARAM_IPV6HINT)
+		sz = 16;
+	else
+		return (NULL);
+
+	if (i >= param->len / sz)
+		return (NULL);
+	return (param->value + i * sz);
+}
@@ -26,6 +26,7 @@
 
 #include "libmy/my_alloc.h"
 #include "libmy/ubuf.h"
+#include "libmy/varint.h"
 
 #define load_net16(buf, out) do { \
 	uint16_t _my_16; \
@@ -41,6 +42,16 @@
 	*(out) = _my_32; \
 } while (0)
 
+#define store_net16(buf, in) do { \
+	uint16_t _my_16 = htons(in); \
+	memcpy(buf, &_my_16, sizeof(uint16_t)); \
+} while (0)
+
+#define store_net32(buf, in) do { \
+	uint32_t _my_32 = htonl(in); \
+	memcpy(buf, &_my_32, sizeof(uint32_t)); \
+} while (0)
+
 /**
  * Advance pointer p by sz bytes and update len.
  */
@@ -75,12 +86,51 @@
 	src += 4; \
 } while (0)
 
+/**
+ * Location of a domain name within an rdata.
+ */
+typedef struct {
+	uint16_t	off;
+	uint16_t	len;
+} _wdns_span_t;
+
+/* no rrtype has more names that are downcased in canonical form */
+#define _WDNS_MAX_NAME_SPANS	4
+
+/**
+ * Decoded header of an export record or serialized message.
+ */
+typedef struct {
+	uint16_t	id;
+	uint16_t	flags;
+	uint16_t	rcode;
+	bool		edns_present;
+	uint8_t		edns_version;
+	uint16_t	edns_flags;
+	uint16_t	edns_size;
+	uint16_t	edns_options_len;
+	const uint8_t	*edns_options;
+} _wdns_message_header_t;
+
 wdns_res
 _wdns_insert_rr_rrset_array(wdns_rrset_array_t *a, wdns_rr_t *rr, unsigned sec);
 
 wdns_res
 _wdns_parse_edns(wdns_message_t *m, wdns_rr_t *rr);
 
+void
+_wdns_svcparam_iter_params(wdns_svcparam_iter_t *it, const uint8_t *params, size_t len);
+
+const char *
+_wdns_svcparam_key_to_str(uint16_t key);
+
+wdns_res
+_wdns_str_to_svcparam_key(const char *str, size_t len, uint16_t *key);
+
+wdns_res
+_wdns_check_rdata(uint16_t rrtype, uint16_t rrclass, const uint8_t *p, const uint8_t *eop,
+		  const uint8_t *rdata, uint16_t rdlen, ubuf *u);
+
 wdns_res
 _wdns_parse_rdata(wdns_rr_t *rr, const uint8_t *p, const uint8_t *eop,
 		  const uint8_t *rdata, uint16_t rdlen);
@@ -89,10 +139,19 @@ wdns_res
 _wdns_parse_header(const uint8_t *p, size_t len, uint16_t *id, uint16_t *flags,
 		   uint16_t *qdcount, uint16_t *ancount, uint16_t *nscount, uint16_t *arcount);
 
+wdns_res
+_wdns_check_message_rr(unsigned sec, const uint8_t *p, const uint8_t *eop, const uint8_t *data,
+		       size_t *rrsz);
+
 wdns_res
 _wdns_parse_message_rr(unsigned sec, const uint8_t *p, const uint8_t *eop, const uint8_t *data,
 		       size_t *rrsz, wdns_rr_t *rr);
 
+wdns_res
+_wdns_rdata_name_spans(const uint8_t *rdata, uint16_t rdlen,
+		       uint16_t rrtype, uint16_t rrclass,
+		       _wdns_span_t spans[_WDNS_MAX_NAME_SPANS], unsigned *n_spans);
+
 void
 _wdns_rdata_to_ubuf(ubuf *, const uint8_t *rdata, uint16_t rdlen,
 		    uint16_t rrtype, uint16_t rrclass);
@@ -109,3 +168,30 @@ _wdns_rrset_to_ubuf(ubuf *, wdns_rrset_t *rrset, unsigned sec);
 
 void
 _wdns_rrset_array_to_ubuf(ubuf *, wdns_rrset_array_t *a, unsigned sec);
+
+void
+_wdns_serialize_rrset_array_ubuf(ubuf *, const wdns_rrset_array_t *a);
+
+void
+_wdns_serialize_rrset_v2_ubuf(ubuf *, const wdns_rrset_t *rrset, unsigned flags);
+
+bool
+_wdns_get_varint(const uint8_t **p, const uint8_t *end, uint32_t max, uint32_t *val);
+
+size_t
+_wdns_message_header_len(const wdns_message_t *m);
+
+size_t
+_wdns_put_message_header(const wdns_message_t *m, uint8_t *buf);
+
+bool
+_wdns_get_message_header(const uint8_t **p, const uint8_t *end, _wdns_message_header_t *h);
+
+wdns_res
+_wdns_sort_rrset(wdns_rrset_t *rrset, bool downcase);
+
+wdns_res
+_wdns_rebuild_rrs(wdns_rrset_array_t *a, unsigned sec);
+
+wdns_res
+_wdns_deserialize_rrset_array_iter(wdns_rrset_array_t *a, wdns_rrset_iter_t *it, unsigned sec);
@@ -29,6 +29,7 @@ extern "C" {
 
 #define WDNS_LEN_HEADER		12
 #define WDNS_MAXLEN_NAME	255
+#define WDNS_MAXLEN_SORTKEY	(2 * WDNS_MAXLEN_NAME)
 
 #define WDNS_MSG_SEC_QUESTION	0
 #define WDNS_MSG_SEC_ANSWER	1
@@ -36,6 +37,30 @@ extern "C" {
 #define WDNS_MSG_SEC_ADDITIONAL	3
 #define WDNS_MSG_SEC_MAX	4
 
+#define WDNS_SERIALIZE_V2_VARINT	0x01
+
+#define WDNS_EDNS_OPT_NSID		3
+#define WDNS_EDNS_OPT_CLIENT_SUBNET	8
+#define WDNS_EDNS_OPT_EXPIRE		9
+#define WDNS_EDNS_OPT_COOKIE		10
+#define WDNS_EDNS_OPT_KEEPALIVE		11
+#define WDNS_EDNS_OPT_PADDING		12
+#define WDNS_EDNS_OPT_CHAIN		13
+#define WDNS_EDNS_OPT_KEY_TAG		14
+#define WDNS_EDNS_OPT_EDE		15
+
+#define WDNS_EDNS_OPTION_INDEX_CODES	16
+
+#define WDNS_SVCPARAM_MANDATORY		0
+#define WDNS_SVCPARAM_ALPN		1
+#define WDNS_SVCPARAM_NO_DEFAULT_ALPN	2
+#define WDNS_SVCPARAM_PORT		3
+#define WDNS_SVCPARAM_IPV4HINT		4
+#define WDNS_SVCPARAM_ECH		5
+#define WDNS_SVCPARAM_IPV6HINT		6
+#define WDNS_SVCPARAM_DOHPATH		7
+#define WDNS_SVCPARAM_OHTTP		8
+
 #define WDNS_PRESLEN_NAME	1025
 #define WDNS_PRESLEN_TYPE_A	16
 #define WDNS_PRESLEN_TYPE_AAAA	46
@@ -126,7 +151,10 @@ extern "C" {
 #define WDNS_TYPE_CDNSKEY	60
 #define WDNS_TYPE_OPENPGPKEY	61
 #define WDNS_TYPE_CSYNC		62
-/* Unassigned: 63 - 98 */
+/* Unassigned: 63 */
+#define WDNS_TYPE_SVCB		64
+#define WDNS_TYPE_HTTPS		65
+/* Unassigned: 66 - 98 */
 #define WDNS_TYPE_SPF		99
 #define WDNS_TYPE_UINFO		100
 #define WDNS_TYPE_UID		101
@@ -237,6 +265,51 @@ typedef struct {
 	wdns_rdata_t		*options;
 } wdns_edns_t;
 
+typedef struct {
+	uint16_t		code;
+	uint16_t		len;
+	const uint8_t		*data;
+} wdns_edns_option_t;
+
+typedef struct {
+	/* private iteration state */
+	const uint8_t		*_p;
+	const uint8_t		*_end;
+} wdns_edns_option_iter_t;
+
+typedef struct {
+	/* private index state */
+	const uint8_t		*_options;
+	uint16_t		_len;
+	uint16_t		_first[WDNS_EDNS_OPTION_INDEX_CODES];
+} wdns_edns_option_index_t;
+
+typedef struct {
+	uint16_t		family;
+	uint8_t			source_prefix;
+	uint8_t			scope_prefix;
+	uint8_t			address[16];
+} wdns_edns_ecs_t;
+
+typedef struct {
+	uint16_t		info_code;
+	uint16_t		text_len;
+	const uint8_t		*text;
+} wdns_edns_ede_t;
+
+typedef struct {
+	uint16_t		key;
+	uint16_t		len;
+	const uint8_t		*value;
+} wdns_svcparam_t;
+
+typedef struct {
+	/* private iteration state */
+	const uint8_t		*_p;
+	const uint8_t		*_end;
+	int32_t			_last_key;
+} wdns_svcparam_iter_t;
+
 typedef struct {
 	wdns_rrset_array_t	sections[4];
 	wdns_edns_t		edns;
@@ -245,9 +318,100 @@ typedef struct {
 	uint16_t		rcode;
 } wdns_message_t;
 
+typedef struct {
+	unsigned		sec;
+	uint8_t			name_len;
+	uint16_t		rrtype;
+	uint16_t		rrclass;
+	uint16_t		rdlen;
+	uint32_t		rrttl;
+	const uint8_t		*name;
+	const uint8_t		*rdata;
+} wdns_export_rr_t;
+
+typedef struct {
+	uint16_t		id;
+	uint16_t		flags;
+	uint16_t		rcode;
+	bool			edns_present;
+	uint8_t			edns_version;
+	uint16_t		edns_flags;
+	uint16_t		edns_size;
+	uint16_t		edns_options_len;
+	const uint8_t		*edns_options;
+	uint16_t		counts[WDNS_MSG_SEC_MAX];
+
+	/* private iteration state */
+	const uint8_t		*_rr;
+	const uint8_t		*_end;
+	unsigned		_sec;
+	unsigned		_n;
+} wdns_export_record_t;
+
+typedef struct {
+	uint8_t			name_len;
+	uint16_t		rrtype;
+	uint16_t		rrclass;
+	uint16_t		n_rdatas;
+	uint32_t		rrttl;
+	const uint8_t		*name;
+
+	/* private access state */
+	const uint8_t		*_buf;
+	const uint8_t		*_rdatas;
+	const uint8_t		*_table;
+	const uint8_t		*_cur;
+	uint16_t		_cur_idx;
+	uint8_t			_flags;
+} wdns_rrset_view_t;
+
+typedef struct {
+	uint16_t		n_rrsets;
+
+	/* private iteration state */
+	const uint8_t		*_p;
+	const uint8_t		*_end;
+	uint16_t		_n;
+} wdns_rrset_iter_t;
+
+typedef struct {
+	uint16_t		id;
+	uint16_t		flags;
+	uint16_t		rcode;
+	bool			edns_present;
+	uint8_t			edns_version;
+	uint16_t		edns_flags;
+	uint16_t		edns_size;
+	uint16_t		edns_options_len;
+	const uint8_t		*edns_options;
+	wdns_rrset_iter_t	sections[WDNS_MSG_SEC_MAX];
+} wdns_serialized_message_t;
+
+typedef struct {
+	uint64_t		n_frames;
+	uint64_t		n_corrupt;
+	uint64_t		n_skipped;
+
+	/* private iteration state */
+	const uint8_t		*_p;
+	const uint8_t		*_end;
+	uint64_t		_crc_budget;
+} wdns_frame_reader_t;
+
+typedef struct {
+	unsigned		sec;
+	uint16_t		rrtype;
+	uint16_t		rrclass;
+	uint32_t		rrttl;
+	uint16_t		rdlen;
+	uint8_t			*rdata;
+} wdns_patch_rr_t;
+
 /* Function prototypes. */
 
 typedef void (*wdns_callback_name)(wdns_name_t *name, void *user);
+typedef void (*wdns_callback_data)(const uint8_t *data, size_t len, void *user);
+typedef void (*wdns_callback_patch)(wdns_patch_rr_t *rr, void *user);
 
 /* Functions for converting objects to presentation format strings. */
 
@@ -298,6 +462,7 @@ void	wdns_clear_message(wdns_message_t *m);
 void	wdns_clear_rr(wdns_rr_t *rr);
 void	wdns_clear_rrset(wdns_rrset_t *rrset);
 void	wdns_clear_rrset_array(wdns_rrset_array_t *a);
+void	wdns_clear_rrset_flat(wdns_rrset_t *rrset);
 
 /* Functions for printing formatted output. */
 
@@ -320,6 +485,12 @@ wdns_len_uname(const uint8_t *p, const uint8_t *eop, size_t *sz);
 wdns_res
 wdns_sort_rrset(wdns_rrset_t *);
 
+wdns_res
+wdns_normalize_rrset(wdns_rrset_t *rrset, uint64_t *hash);
+
+wdns_res
+wdns_normalize_message(wdns_message_t *m);
+
 wdns_res
 wdns_unpack_name(const uint8_t *p, const uint8_t *eop, const uint8_t *src,
 		 uint8_t *dst, size_t *sz);
@@ -340,6 +511,12 @@ WDNS_WARN_UNUSED_RESULT
 wdns_res
 wdns_reverse_name(const uint8_t *name, size_t len_name, uint8_t *rev_name);
 
+wdns_res
+wdns_name_sortkey(const wdns_name_t *name, uint8_t *key, size_t *sz);
+
+int
+wdns_name_cmp_canonical(const wdns_name_t *n0, const wdns_name_t *n1);
+
 /* Parsing functions. */
 
 wdns_res
@@ -350,11 +527,134 @@ wdns_parse_message(wdns_message_t *m, const uint8_t *pkt, size_t len);
 wdns_res
 wdns_deserialize_rrset(wdns_rrset_t *rrset, const uint8_t *buf, size_t sz);
 
+wdns_res
+wdns_deserialize_rrset_buf(wdns_rrset_t *rrset, const uint8_t *buf, size_t sz,
+			   uint8_t *mem, size_t *memsz);
+
+wdns_res
+wdns_deserialize_rrset_flat(wdns_rrset_t *rrset, const uint8_t *buf, size_t sz);
+
+wdns_res
+wdns_rrset_view_init(wdns_rrset_view_t *v, const uint8_t *buf, size_t sz);
+
+wdns_res
+wdns_rrset_view_rdata(wdns_rrset_view_t *v, uint16_t i,
+		      const uint8_t **rdata, uint16_t *rdlen);
+
+wdns_res
+wdns_deserialize_rrset_array(wdns_rrset_array_t *a, unsigned sec,
+			     const uint8_t *buf, size_t sz);
+
+wdns_res
+wdns_deserialize_message(wdns_message_t *m, const uint8_t *buf, size_t sz);
+
+wdns_res
+wdns_rrset_iter_init(wdns_rrset_iter_t *it, const uint8_t *buf, size_t sz);
+
+bool
+wdns_rrset_iter_next(wdns_rrset_iter_t *it, wdns_rrset_view_t *v);
+
+wdns_res
+wdns_serialized_message_init(wdns_serialized_message_t *sm, const uint8_t *buf, size_t sz);
+
+/* Rendering functions. */
+
+wdns_res
+wdns_render_message(const wdns_message_t *m, uint8_t *buf, size_t len, size_t *sz);
+
+wdns_res
+wdns_render_message_limit(const wdns_message_t *m, uint8_t *buf, size_t limit,
+			  size_t *sz, uint16_t counts[WDNS_MSG_SEC_MAX], bool *truncated);
+
 /* Serialization functions. */
 
 wdns_res
 wdns_serialize_rrset(const wdns_rrset_t *rrset, uint8_t *buf, size_t *sz);
 
+wdns_res
+wdns_serialize_rrset_v2(const wdns_rrset_t *rrset, unsigned flags, uint8_t *buf, size_t *sz);
+
+wdns_res
+wdns_serialize_rrset_array(const wdns_rrset_array_t *a, uint8_t **buf, size_t *sz);
+
+wdns_res
+wdns_serialize_message(const wdns_message_t *m, uint8_t **buf, size_t *sz);
+
+/* Framed record stream functions. */
+
+wdns_res
+wdns_frame_write(const uint8_t *payload, size_t len, uint8_t *buf, size_t *sz);
+
+wdns_res
+wdns_frame_write_rrset(const wdns_rrset_t *rrset, uint8_t *buf, size_t *sz);
+
+void
+wdns_frame_reader_init(wdns_frame_reader_t *r, const uint8_t *buf, size_t sz);
+
+wdns_res
+wdns_frame_reader_next(wdns_frame_reader_t *r, const uint8_t **payload, size_t *len);
+
+/* In-place message patching functions. */
+
+wdns_res
+wdns_patch_message(uint8_t *pkt, size_t len, wdns_callback_patch cb, void *user);
+
+wdns_res
+wdns_patch_header(uint8_t *pkt, size_t len, uint16_t id, uint16_t flags);
+
+wdns_res
+wdns_patch_ttls(uint8_t *pkt, size_t len, uint32_t n);
+
+/* EDNS functions. */
+
+void
+wdns_edns_option_iter_init(wdns_edns_option_iter_t *it, const uint8_t *options, size_t len);
+
+wdns_res
+wdns_edns_option_iter_next(wdns_edns_option_iter_t *it, wdns_edns_option_t *opt);
+
+bool
+wdns_edns_find_option(const wdns_edns_t *edns, uint16_t code, wdns_edns_option_t *opt);
+
+void
+wdns_edns_option_index_init(wdns_edns_option_index_t *idx, const wdns_edns_t *edns);
+
+bool
+wdns_edns_option_index_find(const wdns_edns_option_index_t *idx, uint16_t code,
+			    wdns_edns_option_t *opt);
+
+wdns_res
+wdns_edns_decode_ecs(const wdns_edns_option_t *opt, wdns_edns_ecs_t *ecs);
+
+wdns_res
+wdns_edns_decode_ede(const wdns_edns_option_t *opt, wdns_edns_ede_t *ede);
+
+/* SVCB and HTTPS functions. */
+
+wdns_res
+wdns_svcparam_iter_init(wdns_svcparam_iter_t *it, const uint8_t *rdata, size_t rdlen);
+
+wdns_res
+wdns_svcparam_iter_next(wdns_svcparam_iter_t *it, wdns_svcparam_t *param);
+
+bool
+wdns_svcparam_alpn_next(const wdns_svcparam_t *param, size_t *off,
+			const uint8_t **id, uint8_t *id_len);
+
+const uint8_t *
+wdns_svcparam_hint(const wdns_svcparam_t *param, size_t i);
+
+/* Export record functions. */
+
+wdns_res
+wdns_export_message(const wdns_message_t *m, uint8_t *buf, size_t *sz);
+
+wdns_res
+wdns_export_next(const uint8_t **buf, const uint8_t *end, wdns_export_record_t *rec);
+
+bool
+wdns_export_next_rr(wdns_export_record_t *rec, wdns_export_rr_t *rr);
+
 /* Downcasing functions. */
 
 void
@@ -366,6 +666,16 @@ wdns_downcase_rdata(wdns_rdata_t *rdata, uint16_t rrtype, uint16_t rrclass);
 wdns_res
 wdns_downcase_rrset(wdns_rrset_t *rrset);
 
+/* DNSSEC functions. */
+
+wdns_res
+wdns_rrset_signing_input(const wdns_rrset_t *rrset, const wdns_rdata_t *rrsig,
+			 uint8_t *buf, size_t len, size_t *sz);
+
+wdns_res
+wdns_rrset_signing_input_cb(const wdns_rrset_t *rrset, const wdns_rdata_t *rrsig,
+			    wdns_callback_data cb, void *user);
+
 #ifdef __cplusplus
 }
 #endif